@@ -28,6 +28,9 @@
 
 #include <Arduino.h>
 //#include <Wire.h>
+#include "CoordinateScale.h"
+#include "FixedDivisor.h"
+#include "LogFormat.h"
 
 #define GNSS_ADDRESS 66
 #define GNSS_REGISTER 0xFE
@@ -41,7 +44,115 @@
 #define FLIGHT_MODE 6 // The GNSS should be set to flight mode 6 (Aerospace, <1g). See uBlox documentation for UBX-CFG-NAV5 for further information.
 #define DEFAULT_FLIGHT_MODE 3 // The GNSS defaults to this flight mode on reset
 
+#define NMEA_MAX_SENTENCE_LENGTH 82 // Including the $ and the CR LF, per NMEA 0183
 #define BYTE_OF_FLIGHT_MODE_IN_UBX_CFG_NAV5 8 // The index of the byte for flight mode within the CFG-NAV5 message, inlcuding headers. See Ublox GNSS documentation for details.
+//#define BPPCELL_STATS // Uncomment to compile in BPPCellStats, the timing and byte counters for the blocking calls
+//#define BPPCELL_NO_HEAP // Uncomment to compile out every String API, leaving the buffer-based ones; see below
+
+/* Instrumentation
+ * With BPPCELL_STATS defined, the library times each of its blocking operations with micros() and counts the bytes
+ * moved, bus transactions, filler bytes discarded and timeouts behind them, along with the heap high-water mark, in
+ * the static BPPCellStats block. BPPCELL_STAT_DUMP(out) prints the block as one line to any Print (DEBUG_SERIAL, an
+ * SD File). With it undefined the BPPCELL_STAT_* macros expand to nothing and none of this is compiled in.
+ */
+#ifdef BPPCELL_STATS
+
+struct BPPStatOp {
+	unsigned long count;
+	unsigned long minMicros;
+	unsigned long maxMicros;
+	unsigned long totalMicros; // Wraps after ~71 minutes of accumulated time in one operation
+	unsigned long bytes;
+};
+
+class BPPCellStats {
+	public:
+		enum Op { GNSS_GGA, GNSS_MESSAGE, GNSS_SEND, CELL_SEND, CELL_CSQ, NMEA_PARSE, COORDS_FORMAT, LOG_WRITE, NUM_OPS };
+		static void record(byte op, unsigned long elapsedMicros, unsigned long bytesMoved);
+		static void sampleHeap();
+		static void dump(Print &out);
+		static void reset();
+		static BPPStatOp ops[NUM_OPS];
+		static unsigned long bytes; // Bytes sent, received or parsed; each operation records the change across its span
+		static unsigned long transactions; // Bus transactions (I2C/SPI reads requested from the GNSS)
+		static unsigned long fillerBytes; // 0xFF and null filler bytes read from the GNSS and discarded
+		static unsigned long timeouts;
+		static unsigned int heapHighWater; // The most heap in use, in bytes (AVR only)
+		static unsigned int minFreeMemory; // The least space between heap and stack, in bytes (AVR only)
+};
+
+// Times the enclosing scope as one operation
+class BPPStatTimer {
+	public:
+		BPPStatTimer(byte op) : _op(op), _startMicros(micros()), _startBytes(BPPCellStats::bytes) {}
+		~BPPStatTimer() { BPPCellStats::record(_op, micros() - _startMicros, BPPCellStats::bytes - _startBytes); }
+	private:
+		byte _op;
+		unsigned long _startMicros;
+		unsigned long _startBytes;
+};
+
+#define BPPCELL_STAT_SCOPE(op) BPPStatTimer _bppStatTimer(BPPCellStats::op)
+#define BPPCELL_STAT_BYTES(n) (BPPCellStats::bytes += (n))
+#define BPPCELL_STAT_TRANSACTION() (BPPCellStats::transactions++)
+#define BPPCELL_STAT_FILLER() (BPPCellStats::fillerBytes++)
+#define BPPCELL_STAT_TIMEOUT() (BPPCellStats::timeouts++)
+#define BPPCELL_STAT_DUMP(out) BPPCellStats::dump(out)
+
+#else
+
+#define BPPCELL_STAT_SCOPE(op)
+#define BPPCELL_STAT_BYTES(n) ((void) 0)
+#define BPPCELL_STAT_TRANSACTION() ((void) 0)
+#define BPPCELL_STAT_FILLER() ((void) 0)
+#define BPPCELL_STAT_TIMEOUT() ((void) 0)
+#define BPPCELL_STAT_DUMP(out) ((void) 0)
+
+#endif
+
+/* Heap-free build
+ * Every API that takes or returns a String has a counterpart that works in a caller-supplied char buffer, and all
+ * of the library's constant text (AT commands, UBX messages, format labels) is kept in PROGMEM. With
+ * BPPCELL_NO_HEAP defined the String APIs are compiled out, and String, new, delete and malloc are made
+ * undeclared names from here to the end of BPPCell.h, and to the end of each of the library's own source files
+ * (which define BPPCELL_SOURCE), so any use of the heap in the library fails to compile. Sketches are not checked.
+ * MemoryReport::print() lists the static RAM each of the library's classes takes.
+ */
+#ifdef BPPCELL_NO_HEAP
+
+// Headers from outside the library that it includes, so that they are read before the checks begin
+#include <HardwareSerial.h>
+#include <I2C.h>
+#include <avr/pgmspace.h>
+
+#define String BPPCELL_NO_HEAP_forbids_String
+#define new BPPCELL_NO_HEAP_forbids_new
+#define delete BPPCELL_NO_HEAP_forbids_delete
+#define malloc BPPCELL_NO_HEAP_forbids_malloc
+#define calloc BPPCELL_NO_HEAP_forbids_calloc
+#define realloc BPPCELL_NO_HEAP_forbids_realloc
+
+#endif
+
+/* Bounded text output
+ * A Print that writes into a caller-supplied char array, which is always null-terminated. Text that does not fit is
+ * dropped, and isTruncated() reports it. The buffer-based APIs build their text with one of these.
+ */
+class TextWriter : public Print {
+	public:
+		TextWriter(char *buffer, int size);
+		size_t write(uint8_t c);
+		using Print::write;
+		void printFixed(float value, byte decimals = 2);
+		int length();
+		bool isTruncated();
+
+	private:
+		char *_buffer;
+		int _size;
+		int _length;
+		bool _truncated;
+};
 
 struct DMSCoords {
 	int latDegs;
@@ -62,14 +173,50 @@ struct DecDegsCoords {
 	float lonMant; // Mantissa (decimal part) of the longitude
 };
 
+/* Packed fix record
+ * A 16-byte, heap-free, trivially copyable copy of the contents of a GPSCoords, for keeping many fixes in RAM.
+ * Latitude and longitude keep full precision; altitude is rounded to the meter and HDOP to the tenth.
+ */
+struct PackedFix {
+	int32_t lat; // Ten-thousandths of a minute
+	int32_t lon; // Ten-thousandths of a minute
+	uint32_t millisOfDay : 27; // Milliseconds since midnight UTC, or TIME_UNKNOWN
+	uint32_t fixQuality : 3; // GGA fix quality indicator
+	uint32_t reserved : 2;
+	int32_t alt : 18; // Meters above mean sea level
+	uint32_t numSatellites : 5; // Saturates at 31
+	uint32_t hdopTenths : 9; // HDOP in tenths; saturates at HDOP_MAX (51.0), or HDOP_UNKNOWN
+
+	const static uint32_t TIME_UNKNOWN = 0x7FFFFFFUL; // No time; past the end of any day, which fits in 27 bits
+	const static int HDOP_MAX = 510;
+	const static int HDOP_UNKNOWN = 511;
+};
+
+static_assert(sizeof(PackedFix) == 16, "PackedFix must stay 16 bytes");
+static_assert(__is_trivially_copyable(PackedFix), "PackedFix must be copyable with memcpy");
+
 class GPSCoords {
 	public:
+#ifndef BPPCELL_NO_HEAP
 		GPSCoords(String time, long lat, long lon, float alt);
 		void setTime(String time);
+		String getTime();
+		String formatCoordsForText(int format);
+		String getFormattedTimeString();
+		String getDecDegsLatString(void);
+		String getDecDegsLonString(void);
+		String getDecDegsLatString(DecDegsCoords);
+		String getDecDegsLonString(DecDegsCoords);
+		static unsigned long parseMillisOfDay(String time);
+#endif
+		GPSCoords(const char *time, long lat, long lon, float alt);
+		GPSCoords(const PackedFix &fix);
+		void setTime(const char *time);
 		void setLat(long lat);
 		void setLon(long lon);
 		void setAlt(float Alt);
-		String getTime();
+		int getTime(char *buffer, int size);
+		bool hasTime();
 		long getLat();
 		long getLon();
 		float getAlt();
@@ -77,87 +224,467 @@ class GPSCoords {
 		const static long TEN_THOUSANDTHS_PER_MINUTE = 10000;
 		const static int SECONDS_PER_MINUTE = 60;
 		const static long TEN_THOUSANDTHS_PER_DEGREE = TEN_THOUSANDTHS_PER_MINUTE * MINUTES_PER_DEGREE;
-		String formatCoordsForText(int format);
-		String getFormattedTimeString();
+		int formatCoordsForText(int format, char *buffer, int size);
+		int getFormattedTimeString(char *buffer, int size);
 		DMSCoords getLatLonInDMS();
 		DecDegsCoords getLatLonInDecDegs();
-		String getDecDegsLatString(void);
-		String getDecDegsLonString(void);
-		String getDecDegsLatString(DecDegsCoords);
-		String getDecDegsLonString(DecDegsCoords);
-		
+		int getDecDegsLatString(char *buffer, int size);
+		int getDecDegsLonString(char *buffer, int size);
+		int getDecDegsLatString(DecDegsCoords coords, char *buffer, int size);
+		int getDecDegsLonString(DecDegsCoords coords, char *buffer, int size);
+		long distanceTo(GPSCoords &other);
+		long bearingTo(GPSCoords &other);
+		GPSCoords offsetBy(long north, long east);
+		void setFixQuality(byte fixQuality);
+		void setNumSatellites(byte numSatellites);
+		void setHDOP(int hdop);
+		byte getFixQuality();
+		byte getNumSatellites();
+		int getHDOP();
+		bool isValid();
+		unsigned long getMillisOfDay();
+		PackedFix toPackedFix();
+		static unsigned long parseMillisOfDay(const char *time);
+		static int formatMillisOfDay(unsigned long millisOfDay, char *buffer, int size);
+
 		// Specify the various formats
-		const static int FORMAT_DMS = 1; // Degrees, minutes, and seconds; multiple lines
-		const static int FORMAT_DMS_ONELINE = 2; // Degrees, minutes, and seconds; one line
-		const static int FORMAT_DMS_CSV = 3; // Degrees, minutes, and seconds; comma-separated on one line
-		const static int FORMAT_DEC_DEGS = 4; // Decimal degrees; multiple lines
-		const static int FORMAT_DEC_DEGS_CSV = 5; // Decimal degrees; comma-separated on one line
+		const static int FORMAT_DMS = LogFormat::DMS; // Degrees, minutes, and seconds; multiple lines
+		const static int FORMAT_DMS_ONELINE = LogFormat::DMS_ONELINE; // Degrees, minutes, and seconds; one line
+		const static int FORMAT_DMS_CSV = LogFormat::DMS_CSV; // Degrees, minutes, and seconds; comma-separated on one line
+		const static int FORMAT_DEC_DEGS = LogFormat::DEC_DEGS; // Decimal degrees; multiple lines
+		const static int FORMAT_DEC_DEGS_CSV = LogFormat::DEC_DEGS_CSV; // Decimal degrees; comma-separated on one line
+		
+		// GGA fix quality indicator values (field 6). See UBlox documentation for further details.
+		const static byte FIX_INVALID = 0;
+		const static byte FIX_GPS = 1;
+		const static byte FIX_DGPS = 2;
+		const static byte FIX_DEAD_RECKONING = 6;
+		const static int HDOP_UNKNOWN = 9999; // 99.99, the largest HDOP a GGA string can carry
+		const static unsigned long MILLIS_PER_DAY = 86400000;
+		const static unsigned long TIME_UNKNOWN = 0xFFFFFFFFUL; // The time of a fix whose GGA sentence had none
+		const static int TIME_SIZE = 11; // Longest time getTime() gives (hhmmss.sss), plus the null; further digits are dropped
+		const static int TEXT_SIZE = 161; // Longest text formatCoordsForText() produces, plus the null; one SMS
 	
 	private:
-		String _time;
+		unsigned long _millisOfDay; // Milliseconds since midnight UTC, parsed once from the $GPGGA format; or TIME_UNKNOWN
+		byte _timeDecimals; // Fractional digits the time was given with (0 to 3), so getTime() gives it back as it came
 		long _lat; //Stored in ten-thousandths of a minute (minute * 10^-4)
 		long _lon; //Stored in ten-thousandths of a minute (minute * 10^-4)
 		float _alt; // Stored in meters above mean sea level
+		byte _fixQuality; // GGA fix quality indicator
+		byte _numSatellites; // Number of satellites used in the fix
+		int _hdop; // Horizontal dilution of precision, in hundredths
+		static void printTime(Print &out, unsigned long millisOfDay, byte decimals, bool colons);
+};
+
+// The fixed divisions GPSCoords makes, each over the range of dividends it is applied to (see FixedDivisor.h)
+typedef FixedDivisor<GPSCoords::TEN_THOUSANDTHS_PER_DEGREE, 0x7FFFFFFFUL> DegreeDivisor; // Any non-negative long
+typedef FixedDivisor<GPSCoords::TEN_THOUSANDTHS_PER_MINUTE, GPSCoords::TEN_THOUSANDTHS_PER_DEGREE - 1> MinuteDivisor;
+typedef FixedDivisor<3600000, 0x7FFFFFFUL> HourMillisDivisor; // Any 27-bit PackedFix::millisOfDay
+typedef FixedDivisor<60000, 3600000 - 1> MinuteMillisDivisor;
+typedef FixedDivisor<1000, 60000 - 1> SecondMillisDivisor;
+typedef FixedDivisor<10, 1000 - 1> TenDivisor;
+
+/* Fix history ring
+ * Keeps the most recent fixes in a caller-supplied array of PackedFix, overwriting the oldest when full.
+ * On a Mega, a few hundred entries (16 bytes each) fit comfortably alongside the rest of a sketch.
+ */
+class FixHistory {
+	public:
+		FixHistory(PackedFix *buffer, int capacity);
+		void push(const PackedFix &fix);
+		void push(GPSCoords &coords);
+		bool get(int age, PackedFix &fix);
+		int getCount();
+		int getCapacity();
+		void clear();
+	
+	private:
+		PackedFix *_buffer;
+		int _capacity;
+		int _count;
+		int _next; // Index the next fix will be written to
+};
+
+/* Fixed-point geodesic kernels
+ * Angles are in ten-thousandths of a minute (the GPSCoords unit), distances in meters, bearings in hundredths of a
+ * degree clockwise from true north, and trigonometric results in Q15 (32768 = 1.0). Everything is integer; the
+ * trigonometric functions interpolate PROGMEM tables. Distances use a sphere of one nautical mile per minute of arc.
+ */
+class GeoMath {
+	public:
+		static int cosQ15(long angle);
+		static int sinQ15(long angle);
+		static long atan2Bearing(long east, long north);
+		static unsigned long isqrt(unsigned long value);
+		static long toMeters(long delta);
+		static long fromMeters(long meters);
+		static long mulQ15(long value, int factorQ15);
+		static long wrapLon(long lon);
+		static void displacement(long lat1, long lon1, long lat2, long lon2, long &north, long &east);
+		static long equirectangularDistance(long lat1, long lon1, long lat2, long lon2);
+		static long haversineDistance(long lat1, long lon1, long lat2, long lon2);
+		static long distance(long lat1, long lon1, long lat2, long lon2);
+
+		const static long QUARTER_TURN = 90 * GPSCoords::TEN_THOUSANDTHS_PER_DEGREE; // 90 degrees, in ten-thousandths of a minute
+		const static long HALF_TURN = 2 * QUARTER_TURN;
+		const static long FULL_TURN = 4 * QUARTER_TURN;
+		const static long EQUIRECTANGULAR_LIMIT = GPSCoords::TEN_THOUSANDTHS_PER_DEGREE; // distance() switches to haversine beyond one degree of arc
+		const static long EQUIRECTANGULAR_LON_LIMIT = 6 * GPSCoords::TEN_THOUSANDTHS_PER_DEGREE; // Or six degrees of longitude, about one degree of arc at 80 degrees of latitude
+		const static long METERS_PER_TEN_THOUSANDTH_Q16 = 12137; // 0.1852 m (one ten-thousandth of a nautical mile) in Q16
+		const static long TEN_THOUSANDTHS_PER_METER_Q12 = 22117; // 5.39957 (1 / 0.1852) in Q12
+		const static long EARTH_DIAMETER = 12733407; // Meters; the diameter of a sphere with one nautical mile per minute of arc
+		const static long SMALL_ANGLE_LIMIT = 30 * GPSCoords::TEN_THOUSANDTHS_PER_DEGREE; // sinQ15() uses a series below 30 degrees
+		const static long RADIANS_Q15_PER_TEN_THOUSANDTH_Q26 = 63967; // 2^15 * pi / (180 * 600000), in Q26
+		const static int COS_TABLE_SHIFT = 19; // The cosine table has one entry per 2^19 ten-thousandths of a minute (~0.874 degrees)
+		const static int ATAN_TABLE_SHIFT = 9; // The arctangent table has one entry per 2^9 / 2^15 (1/64) of tangent
+};
+
+#ifndef GEOFENCE_MAX_FENCES
+#define GEOFENCE_MAX_FENCES 16 // The most fences a Geofence can hold; define before including BPPCell.h to change
+#endif
+
+// A polygon vertex in ten-thousandths of a minute
+struct GeofencePoint {
+	long lat;
+	long lon;
+};
+
+/* A precomputed polygon edge, oriented so that latLow < latHigh. Horizontal edges are dropped since they can never
+ * be crossed by the ray used for containment. Arrays of these may be kept in PROGMEM; see Geofence::printEdgeTable().
+ */
+struct GeofenceEdge {
+	long latLow; // Latitude of the southern end
+	long latHigh; // Latitude of the northern end
+	long lonLow; // Longitude of the southern end
+	long lonHigh; // Longitude of the northern end
+	long dLat; // latHigh - latLow; with dLon, the slope of the edge
+	long dLon; // lonHigh - lonLow
+};
+
+/* Geofence engine
+ * Holds up to GEOFENCE_MAX_FENCES polygons and circles, each with an integer id, and tests fixes against all of them.
+ * Every fence has a bounding box that rejects most fixes with four comparisons; polygons then use an integer
+ * crossing-number test along a ray to the east. Fences must not cross the antimeridian.
+ */
+class Geofence {
+	public:
+		Geofence();
+		bool addPolygon(const GeofenceEdge *edges, int numEdges, int id, bool inProgmem = false);
+		bool addCircle(long lat, long lon, long radius, int id);
+		void clear();
+		int getNumFences();
+		bool fenceContains(int index, long lat, long lon);
+		int firstContaining(GPSCoords &coords);
+		int findContaining(GPSCoords &coords, int *ids, int maxIds);
+		static int precomputeEdges(const GeofencePoint *vertices, int numVertices, GeofenceEdge *edges);
+		static void printEdgeTable(Print &out, const GeofenceEdge *edges, int numEdges, const char *name);
+
+		const static int NO_FENCE = -1; // Returned by firstContaining() when no fence contains the fix
+		const static byte TYPE_POLYGON = 1;
+		const static byte TYPE_CIRCLE = 2;
+
+	private:
+		struct Fence {
+			byte type;
+			bool inProgmem;
+			int id;
+			long latMin; // Bounding box, in ten-thousandths of a minute
+			long latMax;
+			long lonMin;
+			long lonMax;
+			const GeofenceEdge *edges; // Polygons only
+			int numEdges;
+			long centerLat; // Circles only
+			long centerLon;
+			long radius; // Meters
+		};
+		Fence _fences[GEOFENCE_MAX_FENCES];
+		int _numFences;
+		bool polygonContains(Fence &fence, long lat, long lon);
+};
+
+/* Horizontal track smoothing filter
+ * An alpha-beta (position-velocity) filter whose gain is chosen each fix as in a scalar Kalman filter: the measurement
+ * variance comes from the fix's HDOP times the user equivalent range error, and the position variance grows with time
+ * between fixes. Fixes that are invalid, or whose innovation falls outside the gate around the prediction, are
+ * rejected. Constant time and memory per fix; integer arithmetic throughout.
+ */
+class TrackFilter {
+	public:
+		TrackFilter(long uere = DEFAULT_UERE, long processNoise = DEFAULT_PROCESS_NOISE, int gateSigmas = DEFAULT_GATE_SIGMAS);
+		bool update(GPSCoords &coords, unsigned long now);
+		void reset();
+		bool isInitialized();
+		long getLat();
+		long getLon();
+		long getVariance();
+		int getNumRejected();
+		
+		const static long DEFAULT_UERE = 5; // Meters of position error per unit of HDOP
+		const static long DEFAULT_PROCESS_NOISE = 25; // Growth of position variance, in square meters per second
+		const static int DEFAULT_GATE_SIGMAS = 3; // Innovations beyond this many standard deviations are rejected
+		const static int MAX_CONSECUTIVE_REJECTS = 5; // After this many rejections in a row the filter restarts from the next fix
+		const static long MAX_VARIANCE = 10000000; // Square meters; keeps the gate arithmetic within 32 bits
+		const static unsigned long MAX_INTERVAL = 60000; // Milliseconds; a longer gap between fixes restarts the filter
+	
+	private:
+		long _uere;
+		long _processNoise;
+		int _gateSigmas;
+		bool _initialized;
+		unsigned long _lastMillis;
+		long _lat; // Ten-thousandths of a minute
+		long _lon;
+		long _velLat; // Ten-thousandths of a minute per 2^20 ms
+		long _velLon;
+		long _variance; // Position variance, in square meters
+		int _consecutiveRejects;
+		int _numRejected;
+		void initialize(GPSCoords &coords, long measurementVariance, unsigned long now);
+};
+
+/* Adaptive (deadband) reporting policy
+ * Predicts the position the ground station already has by dead-reckoning from the last two fixes sent, and only
+ * asks for a new report once the actual position leaves the error bound around that prediction or the maximum
+ * interval expires. All per-fix arithmetic is integer; bounds are in meters, times are in milliseconds.
+ */
+class DeadbandReporter {
+	public:
+		DeadbandReporter(long horizontalBound, long verticalBound, unsigned long maxInterval, unsigned long minInterval = 0);
+		bool shouldSend(GPSCoords &coords, unsigned long now);
+		void markSent(GPSCoords &coords, unsigned long now);
+		void reset();
+		void setHorizontalBound(long horizontalBound);
+		void setVerticalBound(long verticalBound);
+		void setMaxInterval(unsigned long maxInterval);
+		void setMinInterval(unsigned long minInterval);
+		long getLastHorizontalError();
+		long getLastVerticalError();
+
+		const static long MAX_DELTA_METERS = 24275; // Larger differences are clamped to this, so the sum of squares fits in 32 bits
+
+	private:
+		long _horizontalBound; // Meters
+		long _verticalBound; // Meters
+		unsigned long _maxInterval; // Milliseconds
+		unsigned long _minInterval; // Milliseconds
+		int _numSent; // Number of fixes sent since the last reset, saturating at 2
+		unsigned long _lastSentMillis;
+		long _lastLat; // Last sent fix, in ten-thousandths of a minute
+		long _lastLon;
+		long _lastAlt; // Meters
+		long _velLat; // Velocity between the last two sent fixes, in ten-thousandths of a minute per 2^20 ms
+		long _velLon;
+		long _velAlt; // Meters per 2^20 ms
+		int _cosLatQ15; // Cosine of the last sent latitude in Q15, used to scale longitude to meters
+		long _lastHorizontalError;
+		long _lastVerticalError;
+		long predictAxis(long last, long vel, unsigned long elapsed);
+		static long deltaToMeters(long delta);
+};
+
+/* GPS time base
+ * Maps millis() onto UTC, so that any event (a CSQ sample, an SMS sent, a sensor reading) can be stamped with the
+ * time of day by one multiply-add. Each fix gives a pair of its UTC time and the millis() at which it was read.
+ * Reading only ever adds delay, so the mapping follows the earliest-read fixes: it is anchored at the earliest-read
+ * fix of each window of WINDOW_MILLIS, and its rate, which corrects for the drift of the Arduino's clock, is fitted
+ * across the last NUM_WINDOWS of those anchors. The stamps lag the receiver's epochs by its fastest output latency.
+ */
+class TimeBase {
+	public:
+		TimeBase();
+		void addFix(unsigned long millisOfDay, unsigned long now);
+		void addFix(GPSCoords &coords, unsigned long now);
+		void reset();
+		bool isSynchronized();
+		unsigned long toMillisOfDay(unsigned long now);
+		long getDriftPpm();
+		unsigned long getNumResets();
+
+		const static unsigned long WINDOW_MILLIS = 30000; // Span of millis() over which the earliest-read fix is kept
+		const static byte NUM_WINDOWS = 8; // Windows the rate is fitted over; 4 minutes
+		const static long MAX_STEP = 2000; // Milliseconds; a fix this far from the mapping restarts it
+		const static byte SKEW_SHIFT = 24; // The rate is 1 + _skew / 2^SKEW_SHIFT UTC milliseconds per millis()
+		const static long MAX_SKEW = 167772; // 1%, more than a ceramic resonator drifts; larger fits are discarded
+
+	private:
+		struct Sample {
+			unsigned long local; // millis()
+			unsigned long utc; // Milliseconds of day
+		};
+
+		bool _synchronized;
+		Sample _anchor;
+		long _skew;
+		Sample _windows[NUM_WINDOWS]; // Earliest-read fix of each past window, oldest first from _nextWindow
+		byte _numWindows;
+		byte _nextWindow;
+		Sample _best; // Earliest-read fix of the current window
+		long _bestError; // Milliseconds by which it came before the mapping's prediction
+		unsigned long _windowStart;
+		unsigned long _numResets;
+		void start(unsigned long millisOfDay, unsigned long now);
+		void closeWindow(unsigned long now);
+		static long dayDifference(unsigned long a, unsigned long b);
+};
+
+#ifndef SCHEDULER_MAX_TASKS
+#define SCHEDULER_MAX_TASKS 8 // The most tasks a Scheduler can hold; define before including BPPCell.h to change
+#endif
+
+/* A task runs until it has done one short, non-blocking piece of work, then returns the number of milliseconds until
+ * it next wants to run (0 to run again as soon as possible), or Scheduler::STOP to remove itself.
+ */
+typedef long (*SchedulerTask)(void *context, unsigned long now);
+
+/* Cooperative task scheduler
+ * Each task has a deadline, the time it asked to run next. run() calls the most overdue task once, so a task that
+ * keeps returning 0 cannot starve the others; no task is ever preempted, so none may block for long. The lateness of
+ * each task (how far past its deadline it was called) is tracked to show when one is holding up the rest.
+ */
+class Scheduler {
+	public:
+		Scheduler();
+		int addTask(SchedulerTask task, void *context, unsigned long now, unsigned long delay = 0);
+		void removeTask(int id);
+		void wake(int id, unsigned long now);
+		bool run(unsigned long now);
+		unsigned long getTimeUntilNext(unsigned long now);
+		unsigned long getMaxLateness(int id);
+		int getNumTasks();
+
+		const static long STOP = -1; // Returned by a task to remove itself
+		const static int NO_TASK = -1; // Returned by addTask() when the scheduler is full
+
+	private:
+		SchedulerTask _tasks[SCHEDULER_MAX_TASKS]; // NULL for free slots
+		void *_contexts[SCHEDULER_MAX_TASKS];
+		unsigned long _deadlines[SCHEDULER_MAX_TASKS]; // millis() at which each task next wants to run
+		unsigned long _maxLateness[SCHEDULER_MAX_TASKS]; // Milliseconds
+		int _numTasks;
 };
 
 class NMEAParser {
 	public:
 		NMEAParser();
+#ifndef BPPCELL_NO_HEAP
 		GPSCoords parseCoords(String GGAString);
+		PackedFix parseFix(String GGAString);
+#endif
+		GPSCoords parseCoords(const char *GGAString);
+		PackedFix parseFix(const char *GGAString);
 
 		
 	private:
 
-		long parseLatFromGGA(String latString, bool isNorth);
-		long parseLonFromGGA(String lonString, bool isEast);
+		long parseLatFromGGA(const char *latString, bool isNorth);
+		long parseLonFromGGA(const char *lonString, bool isEast);
+		int parseHundredths(const char *decimalString);
 };
 
-class GNSSComm {
+#ifndef GNSSDEMUX_MAX_HANDLERS
+#define GNSSDEMUX_MAX_HANDLERS 8 // The most handlers a GNSSDemux can hold; define before including BPPCell.h to change
+#endif
+#ifndef GNSSDEMUX_FRAME_SIZE
+#define GNSSDEMUX_FRAME_SIZE 128 // Longest frame a GNSSDemux can hold: an NMEA sentence, or a UBX message of up to 122 payload bytes
+#endif
+
+/* Handlers for GNSSDemux. An NMEA handler gets the sentence from the $ to the checksum, null-terminated (the CR LF
+ * is cut off); a UBX handler gets the payload. Both point into the demultiplexer's frame buffer, so are valid only
+ * until the handler returns.
+ */
+typedef void (*NMEAHandler)(void *context, const char *sentence, int length);
+typedef void (*UBXHandler)(void *context, byte msgClass, byte msgId, const byte *payload, int length);
+// Handler for the raw byte stream of a GNSSComm (setRawHandler()): every byte read, filler included, in order
+typedef void (*RawByteHandler)(void *context, byte b);
+
+/* NMEA and UBX stream demultiplexer
+ * Takes the receiver's byte stream, one byte at a time and in a single pass, frames NMEA sentences and UBX messages
+ * as they come, interleaved in any order, and checks their checksums. Each good frame is dispatched, in place, to
+ * every handler registered for it. A corrupt or overlong frame is dropped and framing starts again at the next $ or
+ * 0xB5 0x62, so one bad byte costs at most the frame it falls in. The receiver's 0xFF filler and nulls are skipped
+ * between frames and within NMEA sentences, which cannot contain them; within a UBX message they are data.
+ * Attach one to a GNSSComm (setDemux()) to have every byte it reads, by any call, fed through it.
+ */
+class GNSSDemux {
 	public:
-	GNSSComm();
-	String getGGAString();
-	String getNextLine();
-	int sendMessageToGNSS(byte* msg, int msgSize);
-	bool configUbloxGNSSFlightMode(byte mode);
-	int getCurrentFlightMode();
-	void appendChecksum(byte* msg, int msgLength);
-	String getMessage(int timeout);
-	void getMessageBytesFromString(String, byte*, int, int);
-	
+		GNSSDemux();
+		bool onNMEA(const char *type, NMEAHandler handler, void *context);
+		bool onUBX(byte msgClass, byte msgId, UBXHandler handler, void *context);
+		void removeHandlers();
+		void feed(byte b);
+		void feed(const byte *data, int length);
+		void reset();
+		static bool isChecksumValid(const char *sentence, int length);
+		unsigned long getNMEACount();
+		unsigned long getUBXCount();
+		unsigned long getErrorCount();
+		void printStats(Print &out);
+		void resetStats();
+
+		const static byte ANY = 0xFF; // As the class or id given to onUBX(), matches every one
+		const static byte MAX_TYPE_LENGTH = 5; // Longest NMEA type onNMEA() takes, e.g. "GGA" or "PUBX"
+
 	private:
-		int _DEFAULT_BYTES_TO_READ;
-		char _BUFFER_CHAR;
-		char _NULL_CHAR;
-		char _NEWLINE;
-		byte _MU_LOWERCASE;
-		byte _B_LOWERCASE;
-		byte _DOLLAR_SIGN;
-		byte _G_UPPERCASE;
-		byte _P_UPPERCASE;
-		char readOneCharFromI2C();
-		String readFromI2C(int bytes);
-		String readFromI2CPretty(int bytes);
-		char consumeBuffer();
-		
-		void consumeCurrentLine();
-		
-		String readUBXMessageFromI2C(int timeout);
-		String readNMEAMessageFromI2C(byte messageTypeId, int timeout);
-	
+		struct Handler {
+			NMEAHandler nmeaHandler; // One of the two is NULL
+			UBXHandler ubxHandler;
+			void *context;
+			char type[MAX_TYPE_LENGTH + 1]; // NMEA type; empty for every sentence
+			byte msgClass;
+			byte msgId;
+		};
+
+		const static byte STATE_IDLE = 0; // Between frames, looking for $ or 0xB5
+		const static byte STATE_NMEA = 1;
+		const static byte STATE_UBX_SYNC = 2; // Had 0xB5; expecting 0x62
+		const static byte STATE_UBX_HEADER = 3; // Class, id and length
+		const static byte STATE_UBX_PAYLOAD = 4; // Payload and checksum
+
+		Handler _handlers[GNSSDEMUX_MAX_HANDLERS];
+		byte _numHandlers;
+		byte _frame[GNSSDEMUX_FRAME_SIZE]; // The frame being assembled: an NMEA sentence from its $, or a UBX message from its class
+		int _length;
+		unsigned int _ubxLength; // Payload length of the UBX message being assembled
+		byte _state;
+		byte _ckA;
+		byte _ckB;
+
+		unsigned long _nmeaFrames;
+		unsigned long _ubxFrames;
+		unsigned long _unhandledFrames; // Good frames no handler took
+		unsigned long _checksumErrors;
+		unsigned long _framingErrors; // Frames cut short by a byte that cannot belong to them
+		unsigned long _overflows; // Frames too long for the buffer
+		unsigned long _discardedBytes; // Bytes outside any frame, other than filler
+
+		void startFrame(byte b);
+		void restart(byte b);
+		void endNMEA();
+		void endUBX();
+		bool matchesNMEA(const Handler &handler, int addressLength);
 };
 
-class CellComm {
+/* Static RAM report
+ * Prints the RAM taken by an instance of each of the library's classes, and by its static data, as a table.
+ */
+class MemoryReport {
 	public:
-		CellComm();
-		void setup();
-		void sendMessage(String number, String message);
-		int getCSQ();
-		int getNumMessages();
-		String getMessage(int index);
-		bool deleteAllMessages();
-		int countOccurences(String stringToSearch, String target, int startingIndex = 0);
-		
-	private:
-		String readSerial();
+		static void print(Print &out);
 };
-#endif
\ No newline at end of file
+
+#include "GNSSComm.h"
+#include "CellComm.h"
+
+// Lifts the heap-free checks for the sketch, but not for the library's own source files
+#if defined(BPPCELL_NO_HEAP) && !defined(BPPCELL_SOURCE)
+#undef String
+#undef new
+#undef delete
+#undef malloc
+#undef calloc
+#undef realloc
+#endif
+
+#endif
@@ -0,0 +1,136 @@
+/* Instrumentation Block for Arduino
+ * Developed for the Space Systems Laboratory at the University of Maryland
+ * Part of the BPPCell library
+ * See GitHub.com/UMDBPP/BPPCell or the accompanying readme for further details.
+ *
+ * Copyright (c) 2015 Luke Renegar
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+
+#define BPPCELL_SOURCE
+#include "Arduino.h"
+#include "BPPCell.h"
+#include <avr/pgmspace.h>
+
+#ifdef BPPCELL_STATS
+
+#ifdef __AVR__
+extern char __heap_start;
+extern char *__brkval;
+#endif
+
+// Short names for the operations in the dump, in BPPCellStats::Op order
+const char OP_NAMES[BPPCellStats::NUM_OPS][5] PROGMEM = { "gga", "gmsg", "gsnd", "csms", "csq", "nmea", "fmt", "log" };
+
+BPPStatOp BPPCellStats::ops[BPPCellStats::NUM_OPS];
+unsigned long BPPCellStats::bytes = 0;
+unsigned long BPPCellStats::transactions = 0;
+unsigned long BPPCellStats::fillerBytes = 0;
+unsigned long BPPCellStats::timeouts = 0;
+unsigned int BPPCellStats::heapHighWater = 0;
+unsigned int BPPCellStats::minFreeMemory = 0;
+
+// Adds one call of op to its totals; called by BPPStatTimer as the operation's scope ends
+void BPPCellStats::record(byte op, unsigned long elapsedMicros, unsigned long bytesMoved) {
+	if(op >= NUM_OPS)
+		return;
+	BPPStatOp &stat = ops[op];
+	if((stat.count == 0) || (elapsedMicros < stat.minMicros))
+		stat.minMicros = elapsedMicros;
+	if(elapsedMicros > stat.maxMicros)
+		stat.maxMicros = elapsedMicros;
+	stat.count++;
+	stat.totalMicros += elapsedMicros;
+	stat.bytes += bytesMoved;
+	sampleHeap();
+}
+
+/* Updates the heap high-water mark and the least free memory.
+ * The String-heavy calls do most of their allocating inside the timed operations, so sampling as each one ends
+ * catches the peaks well enough; call it elsewhere to sample more often.
+ */
+void BPPCellStats::sampleHeap() {
+#ifdef __AVR__
+	char stackTop;
+	char *heapEnd = (__brkval != 0) ? __brkval : &__heap_start;
+	unsigned int heapUsed = heapEnd - &__heap_start;
+	unsigned int freeMemory = &stackTop - heapEnd;
+	if(heapUsed > heapHighWater)
+		heapHighWater = heapUsed;
+	if((minFreeMemory == 0) || (freeMemory < minFreeMemory))
+		minFreeMemory = freeMemory;
+#endif
+}
+
+/* Prints the block as one line, e.g.
+ * STATS gga=12,40312/51234/98211us,9120B csq=12,1020/1204/2210us,96B i2c=341 fill=88 tmo=2 heap=812 free=3120
+ * Each operation that has been called gives count, min/mean/max latency and bytes moved.
+ */
+void BPPCellStats::dump(Print &out) {
+	out.print(F("STATS"));
+	for(byte op = 0; op < NUM_OPS; op++) {
+		BPPStatOp &stat = ops[op];
+		if(stat.count == 0)
+			continue;
+		out.print(' ');
+		for(byte i = 0; i < sizeof(OP_NAMES[op]); i++) {
+			char c = pgm_read_byte(&OP_NAMES[op][i]);
+			if(c == '\0')
+				break;
+			out.print(c);
+		}
+		out.print('=');
+		out.print(stat.count);
+		out.print(',');
+		out.print(stat.minMicros);
+		out.print('/');
+		out.print(stat.totalMicros / stat.count);
+		out.print('/');
+		out.print(stat.maxMicros);
+		out.print(F("us,"));
+		out.print(stat.bytes);
+		out.print('B');
+	}
+	out.print(F(" i2c="));
+	out.print(transactions);
+	out.print(F(" fill="));
+	out.print(fillerBytes);
+	out.print(F(" tmo="));
+	out.print(timeouts);
+	out.print(F(" heap="));
+	out.print(heapHighWater);
+	out.print(F(" free="));
+	out.println(minFreeMemory);
+}
+
+// Clears all counters, e.g. after the startup configuration so that it does not skew the flight figures
+void BPPCellStats::reset() {
+	memset(ops, 0, sizeof(ops));
+	bytes = 0;
+	transactions = 0;
+	fillerBytes = 0;
+	timeouts = 0;
+	heapHighWater = 0;
+	minFreeMemory = 0;
+}
+
+#endif
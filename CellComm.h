@@ -0,0 +1,451 @@
+/* Cellular Communication Library for Arduino and Ublox SARA G350
+ * Developed for the Space Systems Laboratory at the University of Maryland
+ * Part of the BPPCell library
+ * See GitHub.com/UMDBPP/BPPCell or the accompanying readme for further details.
+ *
+ * Copyright (c) 2015 Luke Renegar
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef CellComm_h
+#define CellComm_h
+
+#include "Arduino.h"
+#include "BPPCell.h"
+#include <HardwareSerial.h>
+
+/* BasicCellComm talks to the SARA-G350 through any Stream-like port type with begin(baud) (HardwareSerial,
+ * SoftwareSerial, or a host-side stand-in), fixed at compile time. CellComm is the default, on CELL_SERIAL.
+ */
+template <class Port>
+class BasicCellComm {
+	public:
+		BasicCellComm(Port &port = CELL_SERIAL, long baud = CELL_SERIAL_BAUD);
+#ifndef BPPCELL_NO_HEAP
+		void sendMessage(String number, String message);
+		String getMessage(int index);
+		int countOccurences(String stringToSearch, String target, int startingIndex = 0);
+		bool beginSendMessage(String number, String message, unsigned long now);
+#endif
+		void setup();
+		void sendMessage(const char *number, const char *message);
+		int getCSQ();
+		int getNumMessages();
+		int getMessage(int index, char *buffer, int size);
+		bool deleteAllMessages();
+		int countOccurences(const char *stringToSearch, const char *target, int startingIndex = 0);
+		Port &getPort();
+		bool beginSendMessage(const char *number, const char *message, unsigned long now);
+		bool beginCSQ(unsigned long now);
+		void step(unsigned long now);
+		bool isBusy();
+		byte getResult();
+		int getLastCSQ();
+		
+		const static byte RESULT_OK = 0; // The last command started with a begin method completed
+		const static byte RESULT_ERROR = 1; // The modem answered ERROR, +CMS ERROR or +CME ERROR
+		const static byte RESULT_TIMEOUT = 2; // The modem did not answer in time
+		const static byte RESULT_PENDING = 3; // The command is still in progress
+		const static int CSQ_UNKNOWN = LogFormat::CSQ_UNKNOWN; // As the modem reports when it cannot measure the signal
+		const static unsigned long PROMPT_TIMEOUT = 5000; // Milliseconds to wait for the > prompt after AT+CMGS
+		const static unsigned long SEND_TIMEOUT = 60000; // Milliseconds to wait for the result of sending an SMS
+		const static unsigned long CSQ_TIMEOUT = 1000; // Milliseconds to wait for the result of AT+CSQ
+		const static unsigned long LIST_TIMEOUT = 5000; // Milliseconds getNumMessages() waits for the end of the reply to AT+CMGL
+		const static int SMS_TEXT_SIZE = 161; // Longest text beginSendMessage() keeps, plus the null; one SMS
+		
+	private:
+		Port &_port;
+		long _baud;
+		void readSerial();
+		
+		// State of the command in progress, for step()
+		const static byte STATE_IDLE = 0;
+		const static byte STATE_SMS_PROMPT = 1; // AT+CMGS sent; waiting for >
+		const static byte STATE_SMS_RESULT = 2; // Message sent; waiting for OK
+		const static byte STATE_CSQ = 3; // AT+CSQ sent; waiting for +CSQ and OK
+		const static byte RESPONSE_LENGTH = 48; // Longer response lines are truncated; those step() looks for are short
+		byte _state;
+		byte _result;
+		unsigned long _deadline;
+		int _lastCSQ;
+		char _pendingMessage[SMS_TEXT_SIZE]; // The text to send at the > prompt, null-terminated
+		char _response[RESPONSE_LENGTH + 1]; // The response line being assembled, null-terminated
+		byte _responseLength;
+		void discardInput();
+		void startCommand(byte state, unsigned long now, unsigned long timeout);
+		void handleResponseLine();
+};
+
+typedef BasicCellComm<decltype(CELL_SERIAL)> CellComm; // The modem on CELL_SERIAL
+
+template <class Port>
+BasicCellComm<Port>::BasicCellComm(Port &port, long baud) : _port(port), _baud(baud) {
+	_state = STATE_IDLE;
+	_result = RESULT_OK;
+	_deadline = 0;
+	_lastCSQ = CSQ_UNKNOWN;
+	_pendingMessage[0] = '\0';
+	_response[0] = '\0';
+	_responseLength = 0;
+}
+
+// Call this method after
+template <class Port>
+void BasicCellComm<Port>::setup() {
+	_port.begin(_baud);
+	_port.println(F("AT+CMGF=1")); // Changes io mode to text (cf. hex)
+	delay(50);
+	readSerial();
+}
+
+/* Sends a SMS message.
+ * Input number is the phone number of the recipient.
+ * Input message is the message to be sent
+ */
+template <class Port>
+void BasicCellComm<Port>::sendMessage(const char *number, const char *message) {
+	BPPCELL_STAT_SCOPE(CELL_SEND);
+	readSerial();
+	_port.print(F("AT+CMGS=\""));
+	_port.print(number);
+	_port.println('"');
+	BPPCELL_STAT_BYTES(strlen(number) + 12);
+	delay(20);
+	readSerial();
+	_port.print(message);
+	_port.println(char(0x1A));
+	BPPCELL_STAT_BYTES(strlen(message) + 3);
+	delay(3000);
+	readSerial();
+}
+
+/* Gets the number of messages waiting on the cell module, by counting the +CMGL lines of the reply to AT+CMGL up
+ * to its OK. Returns -1 if the modem answers with an error, or does not finish the reply within LIST_TIMEOUT
+ * milliseconds.
+ */
+template <class Port>
+int BasicCellComm<Port>::getNumMessages() {
+	readSerial(); // Flushes the serial line
+	_port.println(F("AT+CMGL"));
+	BPPCELL_STAT_BYTES(9);
+	
+	int numMessages = 0;
+	char line[11]; // The start of the line being read; enough to tell +CMGL:, OK and the errors apart
+	byte length = 0;
+	unsigned long startTime = millis();
+	while((millis() - startTime) < LIST_TIMEOUT) {
+		int b = _port.read();
+		if(b < 0)
+			continue;
+		BPPCELL_STAT_BYTES(1);
+		if(b != '\n') {
+			if((b != '\r') && (length < sizeof(line) - 1))
+				line[length++] = (char) b;
+			continue;
+		}
+		line[length] = '\0';
+		length = 0;
+		if(strncmp_P(line, PSTR("+CMGL:"), 6) == 0)
+			numMessages++;
+		else if(strcmp_P(line, PSTR("OK")) == 0)
+			return numMessages;
+		else if((strcmp_P(line, PSTR("ERROR")) == 0) || (strncmp_P(line, PSTR("+CMS ERROR"), 10) == 0) || (strncmp_P(line, PSTR("+CME ERROR"), 10) == 0))
+			return -1;
+	}
+	BPPCELL_STAT_TIMEOUT();
+	return -1;
+}
+
+/* Gets the message at the given index, if one exists, into buffer, and returns its length.
+ * Index must be strictly greater than 0 and less than or equal to the number of messages.
+ * If the index is invalid, buffer is left empty. What does not fit in buffer is read but dropped.
+ */
+template <class Port>
+int BasicCellComm<Port>::getMessage(int index, char *buffer, int size) {
+	_port.print(F("AT+CMGR="));
+	_port.println(index);
+	delay(100);
+	TextWriter out(buffer, size);
+	while(_port.available() > 0) {
+		while(_port.available() > 0) {
+			out.print((char) _port.read());
+			BPPCELL_STAT_BYTES(1);
+		}
+		delay(50);
+	}
+	
+	if(strstr_P(buffer, PSTR("+CMS ERROR: invalid memory index")) != NULL) {
+		buffer[0] = '\0';
+		return 0;
+	}
+	return out.length();
+}
+
+/* Deletes all received SMS messages from the cell module.
+ * Returns true if cell module reports successful execution of method,
+ * false otherwise.
+ * A true return result does not necessarily indicate that messages were
+ * deleted, merely that the cell module processed the command.
+ */
+template <class Port>
+bool BasicCellComm<Port>::deleteAllMessages() {
+	_port.println(F("AT+CMGD=1,4"));
+	delay(5);
+	char buffer[64];
+	int available = min(_port.available(), (int) sizeof(buffer) - 1);
+	int length = _port.readBytes(buffer, available);
+	buffer[length] = '\0';
+	if(strstr_P(buffer, PSTR("OK")) != NULL)
+		return true;
+	return false;
+}
+
+// Consumes the output from the cell module on the Serial interface, waiting 10 ms after each character for more.
+template <class Port>
+void BasicCellComm<Port>::readSerial() { 
+    while(_port.available() > 0) {
+      _port.read();
+      BPPCELL_STAT_BYTES(1);
+      delay(10);
+    }
+}
+
+/* Gets the cell signal quality from the cell module
+ * Output is the received signal strength indicator (RSSI)
+ * 0 -> RSSI <= -113 dBm
+ * 1 -> RSSI = -111 dBm
+ * 2..30 -> RSSI = -109 dBm to -53 dBm in 2 dBm increments
+ * 31 -> RSSI >= -51 dBm
+ * 99 -> error
+ * See Ublox documentation on 'AT+CSQ' for more details
+ */
+template <class Port>
+int BasicCellComm<Port>::getCSQ() {
+	BPPCELL_STAT_SCOPE(CELL_CSQ);
+	readSerial(); // Flushes the serial line
+	_port.println(F("AT+CSQ"));
+	BPPCELL_STAT_BYTES(8);
+	int CSQ = _port.parseInt();
+	readSerial();
+	return CSQ;
+}
+
+/* Counts the number of occurences of target in stringToSearch occuring at or after startingIndex.
+ */
+template <class Port>
+int BasicCellComm<Port>::countOccurences(const char *stringToSearch, const char *target, int startingIndex)
+{
+	if(startingIndex > (int) strlen(stringToSearch))
+		return 0;
+	int occurences = 0;
+	const char *found = strstr(stringToSearch + startingIndex, target);
+	while(found != NULL) { // Occurences may overlap
+		occurences++;
+		found = strstr(found + 1, target);
+	}
+	return occurences;
+}
+
+// Gets the port the modem is on
+template <class Port>
+Port &BasicCellComm<Port>::getPort() {
+	return _port;
+}
+
+/* Non-blocking counterpart to sendMessage(), for use from a Scheduler task.
+ * Starts sending the SMS and returns at once; step() then drives the exchange with the modem. Returns false, and
+ * does nothing, if another command is in progress. When isBusy() becomes false, getResult() gives the outcome.
+ */
+template <class Port>
+bool BasicCellComm<Port>::beginSendMessage(const char *number, const char *message, unsigned long now) {
+	if(isBusy())
+		return false;
+	discardInput();
+	_port.print(F("AT+CMGS=\""));
+	_port.print(number);
+	_port.println('"');
+	BPPCELL_STAT_BYTES(strlen(number) + 12);
+	strncpy(_pendingMessage, message, SMS_TEXT_SIZE - 1); // Longer texts are cut to one SMS
+	_pendingMessage[SMS_TEXT_SIZE - 1] = '\0';
+	startCommand(STATE_SMS_PROMPT, now, PROMPT_TIMEOUT);
+	return true;
+}
+
+/* Non-blocking counterpart to getCSQ(); when isBusy() becomes false and getResult() is RESULT_OK, getLastCSQ()
+ * holds the new value, and if the command failed it is CSQ_UNKNOWN. Returns false if another command is in progress.
+ */
+template <class Port>
+bool BasicCellComm<Port>::beginCSQ(unsigned long now) {
+	if(isBusy())
+		return false;
+	discardInput();
+	_port.println(F("AT+CSQ"));
+	BPPCELL_STAT_BYTES(8);
+	startCommand(STATE_CSQ, now, CSQ_TIMEOUT);
+	return true;
+}
+
+/* Handles whatever the modem has sent since the last call, without waiting, and advances the command in progress.
+ * Lines that belong to no command (unsolicited result codes) are read and dropped. Call often while isBusy().
+ */
+template <class Port>
+void BasicCellComm<Port>::step(unsigned long now) {
+	while(_port.available() > 0) {
+		char c = _port.read();
+		BPPCELL_STAT_BYTES(1);
+		if((_state == STATE_SMS_PROMPT) && (c == '>')) { // The prompt has no line ending
+			_port.print(_pendingMessage);
+			_port.print(char(0x1A));
+			BPPCELL_STAT_BYTES(strlen(_pendingMessage) + 1);
+			_pendingMessage[0] = '\0';
+			startCommand(STATE_SMS_RESULT, now, SEND_TIMEOUT);
+			_responseLength = 0;
+		}
+		else if(c == '\n') {
+			_response[_responseLength] = '\0';
+			if(_responseLength > 0)
+				handleResponseLine();
+			_responseLength = 0;
+		}
+		else if((c != '\r') && (_responseLength < RESPONSE_LENGTH)) {
+			_response[_responseLength++] = c;
+		}
+	}
+	if((_state != STATE_IDLE) && ((long) (now - _deadline) >= 0)) {
+		BPPCELL_STAT_TIMEOUT();
+		if(_state == STATE_CSQ) // A stale value would pass for the current one
+			_lastCSQ = CSQ_UNKNOWN;
+		_pendingMessage[0] = '\0';
+		_result = RESULT_TIMEOUT;
+		_state = STATE_IDLE;
+	}
+}
+
+// True while a command started with a begin method is in progress
+template <class Port>
+bool BasicCellComm<Port>::isBusy() {
+	return _state != STATE_IDLE;
+}
+
+// Gets the outcome of the last command started with a begin method; one of the RESULT constants
+template <class Port>
+byte BasicCellComm<Port>::getResult() {
+	if(isBusy())
+		return RESULT_PENDING;
+	return _result;
+}
+
+// Gets the signal quality from the last beginCSQ(), in the same terms as getCSQ(); CSQ_UNKNOWN before the first, or if it failed
+template <class Port>
+int BasicCellComm<Port>::getLastCSQ() {
+	return _lastCSQ;
+}
+
+// Drops anything the modem has sent, without waiting, so that stale output is not taken as a response
+template <class Port>
+void BasicCellComm<Port>::discardInput() {
+	while(_port.available() > 0) {
+		_port.read();
+		BPPCELL_STAT_BYTES(1);
+	}
+	_responseLength = 0;
+}
+
+template <class Port>
+void BasicCellComm<Port>::startCommand(byte state, unsigned long now, unsigned long timeout) {
+	_state = state;
+	_result = RESULT_PENDING;
+	_deadline = now + timeout;
+}
+
+// Acts on one complete line from the modem, held in _response
+template <class Port>
+void BasicCellComm<Port>::handleResponseLine() {
+	if(_state == STATE_IDLE)
+		return;
+	if(strncmp_P(_response, PSTR("+CSQ:"), 5) == 0) {
+		if(_state == STATE_CSQ)
+			_lastCSQ = atoi(_response + 5);
+	}
+	else if(strcmp_P(_response, PSTR("OK")) == 0) {
+		if(_state != STATE_SMS_PROMPT) { // OK before the prompt would be from an earlier command
+			_result = RESULT_OK;
+			_state = STATE_IDLE;
+		}
+	}
+	else if((strcmp_P(_response, PSTR("ERROR")) == 0) || (strncmp_P(_response, PSTR("+CMS ERROR"), 10) == 0) || (strncmp_P(_response, PSTR("+CME ERROR"), 10) == 0)) {
+		if(_state == STATE_CSQ)
+			_lastCSQ = CSQ_UNKNOWN;
+		_pendingMessage[0] = '\0';
+		_result = RESULT_ERROR;
+		_state = STATE_IDLE;
+	}
+}
+
+#ifndef BPPCELL_NO_HEAP
+
+// String counterparts of the methods above
+
+template <class Port>
+void BasicCellComm<Port>::sendMessage(String number, String message) {
+	sendMessage(number.c_str(), message.c_str());
+}
+
+/* Gets the message at the given index, if one exists. 
+ * Index must be strictly greater than 0 and less than or equal to the number of messages.
+ * If the index is invalid, returns the empty string.
+ */
+template <class Port>
+String BasicCellComm<Port>::getMessage(int index) {
+	String command = "AT+CMGR=";
+	command += index;
+	_port.println(command);
+	delay(100);
+	String s = "";
+	while(_port.available() > 0) {
+		char buffer[64];
+		int available = min(_port.available(), (int) sizeof(buffer) - 1);
+		int length = _port.readBytes(buffer, available);
+		buffer[length] = '\0';
+		BPPCELL_STAT_BYTES(length);
+		s += buffer;
+		delay(50);
+	}
+	
+	String errorString = "+CMS ERROR: invalid memory index";
+	if(s.indexOf(errorString) >= 0)
+		return "";
+	return s;
+}
+
+template <class Port>
+int BasicCellComm<Port>::countOccurences(String stringToSearch, String target, int startingIndex)
+{
+	return countOccurences(stringToSearch.c_str(), target.c_str(), startingIndex);
+}
+
+template <class Port>
+bool BasicCellComm<Port>::beginSendMessage(String number, String message, unsigned long now) {
+	return beginSendMessage(number.c_str(), message.c_str(), now);
+}
+
+#endif
+
+#endif
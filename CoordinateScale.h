@@ -0,0 +1,159 @@
+/* Fixed-Point Coordinate Scales for Arduino
+ * Part of the BPPCell library; include BPPCell.h rather than this file.
+ * See GitHub.com/UMDBPP/BPPCell or the accompanying readme for further details.
+ *
+ * A CoordinateScale fixes, at compile time, how many integer units make a degree and the integer type that holds
+ * them, so that precision and cycle cost can be chosen per sketch. Conversion ratios are reduced at compile time,
+ * and NMEA fields are parsed straight from their digits with no floating point. GPSCoords itself keeps
+ * TenThousandthMinuteScale, which the rest of the library (GeoMath, Geofence, ...) works in.
+ */
+
+#ifndef CoordinateScale_h
+#define CoordinateScale_h
+
+#include "Arduino.h"
+
+// Greatest common divisor, for reducing conversion ratios at compile time
+constexpr unsigned long coordinateGcd(unsigned long a, unsigned long b) {
+	return (b == 0) ? a : coordinateGcd(b, a % b);
+}
+
+// The wider of two storage types (A if they are as wide), in which conversions between them are done
+template <class A, class B, bool A_WIDER = (sizeof(A) >= sizeof(B))>
+struct CoordinateWider {
+	typedef A Type;
+};
+
+template <class A, class B>
+struct CoordinateWider<A, B, false> {
+	typedef B Type;
+};
+
+template <unsigned long UNITS_PER_DEGREE_, class Storage = long>
+class CoordinateScale {
+	public:
+		typedef Storage Value;
+
+		static_assert((sizeof(Storage) >= 8) || (UNITS_PER_DEGREE_ <= 11930464UL), "180 degrees must fit in Storage; use long long");
+
+		static constexpr unsigned long UNITS_PER_DEGREE = UNITS_PER_DEGREE_;
+		static constexpr unsigned long MINUTE_DIGITS = 7; // Digits of decimal minutes kept when parsing NMEA; more are dropped
+		static constexpr unsigned long PARSED_UNITS_PER_DEGREE = 600000000; // Minutes to MINUTE_DIGITS decimal places, per degree
+		// Parsed minutes times NMEA_NUMERATOR over NMEA_DENOMINATOR gives units
+		static constexpr unsigned long NMEA_NUMERATOR = UNITS_PER_DEGREE / coordinateGcd(UNITS_PER_DEGREE, PARSED_UNITS_PER_DEGREE);
+		static constexpr unsigned long NMEA_DENOMINATOR = PARSED_UNITS_PER_DEGREE / coordinateGcd(UNITS_PER_DEGREE, PARSED_UNITS_PER_DEGREE);
+
+		static constexpr Value fromDegrees(long degrees) {
+			return (Value) degrees * (Value) UNITS_PER_DEGREE;
+		}
+
+		/* Converts a value in another scale to this one, rounding to the nearest unit. The reduced ratio is applied
+		 * to the quotient and remainder separately, in the wider of the two storage types, and only the result is
+		 * narrowed, so nothing overflows that fits in either scale.
+		 */
+		template <class From>
+		static constexpr Value convertFrom(typename From::Value value) {
+			return (Value) scale<typename CoordinateWider<Value, typename From::Value>::Type>(value,
+				UNITS_PER_DEGREE / coordinateGcd(UNITS_PER_DEGREE, From::UNITS_PER_DEGREE),
+				From::UNITS_PER_DEGREE / coordinateGcd(UNITS_PER_DEGREE, From::UNITS_PER_DEGREE));
+		}
+
+		// From and to ten-thousandths of a minute, the unit of GPSCoords and GeoMath
+		static constexpr Value fromTenThousandths(long value) {
+			return scale<Value>((Value) value, UNITS_PER_DEGREE / coordinateGcd(UNITS_PER_DEGREE, 600000),
+				600000 / coordinateGcd(UNITS_PER_DEGREE, 600000));
+		}
+
+		static constexpr long toTenThousandths(Value value) {
+			return (long) scale<Value>(value, 600000 / coordinateGcd(UNITS_PER_DEGREE, 600000),
+				UNITS_PER_DEGREE / coordinateGcd(UNITS_PER_DEGREE, 600000));
+		}
+
+		static Value parseNMEA(const char *field, byte degreeDigits, bool positive);
+		static bool parseGGA(const char *sentence, Value &lat, Value &lon);
+
+	private:
+		template <class V>
+		static constexpr V roundDiv(V dividend, V divisor) {
+			return (dividend >= 0) ? ((dividend + divisor / 2) / divisor) : -((-dividend + divisor / 2) / divisor);
+		}
+
+		template <class V>
+		static constexpr V scale(V value, unsigned long numerator, unsigned long denominator) {
+			return (value / (V) denominator) * (V) numerator + roundDiv<V>((value % (V) denominator) * (V) numerator, (V) denominator);
+		}
+};
+
+typedef CoordinateScale<600000> TenThousandthMinuteScale; // 1e-4 minute, about 18.5 cm; GPSCoords' own
+typedef CoordinateScale<6000000> HundredThousandthMinuteScale; // 1e-5 minute, about 1.9 cm; the MAX-7Q's high-precision NMEA
+typedef CoordinateScale<10000000> E7DegreeScale; // 1e-7 degree, about 1.1 cm; UBX NAV-POSLLH
+typedef CoordinateScale<1000000000UL, long long> E9DegreeScale; // 1e-9 degree, with 64-bit storage
+
+// A latitude and longitude in a given scale
+template <class Scale>
+struct ScaledCoords {
+	typename Scale::Value lat;
+	typename Scale::Value lon;
+
+	// Reads the position from a GGA sentence; returns false, leaving it unchanged, if the sentence has none
+	bool parseGGA(const char *sentence) {
+		return Scale::parseGGA(sentence, lat, lon);
+	}
+
+	template <class To>
+	ScaledCoords<To> convertTo() const {
+		ScaledCoords<To> converted;
+		converted.lat = To::template convertFrom<Scale>(lat);
+		converted.lon = To::template convertFrom<Scale>(lon);
+		return converted;
+	}
+};
+
+/* Parses an NMEA latitude (ddmm.mmmm, degreeDigits = 2) or longitude (dddmm.mmmm, degreeDigits = 3) field.
+ * Any number of decimal places is accepted; the degrees, whole minutes and decimal minutes are read as integers and
+ * combined with the reduced ratio, rounding to the nearest unit. positive is false for S and W.
+ */
+template <unsigned long UNITS_PER_DEGREE_, class Storage>
+Storage CoordinateScale<UNITS_PER_DEGREE_, Storage>::parseNMEA(const char *field, byte degreeDigits, bool positive) {
+	const char *c = field;
+	long degrees = 0;
+	for(byte i = 0; (i < degreeDigits) && (*c >= '0') && (*c <= '9'); i++, c++)
+		degrees = degrees * 10 + (*c - '0');
+	long minutes = 0;
+	for(byte i = 0; (i < 2) && (*c >= '0') && (*c <= '9'); i++, c++)
+		minutes = minutes * 10 + (*c - '0');
+	long parsedMinutes = minutes * 10000000; // To MINUTE_DIGITS decimal places; at most 599999999
+	if(*c == '.') {
+		c++;
+		for(long place = 1000000; (place > 0) && (*c >= '0') && (*c <= '9'); place /= 10, c++)
+			parsedMinutes += (*c - '0') * place;
+	}
+	Value units = fromDegrees(degrees);
+	if(NMEA_NUMERATOR == 1) // So for every 32-bit scale above, but not E9DegreeScale (5); keeps the arithmetic in 32 bits
+		units += (Value) ((parsedMinutes + (long) (NMEA_DENOMINATOR / 2)) / (long) NMEA_DENOMINATOR);
+	else
+		units += scale<Value>((Value) parsedMinutes, NMEA_NUMERATOR, NMEA_DENOMINATOR);
+	return positive ? units : -units;
+}
+
+/* Reads the latitude and longitude fields (2 to 5) of a GGA sentence. Returns false, leaving lat and lon unchanged,
+ * if the sentence ends before them or the latitude is empty (no fix).
+ */
+template <unsigned long UNITS_PER_DEGREE_, class Storage>
+bool CoordinateScale<UNITS_PER_DEGREE_, Storage>::parseGGA(const char *sentence, Storage &lat, Storage &lon) {
+	const char *fields[6]; // Start of each of fields 0 to 5
+	fields[0] = sentence;
+	for(byte i = 1; i < 6; i++) {
+		const char *comma = strchr(fields[i - 1], ',');
+		if(comma == NULL)
+			return false;
+		fields[i] = comma + 1;
+	}
+	if((fields[2][0] == ',') || (fields[2][0] == '\0'))
+		return false;
+	lat = parseNMEA(fields[2], 2, fields[3][0] != 'S');
+	lon = parseNMEA(fields[4], 3, fields[5][0] != 'W');
+	return true;
+}
+
+#endif
@@ -0,0 +1,168 @@
+/* Adaptive Deadband Reporting for Arduino
+ * Developed for the Space Systems Laboratory at the University of Maryland
+ * Part of the BPPCell library
+ * See GitHub.com/UMDBPP/BPPCell or the accompanying readme for further details.
+ *
+ * Copyright (c) 2015 Luke Renegar
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#define BPPCELL_SOURCE
+#include "Arduino.h"
+#include "BPPCell.h"
+
+/* Creates a reporter.
+ * horizontalBound and verticalBound are the largest tolerated difference, in meters, between the actual position and
+ * the position predicted from the last two fixes sent. maxInterval forces a report after that many milliseconds
+ * regardless of position; minInterval suppresses reports sooner than that many milliseconds after the last one.
+ */
+DeadbandReporter::DeadbandReporter(long horizontalBound, long verticalBound, unsigned long maxInterval, unsigned long minInterval) {
+	setHorizontalBound(horizontalBound);
+	setVerticalBound(verticalBound);
+	_maxInterval = maxInterval;
+	_minInterval = minInterval;
+	reset();
+}
+
+// Forgets all sent fixes; the next call to shouldSend() returns true
+void DeadbandReporter::reset() {
+	_numSent = 0;
+	_lastSentMillis = 0;
+	_lastLat = 0;
+	_lastLon = 0;
+	_lastAlt = 0;
+	_velLat = 0;
+	_velLon = 0;
+	_velAlt = 0;
+	_cosLatQ15 = 32767;
+	_lastHorizontalError = 0;
+	_lastVerticalError = 0;
+}
+
+// Sets the horizontal error bound; unit is meters. Clamped to MAX_DELTA_METERS.
+void DeadbandReporter::setHorizontalBound(long horizontalBound) {
+	if(horizontalBound > MAX_DELTA_METERS)
+		horizontalBound = MAX_DELTA_METERS;
+	if(horizontalBound < 0)
+		horizontalBound = 0;
+	_horizontalBound = horizontalBound;
+}
+
+// Sets the vertical error bound; unit is meters
+void DeadbandReporter::setVerticalBound(long verticalBound) {
+	_verticalBound = verticalBound;
+}
+
+// Sets the longest time between reports; unit is milliseconds
+void DeadbandReporter::setMaxInterval(unsigned long maxInterval) {
+	_maxInterval = maxInterval;
+}
+
+// Sets the shortest time between reports; unit is milliseconds
+void DeadbandReporter::setMinInterval(unsigned long minInterval) {
+	_minInterval = minInterval;
+}
+
+// Gets the horizontal error computed by the last call to shouldSend(); unit is meters
+long DeadbandReporter::getLastHorizontalError() {
+	return _lastHorizontalError;
+}
+
+// Gets the vertical error computed by the last call to shouldSend(); unit is meters
+long DeadbandReporter::getLastVerticalError() {
+	return _lastVerticalError;
+}
+
+/* Decides whether coords should be reported at time now (milliseconds, e.g. from millis()).
+ * Returns true if nothing has been sent yet, if the maximum interval has expired, or if the position differs from the
+ * dead-reckoned prediction by more than either error bound. Never returns true within the minimum interval of the
+ * last report. Call markSent() once the report has actually gone out.
+ */
+bool DeadbandReporter::shouldSend(GPSCoords &coords, unsigned long now) {
+	if(_numSent == 0)
+		return true;
+	
+	unsigned long elapsed = now - _lastSentMillis;
+	if(elapsed < _minInterval)
+		return false;
+	if(elapsed >= _maxInterval)
+		return true;
+	
+	long dLat = coords.getLat() - predictAxis(_lastLat, _velLat, elapsed);
+	long dLon = GeoMath::wrapLon(coords.getLon() - predictAxis(_lastLon, _velLon, elapsed));
+	
+	long north = deltaToMeters(dLat);
+	long east = GeoMath::mulQ15(deltaToMeters(dLon), _cosLatQ15);
+	
+	// Compare squares so that no square root is needed; both terms are below MAX_DELTA_METERS, so the sum fits
+	unsigned long errorSquared = (unsigned long) (north * north) + (unsigned long) (east * east);
+	unsigned long boundSquared = (unsigned long) (_horizontalBound * _horizontalBound);
+	_lastHorizontalError = (north > east) ? (north + east / 2) : (east + north / 2); // Approximate magnitude, for diagnostics only
+	
+	long alt = (long) coords.getAlt();
+	long dAlt = alt - predictAxis(_lastAlt, _velAlt, elapsed);
+	_lastVerticalError = abs(dAlt);
+	
+	return (errorSquared > boundSquared) || (_lastVerticalError > _verticalBound);
+}
+
+/* Records that coords were reported at time now (milliseconds).
+ * Updates the velocity used for prediction from the difference between this fix and the previously sent one.
+ */
+void DeadbandReporter::markSent(GPSCoords &coords, unsigned long now) {
+	long lat = coords.getLat();
+	long lon = coords.getLon();
+	long alt = (long) coords.getAlt();
+	
+	if(_numSent > 0) {
+		unsigned long dt = now - _lastSentMillis;
+		if(dt > 0) {
+			// The division is 64-bit, but it only runs once per report rather than once per fix
+			_velLat = (long) (((long long) (lat - _lastLat) << 20) / (long) dt);
+			_velLon = (long) (((long long) GeoMath::wrapLon(lon - _lastLon) << 20) / (long) dt); // The short way across the antimeridian
+			_velAlt = (long) (((long long) (alt - _lastAlt) << 20) / (long) dt);
+		}
+	}
+	if(_numSent < 2)
+		_numSent++;
+	
+	_lastSentMillis = now;
+	_lastLat = lat;
+	_lastLon = lon;
+	_lastAlt = alt;
+	
+	_cosLatQ15 = GeoMath::cosQ15(lat); // Longitude is scaled by the cosine of the latitude
+}
+
+// Dead-reckons one axis forward by elapsed milliseconds from the last sent value at the given velocity (per 2^20 ms)
+long DeadbandReporter::predictAxis(long last, long vel, unsigned long elapsed) {
+	return last + (long) (((long long) vel * (long) elapsed) >> 20);
+}
+
+/* Converts a difference in ten-thousandths of a minute of latitude to meters, as an absolute value.
+ * Differences beyond MAX_DELTA_METERS are clamped to it, which exceeds any accepted bound.
+ */
+long DeadbandReporter::deltaToMeters(long delta) {
+	long meters = abs(GeoMath::toMeters(delta));
+	if(meters > MAX_DELTA_METERS)
+		return MAX_DELTA_METERS;
+	return meters;
+}
@@ -2,62 +2,170 @@
 #include <SD.h>
 #include <I2C.h>
 #include <BPPCell.h>
+#include <TimeIndexedLog.h>
+#include <UBXLog.h>
 
 NMEAParser parser;
 CellComm cellComm;
 GNSSComm gnssComm;
+Scheduler scheduler; // Interleaves GNSS reads, logging and modem traffic so that none waits on another
+File dataFile;
+File indexFile;
+TimeIndexedLog fixLog(dataFile, indexFile); // Indexes datalog.txt by time, so logged fixes can be found without scanning the card
+File ubxFile;
+UBXLog ubxLog(ubxFile); // The receiver's UBX output, as it is, in datalog.ubx for post-flight analysis
 
 
 unsigned long lastMillisOfMessage = 0;
 bool sendingMessages = true;
-const String number = ""; // put your cell number here, eg. number = "8001234567";
-long messageTimeInterval = 300000; // In milliseconds; 300000 is 5 minutes; defines how frequenty the program sends messages
+const char number[] = ""; // put your cell number here, eg. number[] = "8001234567";
+long messageTimeInterval = 300000; // In milliseconds; 300000 is 5 minutes; defines the longest time between messages
+long minMessageTimeInterval = 30000; // In milliseconds; defines the shortest time between messages
+long horizontalErrorBound = 500; // In meters; a message is sent early when the payload strays this far from where the ground expects it
+long verticalErrorBound = 300; // In meters; as above, for altitude
 long shutdownTimeInterval = 18000000; // In milliseconds; 18000000 is 5 hours; defines after what period of time the program stops sending messages
+long CSQInterval = 10000; // In milliseconds; how often the signal quality is checked
+long logFlushInterval = 5000; // In milliseconds; how often buffered log lines are written to the SD card
 long startTime; // The start time of the program
+TrackFilter trackFilter; // Smooths the track and rejects invalid or outlying fixes
+TimeBase timeBase; // Maps millis() to UTC, to stamp events that are not fixes
+DeadbandReporter reporter(horizontalErrorBound, verticalErrorBound, messageTimeInterval, minMessageTimeInterval);
+
+int CSQ = 0; // The latest signal quality
+unsigned long lastCSQMillis = 0;
+bool messageInFlight = false; // True from starting an SMS until the modem reports the result
+PackedFix fixInFlight; // The fix in that SMS, and when it was taken
+unsigned long fixInFlightMillis = 0;
+int cellTaskId;
+
+char ggaString[NMEA_MAX_SENTENCE_LENGTH + 1];
+char coordsString[GPSCoords::TEXT_SIZE]; // Text buffers, so that nothing here uses the heap (see BPPCELL_NO_HEAP)
+
+void handleFix(const char *ggaString, unsigned long now) {
+    GPSCoords coords = parser.parseCoords(ggaString);
+    timeBase.addFix(coords, now);
+    GPSCoords filtered = coords; // The raw fix is what is logged; the filtered one is what is reported
+    bool goodFix = trackFilter.update(filtered, now); // Replaces the position with the filtered one if accepted
+    coords.formatCoordsForText(3, coordsString, sizeof(coordsString));
+
+    Serial3.println(coordsString);
+    Serial3.print(F("CSQ: "));
+    Serial3.println(CSQ);
+
+    if (dataFile && indexFile) {
+        BPPCELL_STAT_SCOPE(LOG_WRITE);
+        fixLog.beginRecord(coords);
+        fixLog.print(coordsString); // Buffered by the SD library until logTask flushes it
+        fixLog.print(',');
+        fixLog.println(CSQ);
+        BPPCELL_STAT_BYTES(strlen(coordsString) + 5); // Measured only with BPPCELL_STATS
+    }
+
+    // If the modem is busy the message is not started, and the next fix tries again
+    if(goodFix && (CSQ > 0) && (CSQ != CellComm::CSQ_UNKNOWN) && !messageInFlight && reporter.shouldSend(filtered, now) && ((now - startTime) < shutdownTimeInterval)) {
+        filtered.formatCoordsForText(2, coordsString, sizeof(coordsString));
+        if (cellComm.beginSendMessage(number, coordsString, now)) {
+            messageInFlight = true;
+            fixInFlight = filtered.toPackedFix();
+            fixInFlightMillis = now;
+            scheduler.wake(cellTaskId, now);
+        }
+    }
+}
+
+// Prints the UTC time at which millis() read now, or ::, before the first fix, on the debug interface
+void printUTC(unsigned long now) {
+    char time[GPSCoords::TIME_SIZE + 2]; // hh:mm:ss.ss
+    GPSCoords::formatMillisOfDay(timeBase.toMillisOfDay(now), time, sizeof(time));
+    Serial3.println(time);
+}
+
+// Reads the GNSS a transaction at a time and handles each GGA sentence as it completes
+long gnssTask(void *, unsigned long now) {
+    int bytesRead = gnssComm.step();
+    if (gnssComm.isGGAReady()) {
+        gnssComm.takeGGA(ggaString, sizeof(ggaString));
+        handleFix(ggaString, now);
+    }
+    if (ubxFile) {
+        ubxLog.step(); // Writes a sector, if one has filled, between reads
+    }
+    return (bytesRead > 0) ? 0 : 50; // Drain the receiver while it has data, then poll every 50 ms
+}
+
+// Drives the modem: finishes the SMS in progress, and otherwise checks the signal quality every CSQInterval
+long cellTask(void *, unsigned long now) {
+    cellComm.step(now);
+    if (cellComm.isBusy()) {
+        return 20;
+    }
+    if (messageInFlight) {
+        messageInFlight = false;
+        if (cellComm.getResult() == CellComm::RESULT_OK) {
+            GPSCoords sent(fixInFlight);
+            reporter.markSent(sent, fixInFlightMillis);
+            lastMillisOfMessage = now;
+            Serial3.print(F("SMS sent at "));
+            printUTC(now);
+        }
+    }
+    CSQ = cellComm.getLastCSQ(); // CSQ_UNKNOWN if the last check failed, which holds messages until one succeeds
+    if ((now - lastCSQMillis) >= (unsigned long) CSQInterval) {
+        cellComm.beginCSQ(now);
+        lastCSQMillis = now;
+        return 20;
+    }
+    return 200;
+}
+
+long logTask(void *, unsigned long now) {
+    if (dataFile && indexFile) {
+        fixLog.flush();
+    }
+    if (ubxFile) {
+        ubxLog.flush();
+        ubxLog.printStats(Serial3); // Overflows mean the card fell behind the receiver
+    }
+    BPPCELL_STAT_DUMP(Serial3); // Latency and byte counters, when BPPCELL_STATS is defined in BPPCell.h; kept out of datalog.txt, whose every line is an indexed fix
+    return logFlushInterval;
+}
 
 void setup() {
     startTime = millis();
     Serial3.begin(9600); // Debug interface
     cellComm.setup(); // Sets up the SARA-G350
-    String ss = gnssComm.getGGAString(); // Gets the current gps coodinates
-    GPSCoords coords = parser.parseCoords(ss);
-    String s = coords.formatCoordsForText(2);
-    cellComm.sendMessage(number, s);
+    gnssComm.getGGA(ggaString, sizeof(ggaString)); // Gets the current gps coodinates
+    GPSCoords coords = parser.parseCoords(ggaString);
+    coords.formatCoordsForText(2, coordsString, sizeof(coordsString));
+    cellComm.sendMessage(number, coordsString);
+    reporter.markSent(coords, millis());
     const int chipSelect = 4; // pPn for SPI
-    SD.begin(chipSelect); // 
+    SD.begin(chipSelect); //
+    dataFile = SD.open("datalog.txt", FILE_WRITE); // Kept open; logTask flushes it
+    indexFile = SD.open("datalog.idx", FILE_WRITE);
+    if (!dataFile || !indexFile) {
+        Serial3.println(F("error opening datalog.txt"));
+    }
+    else if (!fixLog.begin()) { // The index was damaged by a power loss; it is rebuilt from datalog.txt
+        indexFile.close();
+        SD.remove("datalog.idx");
+        indexFile = SD.open("datalog.idx", FILE_WRITE);
+        fixLog.begin();
+    }
+    ubxFile = SD.open("datalog.ubx", FILE_WRITE);
+    if (ubxFile) {
+        ubxLog.begin();
+        ubxLog.attach(gnssComm);
+        gnssComm.setMessageRate(0x01, 0x06, 1, millis() + 1000); // NAV-SOL at every solution
+        gnssComm.setMessageRate(0x01, 0x30, 1, millis() + 1000); // NAV-SVINFO
+    }
+
+    unsigned long now = millis();
+    scheduler.addTask(gnssTask, NULL, now);
+    cellTaskId = scheduler.addTask(cellTask, NULL, now);
+    scheduler.addTask(logTask, NULL, now, logFlushInterval);
 }
 
 void loop() {
-    Serial3.println("\n");
-    String ggaString = gnssComm.getGGAString();
-    GPSCoords coords = parser.parseCoords(ggaString);
-    String coordsString = coords.formatCoordsForText(3);
-    int CSQ = cellComm.getCSQ();
-
-    Serial3.println(coordsString);
-
-    File dataFile = SD.open("datalog.txt", FILE_WRITE);
-
-    if (dataFile) {
-        String logString = "";
-        logString += coordsString;
-        logString += ",";
-        logString += CSQ;
-        dataFile.println(logString);
-    }
-    else {
-        Serial3.println("error opening datalog.txt");
-    }  
-    Serial3.print("CSQ: ");
-    Serial3.println(CSQ);
-    
-       
-    coordsString = coords.formatCoordsForText(2);
-    
-    if((CSQ > 0 && (millis() - lastMillisOfMessage) > messageTimeInterval) && ((millis() - startTime) < shutdownTimeInterval) {
-        cellComm.sendMessage(number, coordsString);
-        lastMillisOfMessage = millis();
-    }
-    dataFile.close();
-    Serial3.println("\n");
+    scheduler.run(millis());
 }
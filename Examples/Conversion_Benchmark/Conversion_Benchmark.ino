@@ -0,0 +1,91 @@
+#include <BPPCell.h>
+
+// Times the divisions by constants used in unit conversion, libgcc's / and % against FixedDivisor, and the
+// GPSCoords conversions built on them, and checks that both give the same results.
+// Results, in CPU cycles per call, are printed on Serial (USB).
+
+const long iterations = 2000;
+volatile unsigned long sink; // Keeps the compiler from discarding the results
+
+// A spread of dividends, so neither method is timed on one value only
+unsigned long dividend(long i, unsigned long max) {
+    return (unsigned long) ((i * 1103515245UL + 12345UL) % (max + 1));
+}
+
+void printCycles(const char *name, unsigned long elapsedMicros) {
+    Serial.print(name);
+    Serial.print(": ");
+    Serial.print((float) elapsedMicros * (F_CPU / 1000000UL) / iterations);
+    Serial.println(" cycles");
+}
+
+void benchmarkDivision() {
+    unsigned long start = micros();
+    for (long i = 0; i < iterations; i++) {
+        unsigned long x = dividend(i, 0x7FFFFFFFUL);
+        sink = x / GPSCoords::TEN_THOUSANDTHS_PER_DEGREE + x % GPSCoords::TEN_THOUSANDTHS_PER_DEGREE;
+    }
+    unsigned long libgcc = micros() - start;
+    start = micros();
+    for (long i = 0; i < iterations; i++) {
+        unsigned long x = dividend(i, 0x7FFFFFFFUL);
+        unsigned long remainder;
+        sink = DegreeDivisor::divide(x, remainder) + remainder;
+    }
+    unsigned long fixed = micros() - start;
+    start = micros();
+    for (long i = 0; i < iterations; i++) {
+        sink = dividend(i, 0x7FFFFFFFUL);
+    }
+    unsigned long overhead = micros() - start; // Generating the dividends
+    printCycles("degrees, / and %", libgcc - overhead);
+    printCycles("degrees, FixedDivisor", fixed - overhead);
+}
+
+// Compares every dividend in [0, 600000) and a sample of the rest of the range
+void checkDivision() {
+    unsigned long mismatches = 0;
+    for (unsigned long x = 0; x < GPSCoords::TEN_THOUSANDTHS_PER_DEGREE; x++) {
+        unsigned long remainder;
+        unsigned long quotient = MinuteDivisor::divide(x, remainder);
+        if ((quotient != x / GPSCoords::TEN_THOUSANDTHS_PER_MINUTE) || (remainder != x % GPSCoords::TEN_THOUSANDTHS_PER_MINUTE)) {
+            mismatches++;
+        }
+    }
+    for (long i = 0; i < 100000; i++) {
+        unsigned long x = dividend(i, 0x7FFFFFFFUL);
+        unsigned long remainder;
+        unsigned long quotient = DegreeDivisor::divide(x, remainder);
+        if ((quotient != x / GPSCoords::TEN_THOUSANDTHS_PER_DEGREE) || (remainder != x % GPSCoords::TEN_THOUSANDTHS_PER_DEGREE)) {
+            mismatches++;
+        }
+    }
+    Serial.print("mismatches: ");
+    Serial.println(mismatches);
+}
+
+void benchmarkConversions() {
+    GPSCoords coords("123519.00", 23245678, -45678901, 545.4);
+    unsigned long start = micros();
+    for (long i = 0; i < iterations; i++) {
+        DMSCoords dms = coords.getLatLonInDMS();
+        sink = dms.latDegs;
+    }
+    printCycles("getLatLonInDMS", micros() - start);
+    start = micros();
+    for (long i = 0; i < iterations; i++) {
+        DecDegsCoords decDegs = coords.getLatLonInDecDegs();
+        sink = decDegs.latChar;
+    }
+    printCycles("getLatLonInDecDegs", micros() - start);
+}
+
+void setup() {
+    Serial.begin(115200);
+    checkDivision();
+    benchmarkDivision();
+    benchmarkConversions();
+}
+
+void loop() {
+}
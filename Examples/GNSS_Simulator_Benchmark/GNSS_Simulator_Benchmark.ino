@@ -0,0 +1,248 @@
+#include <I2C.h>
+#include <BPPCell.h>
+#include <GNSSSimulator.h>
+
+// Runs GNSSComm against a simulated receiver at high navigation rates, with UBX interleaved, corrupt bytes, nulls
+// and short reads, and reports the fixes per second, dropped epochs and latency it sustains, and the frames a
+// GNSSDemux recovers from the same stream.
+// Results are printed on Serial (USB).
+
+GNSSSimulator receiver;
+BasicGNSSComm<SimulatedDdcTransport> gnssComm((SimulatedDdcTransport(receiver)));
+NMEAParser parser;
+GNSSDemux demux;
+unsigned long ggaFrames, posllhFrames, acks;
+
+unsigned long phaseLength = 10000; // In milliseconds; how long each test runs
+
+// Calls getGGAString() for phaseLength and counts the fixes that parse as valid
+void runBlocking(int rate) {
+    receiver.setRate(rate);
+    receiver.resetStats();
+    int validFixes = 0;
+    int calls = 0;
+    unsigned long longestCall = 0;
+    unsigned long start = millis();
+    while (millis() - start < phaseLength) {
+        unsigned long callStart = millis();
+        GPSCoords coords = parser.parseCoords(gnssComm.getGGAString());
+        longestCall = max(longestCall, millis() - callStart);
+        calls++;
+        if (coords.isValid()) {
+            validFixes++;
+        }
+    }
+    Serial.print("getGGAString at ");
+    Serial.print(rate);
+    Serial.print(" Hz: calls=");
+    Serial.print(calls);
+    Serial.print(" valid=");
+    Serial.print(validFixes);
+    Serial.print(" longest=");
+    Serial.print(longestCall);
+    Serial.println(" ms");
+    receiver.printStats(Serial);
+}
+
+// Calls step() for phaseLength and counts the GGA sentences it assembles
+void runStepping(int rate) {
+    receiver.setRate(rate);
+    receiver.resetStats();
+    int sentences = 0;
+    unsigned long start = millis();
+    while (millis() - start < phaseLength) {
+        gnssComm.step();
+        if (gnssComm.isGGAReady()) {
+            gnssComm.takeGGA();
+            sentences++;
+        }
+    }
+    Serial.print("step at ");
+    Serial.print(rate);
+    Serial.print(" Hz: GGA=");
+    Serial.println(sentences);
+    receiver.printStats(Serial);
+}
+
+// Calls readGGA() for phaseLength with timeouts of 1 to 20 ms, counts each result and times the worst overshoot
+void runDeadlines(int rate) {
+    receiver.setRate(rate);
+    receiver.resetStats();
+    char gga[NMEA_MAX_SENTENCE_LENGTH + 1];
+    int results[5] = {0};
+    long worstOvershoot = 0; // Microseconds past the timeout; millis() ticks make this up to a millisecond short
+    unsigned long start = millis();
+    for (int i = 0; millis() - start < phaseLength; i++) {
+        long timeout = 1 + i % 20;
+        unsigned long callStart = micros();
+        byte result = gnssComm.readGGA(gga, sizeof(gga), millis() + timeout);
+        long overshoot = (long) (micros() - callStart) - timeout * 1000;
+        results[result]++;
+        worstOvershoot = max(worstOvershoot, overshoot);
+    }
+    Serial.print("readGGA at ");
+    Serial.print(rate);
+    Serial.print(" Hz: ok=");
+    Serial.print(results[BasicGNSSComm<SimulatedDdcTransport>::RESULT_OK]);
+    Serial.print(" timeout=");
+    Serial.print(results[BasicGNSSComm<SimulatedDdcTransport>::RESULT_TIMEOUT]);
+    Serial.print(" partial=");
+    Serial.print(results[BasicGNSSComm<SimulatedDdcTransport>::RESULT_PARTIAL]);
+    Serial.print(" badChecksum=");
+    Serial.print(results[BasicGNSSComm<SimulatedDdcTransport>::RESULT_BAD_CHECKSUM]);
+    Serial.print(" worstOvershoot=");
+    Serial.print(worstOvershoot);
+    Serial.println(" us");
+}
+
+// Calls getMessage() for phaseLength and counts the GGA sentences and UBX messages it returns, timing each fix
+void runMessages(int rate) {
+    receiver.setRate(rate);
+    receiver.resetStats();
+    char text[BasicGNSSComm<SimulatedDdcTransport>::MESSAGE_TEXT_SIZE];
+    int calls = 0;
+    int ggaMessages = 0;
+    int ubxMessages = 0;
+    unsigned long longestFix = 0; // From the end of the last GGA to the end of the next, in milliseconds
+    unsigned long lastFix = millis();
+    unsigned long start = lastFix;
+    while (millis() - start < phaseLength) {
+        gnssComm.getMessage(text, sizeof(text), 1000);
+        calls++;
+        if (strncmp(text, "$GPGGA", 6) == 0) {
+            ggaMessages++;
+            unsigned long now = millis();
+            longestFix = max(longestFix, now - lastFix);
+            lastFix = now;
+        }
+        else if (strncmp(text, "B5 62", 5) == 0) {
+            ubxMessages++;
+        }
+    }
+    Serial.print("getMessage at ");
+    Serial.print(rate);
+    Serial.print(" Hz: calls=");
+    Serial.print(calls);
+    Serial.print(" GGA=");
+    Serial.print(ggaMessages);
+    Serial.print(" UBX=");
+    Serial.print(ubxMessages);
+    Serial.print(" longestFix=");
+    Serial.print(longestFix);
+    Serial.println(" ms");
+    receiver.printStats(Serial);
+}
+
+void countGGA(void *, const char *, int) {
+    ggaFrames++;
+}
+
+void countPosllh(void *, byte, byte, const byte *, int) {
+    posllhFrames++;
+}
+
+void countAck(void *, byte, byte, const byte *, int) {
+    acks++;
+}
+
+// Calls step() for phaseLength with the demultiplexer attached, and counts the frames its handlers receive
+void runDemux(int rate) {
+    receiver.setRate(rate);
+    receiver.resetStats();
+    demux.resetStats();
+    ggaFrames = 0;
+    posllhFrames = 0;
+    gnssComm.setDemux(&demux);
+    unsigned long start = millis();
+    while (millis() - start < phaseLength) {
+        gnssComm.step();
+    }
+    gnssComm.setDemux(NULL);
+    Serial.print("demux at ");
+    Serial.print(rate);
+    Serial.print(" Hz: GGA=");
+    Serial.print(ggaFrames);
+    Serial.print(" NAV-POSLLH=");
+    Serial.println(posllhFrames);
+    demux.printStats(Serial);
+    receiver.printStats(Serial);
+}
+
+// Builds a NAV-POSLLH message with an empty payload and the given length field, checksummed over what it holds
+int posllhFrame(byte *frame, unsigned int lengthField) {
+    const int payloadLength = 28;
+    byte header[] = {0xB5, 0x62, 0x01, 0x02, (byte) lengthField, (byte) (lengthField >> 8)};
+    memcpy(frame, header, sizeof(header));
+    memset(frame + sizeof(header), 0, payloadLength);
+    byte ckA = 0;
+    byte ckB = 0;
+    for (int i = 2; i < (int) sizeof(header) + payloadLength; i++) {
+        ckA += frame[i];
+        ckB += ckA;
+    }
+    frame[sizeof(header) + payloadLength] = ckA;
+    frame[sizeof(header) + payloadLength + 1] = ckB;
+    return sizeof(header) + payloadLength + 2;
+}
+
+// Feeds the demultiplexer messages whose length's high byte has a bit flipped, each followed by a good one, which
+// must still be received; a length read as negative would have run past the frame buffer
+void runCorruptLengths() {
+    byte frame[36];
+    demux.resetStats();
+    posllhFrames = 0;
+    for (int bit = 0; bit < 8; bit++) {
+        int length = posllhFrame(frame, 28 | (0x100 << bit));
+        demux.feed(frame, length);
+        length = posllhFrame(frame, 28);
+        demux.feed(frame, length);
+    }
+    Serial.print("corrupt lengths: NAV-POSLLH=");
+    Serial.print(posllhFrames);
+    Serial.println(" of 8");
+    demux.printStats(Serial);
+}
+
+void setup() {
+    Serial.begin(9600);
+    demux.onNMEA("GGA", countGGA, NULL);
+    demux.onUBX(0x01, 0x02, countPosllh, NULL); // NAV-POSLLH
+    demux.onUBX(0x05, GNSSDemux::ANY, countAck, NULL); // ACK-ACK and ACK-NAK
+
+    // Clean NMEA
+    runBlocking(5);
+    runBlocking(10);
+    runStepping(10);
+    runDeadlines(10);
+
+    // UBX interleaved, with corrupt bytes, nulls and short reads
+    receiver.setOutputs(GNSSSimulator::OUTPUT_GGA | GNSSSimulator::OUTPUT_RMC | GNSSSimulator::OUTPUT_GSV | GNSSSimulator::OUTPUT_UBX_POSLLH);
+    receiver.setCorruption(2, 5);
+    receiver.setMaxBytesPerRead(16);
+    runBlocking(10);
+    runStepping(10);
+    runDeadlines(10);
+    runMessages(10);
+    runDemux(10);
+    runCorruptLengths();
+
+    // Configuration through the simulated receiver's ACKs
+    receiver.setCorruption(0, 0);
+    receiver.setMaxBytesPerRead(DEFAULT_BYTES_TO_READ);
+    bool failed = gnssComm.configUbloxGNSSFlightMode(FLIGHT_MODE);
+    Serial.print("configUbloxGNSSFlightMode: ");
+    Serial.println(failed ? "no ACK" : "ACK");
+    Serial.print("getCurrentFlightMode: ");
+    Serial.println(gnssComm.getCurrentFlightMode());
+
+    // The same ACK, taken by the demultiplexer from the stream step() reads
+    gnssComm.setDemux(&demux);
+    acks = 0;
+    gnssComm.configUbloxGNSSFlightMode(FLIGHT_MODE);
+    Serial.print("ACKs through the demultiplexer: ");
+    Serial.println(acks);
+    gnssComm.setDemux(NULL);
+}
+
+void loop() {
+}
@@ -0,0 +1,76 @@
+#include <I2C.h>
+#include <BPPCell.h>
+#include <SaraG350Emulator.h>
+
+// Runs CellComm against the emulated SARA-G350, so no shield or network is needed, and reports how long each
+// call takes and what the modem saw. Results are printed on Serial (USB), which the emulated modem leaves free.
+
+SaraG350Emulator modem;
+BasicCellComm<SaraG350Emulator> cellComm(modem);
+
+const String number = "8001234567";
+const int messagesToSend = 10;
+unsigned long responseLatency = 20; // In milliseconds; how long the emulated modem takes to answer a command
+unsigned long sendLatency = 2000; // In milliseconds; how long it takes to send an SMS
+
+void printTime(const char *label, unsigned long startMillis) {
+    Serial.print(label);
+    Serial.print(": ");
+    Serial.print(millis() - startMillis);
+    Serial.println(" ms");
+}
+
+void setup() {
+    Serial.begin(9600);
+    modem.setLatency(responseLatency, sendLatency);
+    modem.setCSQ(17);
+
+    unsigned long start = millis();
+    cellComm.setup();
+    printTime("setup", start);
+
+    // Blocking calls
+    start = millis();
+    int CSQ = cellComm.getCSQ();
+    printTime("getCSQ", start);
+    Serial.print("CSQ: ");
+    Serial.println(CSQ);
+
+    start = millis();
+    cellComm.sendMessage(number, "Blocking test message");
+    printTime("sendMessage", start);
+
+    modem.addInboxMessage("+18005550100", "Hello payload");
+    start = millis();
+    String message = cellComm.getMessage(1);
+    printTime("getMessage", start);
+    Serial.println(message);
+
+    // Non-blocking calls, one of which fails
+    modem.failNext(SaraG350Emulator::COMMAND_CMGS);
+    int sent = 0;
+    int failed = 0;
+    start = millis();
+    for (int i = 0; i < messagesToSend; i++) {
+        cellComm.beginSendMessage(number, String("Message ") + i, millis());
+        while (cellComm.isBusy()) {
+            cellComm.step(millis());
+        }
+        if (cellComm.getResult() == BasicCellComm<SaraG350Emulator>::RESULT_OK) {
+            sent++;
+        }
+        else {
+            failed++;
+        }
+    }
+    printTime("beginSendMessage loop", start);
+    Serial.print("Sent: ");
+    Serial.print(sent);
+    Serial.print(", failed: ");
+    Serial.println(failed);
+
+    modem.printStats(Serial);
+}
+
+void loop() {
+}
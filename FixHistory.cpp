@@ -0,0 +1,85 @@
+/* Fix History Ring for Arduino
+ * Developed for the Space Systems Laboratory at the University of Maryland
+ * Part of the BPPCell library
+ * See GitHub.com/UMDBPP/BPPCell or the accompanying readme for further details.
+ *
+ * Copyright (c) 2015 Luke Renegar
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#define BPPCELL_SOURCE
+#include "Arduino.h"
+#include "BPPCell.h"
+
+/* Creates a history that stores up to capacity fixes in buffer.
+ * buffer is not copied, so it must outlive this object.
+ */
+FixHistory::FixHistory(PackedFix *buffer, int capacity) {
+	_buffer = buffer;
+	_capacity = capacity;
+	clear();
+}
+
+// Forgets all stored fixes
+void FixHistory::clear() {
+	_count = 0;
+	_next = 0;
+}
+
+// Stores a fix, overwriting the oldest one if the history is full
+void FixHistory::push(const PackedFix &fix) {
+	if(_capacity <= 0)
+		return;
+	_buffer[_next] = fix;
+	_next++;
+	if(_next >= _capacity)
+		_next = 0;
+	if(_count < _capacity)
+		_count++;
+}
+
+// Packs and stores a fix
+void FixHistory::push(GPSCoords &coords) {
+	push(coords.toPackedFix());
+}
+
+/* Gets a stored fix by age: 0 is the most recent, getCount() - 1 the oldest.
+ * Returns false, leaving fix untouched, if there is no fix of that age.
+ */
+bool FixHistory::get(int age, PackedFix &fix) {
+	if((age < 0) || (age >= _count))
+		return false;
+	int index = _next - 1 - age;
+	if(index < 0)
+		index += _capacity;
+	fix = _buffer[index];
+	return true;
+}
+
+// Gets the number of fixes stored
+int FixHistory::getCount() {
+	return _count;
+}
+
+// Gets the most fixes that can be stored
+int FixHistory::getCapacity() {
+	return _capacity;
+}
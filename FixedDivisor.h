@@ -0,0 +1,68 @@
+/* Division by Constants for Arduino
+ * Part of the BPPCell library; include BPPCell.h rather than this file.
+ * See GitHub.com/UMDBPP/BPPCell or the accompanying readme for further details.
+ *
+ * The AVR has no divide instruction, and a 32-bit / or % is a libgcc loop of several hundred cycles. A FixedDivisor
+ * divides by a compile-time constant with one 32-bit multiply, two shifts and at most one correction, using a
+ * reciprocal derived at compile time for the range of dividends the caller declares. The quotient and remainder are
+ * exactly those of / and %.
+ */
+
+#ifndef FixedDivisor_h
+#define FixedDivisor_h
+
+#include "Arduino.h"
+
+// Floor of the base 2 logarithm, for choosing shifts at compile time
+constexpr byte fixedDivisorLog2(unsigned long value) {
+	return (value < 2) ? 0 : 1 + fixedDivisorLog2(value >> 1);
+}
+
+// Largest total shift, counting down from shift, whose reciprocal times the largest shifted dividend fits in 32 bits
+constexpr byte fixedDivisorShift(unsigned long divisor, unsigned long maxShifted, byte shift) {
+	return ((((1ULL << shift) / divisor) * maxShifted) <= 0xFFFFFFFFULL) ? shift
+		: fixedDivisorShift(divisor, maxShifted, shift - 1);
+}
+
+/* Divides dividends from 0 to MAX_DIVIDEND by DIVISOR.
+ * The dividend is shifted right by PRE_SHIFT (so at most a quarter of the divisor is dropped), multiplied by
+ * MULTIPLIER = floor(2^(PRE_SHIFT + POST_SHIFT) / DIVISOR), the largest reciprocal for which the product cannot
+ * overflow, and shifted right by POST_SHIFT. Both truncations lose less than one in total, so the estimate is the
+ * quotient or one short of it, which the remainder shows.
+ */
+template <unsigned long DIVISOR, unsigned long MAX_DIVIDEND>
+class FixedDivisor {
+	public:
+		static_assert(DIVISOR > 0, "Division by zero");
+
+		static constexpr byte PRE_SHIFT = (fixedDivisorLog2(DIVISOR) >= 2) ? fixedDivisorLog2(DIVISOR) - 2 : 0;
+		static constexpr byte TOTAL_SHIFT = fixedDivisorShift(DIVISOR, MAX_DIVIDEND >> PRE_SHIFT, PRE_SHIFT + 31);
+		static constexpr byte POST_SHIFT = TOTAL_SHIFT - PRE_SHIFT;
+		static constexpr unsigned long MULTIPLIER = (unsigned long) ((1ULL << TOTAL_SHIFT) / DIVISOR);
+
+		static_assert(4ULL * MAX_DIVIDEND < (3ULL << TOTAL_SHIFT), "MAX_DIVIDEND too large for a 32-bit reciprocal");
+
+		// Returns dividend / DIVISOR and sets remainder to dividend % DIVISOR
+		static unsigned long divide(unsigned long dividend, unsigned long &remainder) {
+			unsigned long quotient = ((dividend >> PRE_SHIFT) * MULTIPLIER) >> POST_SHIFT;
+			remainder = dividend - quotient * DIVISOR;
+			if(remainder >= DIVISOR) {
+				quotient++;
+				remainder -= DIVISOR;
+			}
+			return quotient;
+		}
+
+		static unsigned long quotient(unsigned long dividend) {
+			unsigned long unused;
+			return divide(dividend, unused);
+		}
+
+		static unsigned long remainder(unsigned long dividend) {
+			unsigned long result;
+			divide(dividend, result);
+			return result;
+		}
+};
+
+#endif
@@ -0,0 +1,748 @@
+/* GNSS Communication Library for Arduino and Ublox MAX-7Q
+ * Part of the BPPCell library; include BPPCell.h rather than this file.
+ * See GitHub.com/UMDBPP/BPPCell or the accompanying readme for further details.
+ *
+ * BasicGNSSComm is parameterised by a transport policy (see GNSSTransports.h), resolved at compile time, so that the
+ * same code can talk to a receiver over I2C (DDC), a UART, SPI or a host-side stand-in. GNSSComm is the default,
+ * the MAX-7Q on the shield's I2C bus.
+ */
+
+#ifndef GNSSComm_h
+#define GNSSComm_h
+
+#include "Arduino.h"
+#include "BPPCell.h"
+#include "GNSSTransports.h"
+#include "stdlib.h"
+
+template <class Transport>
+class BasicGNSSComm {
+	public:
+	BasicGNSSComm(Transport transport = Transport());
+#ifndef BPPCELL_NO_HEAP
+	String getGGAString();
+	String takeGGA();
+	String getNextLine();
+	String getMessage(int timeout);
+	void getMessageBytesFromString(String, byte*, int, int);
+#endif
+	int getGGA(char *buffer, int size);
+	byte readGGA(char *buffer, int size, unsigned long deadline);
+	int step();
+	bool isGGAReady();
+	int takeGGA(char *buffer, int size);
+	int getNextLine(char *buffer, int size);
+	int sendMessageToGNSS(byte* msg, int msgSize);
+	bool configUbloxGNSSFlightMode(byte mode);
+	byte setFlightMode(byte mode, unsigned long deadline);
+	int getCurrentFlightMode();
+	byte readFlightMode(byte &mode, unsigned long deadline);
+	byte setMessageRate(byte msgClass, byte msgId, byte rate, unsigned long deadline);
+	void appendChecksum(byte* msg, int msgLength);
+	int getMessage(char *buffer, int size, int timeout);
+	byte readMessage(char *buffer, int size, unsigned long deadline);
+	void getMessageBytesFromString(const char *msg, byte *buf, int startByteIndex, int stopByteIndex);
+	void setPollInterval(unsigned long microseconds);
+	void setDemux(GNSSDemux *demux);
+	void setRawHandler(RawByteHandler handler, void *context);
+	Transport &getTransport();
+	
+	const static int MESSAGE_TEXT_SIZE = 200; // Longest text getMessage() gives, plus the null; holds a UBX message of up to 66 bytes
+	const static unsigned int DEFAULT_TIMEOUT = 2000; // Milliseconds allowed to the calls that take no deadline; two epochs at 1 Hz
+	const static unsigned long DEFAULT_POLL_INTERVAL = 1000; // Microseconds between polls of a receiver with nothing to send
+	
+	// Results of the calls that take a deadline
+	const static byte RESULT_OK = 0; // A whole message, whose checksum matched
+	const static byte RESULT_TIMEOUT = 1; // Nothing was received before the deadline
+	const static byte RESULT_PARTIAL = 2; // The deadline came in the middle of a message; the buffer holds what arrived
+	const static byte RESULT_BAD_CHECKSUM = 3; // A whole message, whose checksum did not match (or an NMEA sentence with none)
+	const static byte RESULT_REJECTED = 4; // The receiver answered UBX-ACK-NAK, or the request was not valid to send
+	
+	private:
+		Transport _transport;
+		char _line[NMEA_MAX_SENTENCE_LENGTH + 1]; // The sentence step() is assembling
+		byte _lineLength;
+		char _gga[NMEA_MAX_SENTENCE_LENGTH + 1]; // The last complete GGA sentence, null-terminated
+		bool _ggaReady;
+		unsigned long _pollInterval; // Microseconds
+		unsigned long _lastRequestMicros; // When the last transaction of a deadline-bounded read began
+		unsigned int _microsPerByte; // Bus time per byte, as last measured
+		bool _idle; // The last transaction of a deadline-bounded read has brought no data so far
+		GNSSDemux *_demux; // Fed every byte read, or NULL
+		RawByteHandler _rawHandler; // Called with every byte read, or NULL
+		void *_rawContext;
+		int _DEFAULT_BYTES_TO_READ;
+		char _BUFFER_CHAR;
+		char _NULL_CHAR;
+		char _NEWLINE;
+		byte _MU_LOWERCASE;
+		byte _B_LOWERCASE;
+		byte _DOLLAR_SIGN;
+		byte _G_UPPERCASE;
+		byte _P_UPPERCASE;
+		
+		const static byte RESULT_PENDING = 5; // From assembleByte(): no GGA sentence was completed
+		const static byte TRANSACTION_OVERHEAD = 3; // Byte times a DDC read takes besides its data (address, register, address)
+		const static unsigned long MAX_DEADLINE = 2000000; // Milliseconds; deadlines further off are brought in, so micros() cannot wrap
+		
+		void requestFromTransport(int bytes);
+		byte receiveFromTransport();
+		byte assembleByte(byte b);
+		bool isGGALine();
+		
+		unsigned long toMicrosDeadline(unsigned long deadline);
+		static bool isExpired(unsigned long microsDeadline);
+		bool fetch(unsigned long microsDeadline);
+		int nextByte(unsigned long microsDeadline, bool skipFiller);
+		
+		void consumeCurrentLine(unsigned long microsDeadline);
+		
+		byte readUBXMessageFromI2C(TextWriter &out, unsigned long microsDeadline);
+		byte readNMEAMessageFromI2C(TextWriter &out, byte messageTypeId, unsigned long microsDeadline);
+	
+};
+
+typedef BasicGNSSComm<I2cDdcTransport<> > GNSSComm; // The shield's MAX-7Q on the I2C bus
+
+/**
+ * Initializes the object and attempts to set the GNSS Flight mode to FLIGHT_MODE.	
+ */
+template <class Transport>
+BasicGNSSComm<Transport>::BasicGNSSComm(Transport transport) : _transport(transport) {
+	
+	 _MU_LOWERCASE = 0xB5;
+	 _B_LOWERCASE = 0x62;
+	 _DOLLAR_SIGN = 0x24;
+	 _G_UPPERCASE = 0x47;
+	 _P_UPPERCASE = 0x50;
+	_BUFFER_CHAR = char(BUFFER_CHAR_VALUE);
+	_NULL_CHAR = char(NULL_CHAR_VALUE);
+	_NEWLINE = '\n';
+	_lineLength = 0;
+	_gga[0] = '\0';
+	_ggaReady = false;
+	_pollInterval = DEFAULT_POLL_INTERVAL;
+	_lastRequestMicros = 0;
+	_microsPerByte = 90; // A byte at 100 kHz, until a transaction has been timed
+	_idle = false;
+	_demux = NULL;
+	_rawHandler = NULL;
+	_rawContext = NULL;
+	_transport.begin(); // Once; the transport stays open, so no bytes are lost between calls
+}
+
+#ifndef BPPCELL_NO_HEAP
+
+/* Gets the $GPGGA message from the GPS module
+ * Note: this can be a time-intensive (>1 sec) function, as it waits for the GPS module to send the next one. It
+ * gives up after DEFAULT_TIMEOUT milliseconds, returning the empty string; see readGGA() to choose the deadline.
+ */
+template <class Transport>
+String BasicGNSSComm<Transport>::getGGAString() {
+	char gga[NMEA_MAX_SENTENCE_LENGTH + 1];
+	getGGA(gga, sizeof(gga));
+	return String(gga);
+}
+
+#endif
+
+/* Heap-free counterpart to getGGAString(), and as slow: waits up to DEFAULT_TIMEOUT milliseconds for the next GGA
+ * sentence and copies it into buffer. Returns its length, or 0, leaving buffer empty, if none arrived whole and
+ * intact in that time.
+ */
+template <class Transport>
+int BasicGNSSComm<Transport>::getGGA(char *buffer, int size) {
+	if(readGGA(buffer, size, millis() + DEFAULT_TIMEOUT) != RESULT_OK) {
+		TextWriter out(buffer, size); // Empties it
+		return 0;
+	}
+	return strlen(buffer);
+}
+
+/* Waits for the next GGA sentence until the deadline, a value of millis(), and copies what arrived of it into
+ * buffer. Returns one of the RESULT constants; on RESULT_TIMEOUT buffer is left empty.
+ * Bytes are read as fast as the receiver gives them; while it has nothing to send it is polled every poll interval
+ * (see setPollInterval()), and transactions are cut short to end before the deadline. So the call returns within
+ * a poll interval of the sentence's end, and within a byte or so of the deadline. A sentence already assembled by
+ * step() is not returned; use takeGGA() for that.
+ */
+template <class Transport>
+byte BasicGNSSComm<Transport>::readGGA(char *buffer, int size, unsigned long deadline) {
+	BPPCELL_STAT_SCOPE(GNSS_GGA);
+	unsigned long microsDeadline = toMicrosDeadline(deadline);
+	TextWriter out(buffer, size);
+	_ggaReady = false;
+	_idle = false;
+	int b;
+	while((b = nextByte(microsDeadline, true)) >= 0) {
+		byte result = assembleByte((byte) b);
+		if(result == RESULT_OK) {
+			_ggaReady = false;
+			out.print(_gga);
+			return RESULT_OK;
+		}
+		if(result == RESULT_BAD_CHECKSUM) {
+			out.write((const uint8_t *) _line, _lineLength);
+			return RESULT_BAD_CHECKSUM;
+		}
+	}
+	BPPCELL_STAT_TIMEOUT();
+	if(isGGALine() && (_line[_lineLength - 1] != _NEWLINE)) {
+		out.write((const uint8_t *) _line, _lineLength);
+		return RESULT_PARTIAL;
+	}
+	return RESULT_TIMEOUT;
+}
+
+/* Non-blocking counterpart to getGGAString(), for use from a Scheduler task.
+ * Reads at most one transaction's worth of bytes and assembles them into NMEA sentences; when a GGA sentence
+ * completes with a matching checksum, isGGAReady() becomes true until takeGGA() is called. Returns the number of
+ * data (non-filler) bytes read, so 0 means the receiver has nothing waiting and the caller can back off.
+ */
+template <class Transport>
+int BasicGNSSComm<Transport>::step() {
+	if(_transport.available() == 0)
+		requestFromTransport(DEFAULT_BYTES_TO_READ);
+	int dataBytes = 0;
+	while(_transport.available() > 0) {
+		byte b = receiveFromTransport();
+		if((b == BUFFER_CHAR_VALUE) || (b == NULL_CHAR_VALUE)) {
+			BPPCELL_STAT_FILLER();
+			continue;
+		}
+		dataBytes++;
+		assembleByte(b);
+	}
+	return dataBytes;
+}
+
+// True once step() has assembled a GGA sentence that has not yet been taken
+template <class Transport>
+bool BasicGNSSComm<Transport>::isGGAReady() {
+	return _ggaReady;
+}
+
+/* Copies the last GGA sentence assembled by step() into buffer, in the same form as getGGAString(), and returns
+ * its length. NMEA_MAX_SENTENCE_LENGTH + 1 bytes always hold it.
+ */
+template <class Transport>
+int BasicGNSSComm<Transport>::takeGGA(char *buffer, int size) {
+	_ggaReady = false;
+	TextWriter out(buffer, size);
+	out.print(_gga);
+	return out.length();
+}
+
+// Consumes the current line; as with getNextLine(), none of it is kept, so buffer is left empty
+template <class Transport>
+int BasicGNSSComm<Transport>::getNextLine(char *buffer, int size)
+{
+	TextWriter out(buffer, size);
+	consumeCurrentLine(toMicrosDeadline(millis() + DEFAULT_TIMEOUT));
+	
+	return out.length();
+}
+
+#ifndef BPPCELL_NO_HEAP
+
+// Gets the last GGA sentence assembled by step(), in the same form as getGGAString()
+template <class Transport>
+String BasicGNSSComm<Transport>::takeGGA() {
+	_ggaReady = false;
+	return String(_gga);
+}
+
+template <class Transport>
+String BasicGNSSComm<Transport>::getNextLine()
+{
+	String returnString = "";
+	consumeCurrentLine(toMicrosDeadline(millis() + DEFAULT_TIMEOUT));
+	
+	return returnString;
+}
+
+#endif
+
+/* Adds a data byte to the sentence being assembled. Returns RESULT_OK when it completes a GGA sentence with a
+ * matching checksum, which is copied to _gga for takeGGA(); RESULT_BAD_CHECKSUM when it completes one without, which
+ * is dropped; and RESULT_PENDING otherwise. A completed line stays in _line until the next byte.
+ */
+template <class Transport>
+byte BasicGNSSComm<Transport>::assembleByte(byte b) {
+	if((b == _DOLLAR_SIGN) || (_lineLength >= NMEA_MAX_SENTENCE_LENGTH) || ((_lineLength > 0) && (_line[_lineLength - 1] == _NEWLINE)))
+		_lineLength = 0; // A new sentence, an overlong line that cannot be NMEA and is dropped, or the line after one
+	_line[_lineLength++] = (char) b;
+	if((b != _NEWLINE) || !isGGALine())
+		return RESULT_PENDING;
+	if(!GNSSDemux::isChecksumValid(_line, _lineLength))
+		return RESULT_BAD_CHECKSUM;
+	memcpy(_gga, _line, _lineLength);
+	_gga[_lineLength] = '\0';
+	_ggaReady = true;
+	return RESULT_OK;
+}
+
+// True if the line being assembled has begun as a GGA sentence: $ and a two-letter talker ID (GP, GN, ...), then GGA
+template <class Transport>
+bool BasicGNSSComm<Transport>::isGGALine() {
+	return (_lineLength > 6) && (_line[0] == '$') && (_line[3] == 'G') && (_line[4] == 'G') && (_line[5] == 'A');
+}
+
+template <class Transport>
+int BasicGNSSComm<Transport>::sendMessageToGNSS(byte* msg, int msgLength)
+{
+  BPPCELL_STAT_SCOPE(GNSS_SEND);
+  _transport.wake();
+  delay(100);
+  int bytesSent = _transport.write(msg, msgLength);
+  BPPCELL_STAT_BYTES(msgLength);
+  return bytesSent;
+}
+
+// Asks the transport for more bytes; all reads from the GNSS go through here and receiveFromTransport()
+template <class Transport>
+void BasicGNSSComm<Transport>::requestFromTransport(int bytes)
+{
+	BPPCELL_STAT_TRANSACTION();
+	_transport.requestBytes(bytes);
+}
+
+template <class Transport>
+byte BasicGNSSComm<Transport>::receiveFromTransport()
+{
+	BPPCELL_STAT_BYTES(1);
+	byte b = _transport.receive();
+	if(_demux != NULL)
+		_demux->feed(b);
+	if(_rawHandler != NULL)
+		_rawHandler(_rawContext, b);
+	return b;
+}
+
+/* Converts a deadline, a value of millis(), to a value of micros(). One already past becomes now; one more than
+ * MAX_DEADLINE milliseconds off is brought in to that, so that comparisons with micros() cannot wrap.
+ */
+template <class Transport>
+unsigned long BasicGNSSComm<Transport>::toMicrosDeadline(unsigned long deadline) {
+	long remaining = (long) (deadline - millis());
+	if(remaining < 0)
+		remaining = 0;
+	else if(remaining > (long) MAX_DEADLINE)
+		remaining = MAX_DEADLINE;
+	return micros() + remaining * 1000UL;
+}
+
+template <class Transport>
+bool BasicGNSSComm<Transport>::isExpired(unsigned long microsDeadline) {
+	return (long) (micros() - microsDeadline) >= 0;
+}
+
+/* Fetches more bytes for a deadline-bounded read, once those buffered have been taken. If the last transaction
+ * brought no data, first waits until the poll interval has passed since it began, bytes arrive (on a UART) or the
+ * deadline comes. The transaction is cut short to end before the deadline, at the bus time per byte measured on the
+ * last one. Returns false, having read nothing, once no byte can be read before the deadline.
+ */
+template <class Transport>
+bool BasicGNSSComm<Transport>::fetch(unsigned long microsDeadline) {
+	if(_idle) {
+		unsigned long resume = _lastRequestMicros + _pollInterval;
+		while(((long) (micros() - resume) < 0) && !isExpired(microsDeadline) && (_transport.available() == 0))
+			;
+	}
+	if(_transport.available() > 0)
+		return true;
+	long bytes = (long) (microsDeadline - micros()) / (long) _microsPerByte - TRANSACTION_OVERHEAD;
+	if(bytes < 1)
+		return false;
+	if(bytes > DEFAULT_BYTES_TO_READ)
+		bytes = DEFAULT_BYTES_TO_READ;
+	unsigned long start = micros();
+	requestFromTransport(bytes);
+	_microsPerByte = (micros() - start) / (bytes + TRANSACTION_OVERHEAD) + 1; // Rounded up, so transactions err short
+	_lastRequestMicros = start;
+	_idle = true;
+	return true;
+}
+
+/* Takes the next byte for a deadline-bounded read, fetching more as needed. With skipFiller, the 0xFF filler and
+ * nulls are passed over; otherwise every byte counts as data, as within a UBX message. Returns -1 at the deadline.
+ */
+template <class Transport>
+int BasicGNSSComm<Transport>::nextByte(unsigned long microsDeadline, bool skipFiller) {
+	while(!isExpired(microsDeadline)) {
+		if(_transport.available() == 0) {
+			if(!fetch(microsDeadline))
+				break;
+			continue;
+		}
+		byte b = receiveFromTransport();
+		if(skipFiller && ((b == BUFFER_CHAR_VALUE) || (b == NULL_CHAR_VALUE))) {
+			BPPCELL_STAT_FILLER();
+			continue;
+		}
+		_idle = false;
+		return b;
+	}
+	return -1;
+}
+
+/* Sets how long, in microseconds, the calls that take a deadline wait between polls of a receiver that has nothing
+ * to send (DEFAULT_POLL_INTERVAL to start with). A shorter interval picks up the next message sooner, by up to the
+ * interval, for more bus traffic; a UART transport's bytes are taken as soon as they arrive in any case.
+ */
+template <class Transport>
+void BasicGNSSComm<Transport>::setPollInterval(unsigned long microseconds) {
+	_pollInterval = microseconds;
+}
+
+template <class Transport>
+void BasicGNSSComm<Transport>::appendChecksum(byte* msg, int msgLength)
+{
+
+	byte CK_A = 0;
+	byte CK_B = 0;
+	for(int i = 2; i< (msgLength - 2); i++)
+	{
+		CK_A = CK_A + msg[i];
+		CK_B = CK_B + CK_A;
+	}
+	
+	
+	msg[msgLength - 2] = CK_A;
+	msg[msgLength - 1] = CK_B;
+}
+
+// Reads up to and including the next filler byte, or until the deadline
+template <class Transport>
+void BasicGNSSComm<Transport>::consumeCurrentLine(unsigned long microsDeadline)
+{
+	int current = 0;
+	do {
+		current = nextByte(microsDeadline, false);
+	} while((current >= 0) && (current != BUFFER_CHAR_VALUE));
+}
+
+/* Reads the next message from the GNSS into buffer, as readMessage() does, waiting up to timeout milliseconds.
+ * Returns the length of the text; if nothing arrived, the text is "No message.".
+ */
+template <class Transport>
+int BasicGNSSComm<Transport>::getMessage(char *buffer, int size, int timeout) {
+	if(readMessage(buffer, size, millis() + timeout) == RESULT_TIMEOUT) {
+		TextWriter out(buffer, size);
+		out.print(F("No message."));
+	}
+	return (size > 0) ? strlen(buffer) : 0;
+}
+
+#ifndef BPPCELL_NO_HEAP
+
+// As getMessage(buffer, size, timeout); the text is cut short at MESSAGE_TEXT_SIZE - 1 characters
+template <class Transport>
+String BasicGNSSComm<Transport>::getMessage(int timeout) {
+	char text[MESSAGE_TEXT_SIZE];
+	getMessage(text, sizeof(text), timeout);
+	return String(text);
+}
+
+#endif
+
+/* Reads the next message from the GNSS into buffer, as text: a UBX message as its bytes in hex, separated by
+ * spaces, or an NMEA sentence as it is. What does not fit in buffer is read but dropped. Gives up at the deadline,
+ * a value of millis(), bounded as readGGA() is. Returns one of the RESULT constants; on RESULT_TIMEOUT buffer is
+ * left empty.
+ */
+template <class Transport>
+byte BasicGNSSComm<Transport>::readMessage(char *buffer, int size, unsigned long deadline) {
+	BPPCELL_STAT_SCOPE(GNSS_MESSAGE);
+	unsigned long microsDeadline = toMicrosDeadline(deadline);
+	TextWriter out(buffer, size);
+	_idle = false;
+	byte result = RESULT_TIMEOUT;
+	byte b1 = 0;
+	int b2;
+	while((b2 = nextByte(microsDeadline, true)) >= 0) {
+		if((b1 == _MU_LOWERCASE) && (b2 == _B_LOWERCASE)) { // Check if it is a proprietary UBX message (0xB5 0x62)
+			result = readUBXMessageFromI2C(out, microsDeadline);
+			break;
+		}
+		else if((b1 == _DOLLAR_SIGN) && ((b2 == _G_UPPERCASE) || (b2 == _P_UPPERCASE))) { // Check if it is a GPS ($G) or proprietary U-blox ($P) NMEA message
+			result = readNMEAMessageFromI2C(out, b2, microsDeadline);
+			break;
+		}
+		b1 = b2;
+	}
+	if((result == RESULT_TIMEOUT) || (result == RESULT_PARTIAL))
+		BPPCELL_STAT_TIMEOUT();
+	return result;
+}
+
+/*
+ * Reads one UBX message and writes it to out as text.
+ * Assumes the first two characters (0xB5 0x62) have already been consumed from the bus.
+ * Returns RESULT_OK, RESULT_BAD_CHECKSUM, or RESULT_PARTIAL if the deadline came first.
+ */
+template <class Transport>
+byte BasicGNSSComm<Transport>::readUBXMessageFromI2C(TextWriter &out, unsigned long microsDeadline) {
+	byte header[] = {0xB5, 0x62, 0x00, 0x00, 0x00, 0x00 }; // First two characters and four blank spaces for the rest of the header
+	int headerLength = 6;
+	int currentHeaderByteIndex = 2; // index in the header from which content is unknown, since the first two characters have been consumed
+	
+	// Gets the header of the message
+	while(currentHeaderByteIndex < headerLength) {
+		int b = nextByte(microsDeadline, false);
+		if(b < 0)
+			break;
+		header[currentHeaderByteIndex] = b; // Writes one byte to the header
+		currentHeaderByteIndex++;
+	}
+	
+	// Writes the header to the text
+	for(int i = 0; i < currentHeaderByteIndex; i++) {
+		out.print(header[i], HEX); // In upper case
+		out.print(' ');
+	}
+	if(currentHeaderByteIndex < headerLength)
+		return RESULT_PARTIAL;
+	
+	byte CK_A = 0; // Checksum over the class, ID, length and payload
+	byte CK_B = 0;
+	for(int i = 2; i < headerLength; i++) {
+		CK_A = CK_A + header[i];
+		CK_B = CK_B + CK_A;
+	}
+	unsigned int payloadLength = 256*header[5] + header[4]; // Gets the length of the payload by checking the length bytes, which are in Little Endian order
+	bool checksumMatches = true;
+	
+	for(unsigned int currentPayloadIndex = 0; currentPayloadIndex < payloadLength + 2; currentPayloadIndex++) { // 2 extra bytes for checksum
+		int b = nextByte(microsDeadline, false);
+		if(b < 0)
+			return RESULT_PARTIAL;
+		out.print((byte) b, HEX);
+		out.print(' ');
+		if(currentPayloadIndex < payloadLength) {
+			CK_A = CK_A + b;
+			CK_B = CK_B + CK_A;
+		}
+		else if(b != ((currentPayloadIndex == payloadLength) ? CK_A : CK_B)) {
+			checksumMatches = false;
+		}
+	}
+	return checksumMatches ? RESULT_OK : RESULT_BAD_CHECKSUM;
+}
+
+
+/* Reads one NMEA sentence and writes it to out as it is, with its CR LF.
+ * Assumes the first two characters, $ and messageTypeId (G for gps, P for proprietary), have already been consumed.
+ * Returns RESULT_OK, RESULT_BAD_CHECKSUM (also for a sentence longer than NMEA allows), or RESULT_PARTIAL if the
+ * deadline came first.
+ */
+template <class Transport>
+byte BasicGNSSComm<Transport>::readNMEAMessageFromI2C(TextWriter &out, byte messageTypeId, unsigned long microsDeadline) {
+	byte CR = 0x0D; // Carriage return
+	byte LF = 0x0A; // Line feed
+	
+	char sentence[NMEA_MAX_SENTENCE_LENGTH]; // Kept for the checksum
+	sentence[0] = _DOLLAR_SIGN;
+	sentence[1] = messageTypeId;
+	int length = 2;
+	out.print(sentence[0]);
+	out.print(sentence[1]);
+	
+	// Read bytes until the end of the message or the deadline is reached
+	byte previous = messageTypeId;
+	int b;
+	while((b = nextByte(microsDeadline, true)) >= 0) {
+		out.print((char) b);
+		if(length < NMEA_MAX_SENTENCE_LENGTH)
+			sentence[length] = b;
+		length++;
+		if((previous == CR) && (b == LF)) { // The end of the message
+			if((length > NMEA_MAX_SENTENCE_LENGTH) || !GNSSDemux::isChecksumValid(sentence, length))
+				return RESULT_BAD_CHECKSUM;
+			return RESULT_OK;
+		}
+		previous = b;
+	}
+	return RESULT_PARTIAL;
+}
+
+/* Configures the flight mode of the uBlox GNSS
+ * Returns 0 for successful completion, 1 for unsuccessful completion; times out after 1 second.
+ * Flight mode parameter: 3 for standard, 6 for high-altitude. Refer to uBlox documentation (UBX-CFG-NAV5) for further information.
+ */
+template <class Transport>
+bool BasicGNSSComm<Transport>::configUbloxGNSSFlightMode(byte mode) {
+	return setFlightMode(mode, millis() + 1000) != RESULT_OK;
+}
+
+/* Configures the flight mode of the uBlox GNSS, as configUbloxGNSSFlightMode() does, and waits for the receiver to
+ * acknowledge it until the deadline, a value of millis(). Returns RESULT_OK on ACK-ACK, RESULT_REJECTED on ACK-NAK
+ * or for an invalid mode, and RESULT_TIMEOUT or RESULT_PARTIAL if the deadline came first. Sending, with its 100 ms
+ * wake, comes first and is not cut short.
+ */
+template <class Transport>
+byte BasicGNSSComm<Transport>::setFlightMode(byte mode, unsigned long deadline) {
+	int maxValidMode = 8; // Valid modes are 0-8
+	if(mode > maxValidMode) { // Mode is invalid
+		return RESULT_REJECTED;
+	}
+	static const byte templateMsg[] PROGMEM = {0xB5, 0x62, 0x06, 0x24, 0x24, 0x00, // Message header - NAV5
+				0xFF, 0xFF, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, // Mask, dynamic platform mode (controlled by mode parameter), auto 2D-3D
+				0x16, 0x2C, 0x00, 0x00, 0x05, 0x00, 0xA3, 0x00, // Defualt
+				0xA3, 0x00, 0x64, 0x00, 0x27, 0x01, 0x00, 0x3C, // Default
+				0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // Default, reserved2 and reserved3
+				0x00, 0x00, 0x00, 0x00, // Default, reserved4
+				0x00, 0x00 }; // For the checksum
+	const int msgLength = 44; // Length of the message
+	byte msg[msgLength];
+	memcpy_P(msg, templateMsg, msgLength);
+	int indexOfMode = 8; // Index of the mode in the message
+	msg[indexOfMode] = mode;
+	appendChecksum(msg, msgLength); // Set the checksum of the message
+	sendMessageToGNSS(msg, msgLength); // Send the message to the GNSS
+	
+	// See if the GNSS acknowledges the configuration message; it might transmit other messages first
+	byte result;
+	do {
+		char response[MESSAGE_TEXT_SIZE];
+		result = readMessage(response, sizeof(response), deadline);
+		if(result == RESULT_OK) {
+			if(strstr_P(response, PSTR("B5 62 5 1 2 0 6 24 ")) != NULL) // ACK-ACK for CFG-NAV5, in text; mesage was sent and received
+				return RESULT_OK;
+			if(strstr_P(response, PSTR("B5 62 5 0 2 0 6 24 ")) != NULL) // ACK-NAK for CFG-NAV5
+				return RESULT_REJECTED;
+		}
+	} while((result != RESULT_TIMEOUT) && (result != RESULT_PARTIAL));
+	return result; // No ACK was received
+}
+
+/* Sets how often the receiver outputs a message on the port it is read from (UBX-CFG-MSG): every rate navigation
+ * solutions, or never for 0. E.g. setMessageRate(0x01, 0x06, 1, deadline) for NAV-SOL at every solution. Waits for
+ * the receiver to acknowledge it until the deadline, a value of millis(), and returns as setFlightMode() does.
+ */
+template <class Transport>
+byte BasicGNSSComm<Transport>::setMessageRate(byte msgClass, byte msgId, byte rate, unsigned long deadline) {
+	const int msgLength = 11;
+	byte msg[msgLength] = {0xB5, 0x62, 0x06, 0x01, 0x03, 0x00, msgClass, msgId, rate, 0x00, 0x00}; // Header - CFG-MSG, the message, the rate, and room for the checksum
+	appendChecksum(msg, msgLength);
+	sendMessageToGNSS(msg, msgLength);
+	
+	// See if the GNSS acknowledges the configuration message; it might transmit other messages first
+	byte result;
+	do {
+		char response[MESSAGE_TEXT_SIZE];
+		result = readMessage(response, sizeof(response), deadline);
+		if(result == RESULT_OK) {
+			if(strstr_P(response, PSTR("B5 62 5 1 2 0 6 1 ")) != NULL) // ACK-ACK for CFG-MSG
+				return RESULT_OK;
+			if(strstr_P(response, PSTR("B5 62 5 0 2 0 6 1 ")) != NULL) // ACK-NAK for CFG-MSG
+				return RESULT_REJECTED;
+		}
+	} while((result != RESULT_TIMEOUT) && (result != RESULT_PARTIAL));
+	return result; // No ACK was received
+}
+
+/**
+ * Gets the current flight mode setting of the Ublox GNSS receiver
+ * See Ublox GNSS documentation for the CFG-NAV5 message for return code definitions
+ * Returns -1 if unable to get response from GNSS unit within 1.5 seconds
+ */
+template <class Transport>
+int BasicGNSSComm<Transport>::getCurrentFlightMode() {
+	byte mode;
+	if(readFlightMode(mode, millis() + 1500) != RESULT_OK)
+		return -1; // Error code
+	return mode;
+}
+
+/* Polls the flight mode setting, as getCurrentFlightMode() does, and waits for the response until the deadline, a
+ * value of millis(). Returns one of the RESULT constants; mode is set only on RESULT_OK.
+ */
+template <class Transport>
+byte BasicGNSSComm<Transport>::readFlightMode(byte &mode, unsigned long deadline) {
+	static const byte pollMsg[] PROGMEM = {0xB5, 0x62, 0x06, 0x24, 0x00, 0x00, 0X2A, 0x84}; // Poll request for CFG-NAV5
+	const int msgLength = 8;
+	byte msg[msgLength];
+	memcpy_P(msg, pollMsg, msgLength);
+	sendMessageToGNSS(msg, msgLength); // Send the message to the GNSS
+	
+	// Wait for the GNSS to respond to the CFG-NAV5 request; it might transmit other messages first
+	byte result;
+	do {
+		char response[MESSAGE_TEXT_SIZE];
+		result = readMessage(response, sizeof(response), deadline);
+		if(result == RESULT_OK) {
+			if(strstr_P(response, PSTR("B5 62 6 24 24 0 ")) != NULL) { // The header of the CFG-NAV5 message; this is the poll response
+				byte buf[1] = {0 };
+				getMessageBytesFromString(response, buf, BYTE_OF_FLIGHT_MODE_IN_UBX_CFG_NAV5, BYTE_OF_FLIGHT_MODE_IN_UBX_CFG_NAV5 + 1); // Populate the buffer with the flight mode byte
+				mode = buf[0];
+				return RESULT_OK;
+			}
+			if(strstr_P(response, PSTR("B5 62 5 0 2 0 6 24 ")) != NULL) // ACK-NAK for the poll
+				return RESULT_REJECTED;
+		}
+	} while((result != RESULT_TIMEOUT) && (result != RESULT_PARTIAL));
+	return result;
+}
+
+/**
+ * Gets a subset of the bytes of a UBX message from the space-separated text representation thereof, as getMessage() gives it.
+ * The subset of bytes returned is from startByteIndex, inclusive, to stopByteIndex, exclusive. These indices are zero-indexed and refer to the
+ * space-seperated bytes in the text, not character indices within it.
+ * The bytes are populated in buf, starting at buf[0]. The length of buf must be at least (stopByteIndex - stopByteIndex); violating this condition may result in a buffer overrun.
+ * 
+ */
+template <class Transport>
+void BasicGNSSComm<Transport>::getMessageBytesFromString(const char *msg, byte* buf, int startByteIndex, int stopByteIndex) {
+	const char *current = msg; // Start of the current byte in the text
+	int currentByteIndex = 0; // Index of bytes in the message
+	int currentArrayIndex = 0; // Index in buffer
+	while((currentByteIndex < stopByteIndex) && (*current != '\0')) {
+		if(currentByteIndex >= startByteIndex)
+		{
+			buf[currentArrayIndex] = strtol(current, NULL, 16); // Converts the base-16 text to a numeric value
+			currentArrayIndex++;
+		}
+		
+		const char *nextSpace = strchr(current, ' ');
+		if(nextSpace == NULL)
+			break;
+		current = nextSpace + 1; // Start after the next space
+		currentByteIndex++;
+	}
+}
+
+#ifndef BPPCELL_NO_HEAP
+
+template <class Transport>
+void BasicGNSSComm<Transport>::getMessageBytesFromString(String msg, byte* buf, int startByteIndex, int stopByteIndex) {
+	getMessageBytesFromString(msg.c_str(), buf, startByteIndex, stopByteIndex);
+}
+
+#endif
+
+/* Attaches a demultiplexer, which is then fed every byte read from the receiver, by step() or any blocking call, in
+ * the order read; NULL detaches it. With one attached, calling step() often is enough to have every NMEA sentence
+ * and UBX message the receiver sends, ACKs included, reach the handlers registered with the demultiplexer.
+ */
+template <class Transport>
+void BasicGNSSComm<Transport>::setDemux(GNSSDemux *demux) {
+	_demux = demux;
+}
+
+/* Sets a handler to be called with every byte read from the receiver, as a demultiplexer is fed (see setDemux()),
+ * e.g. by UBXLog to take UBX messages straight from the stream; NULL removes it.
+ */
+template <class Transport>
+void BasicGNSSComm<Transport>::setRawHandler(RawByteHandler handler, void *context) {
+	_rawHandler = handler;
+	_rawContext = context;
+}
+
+// Gets the transport, e.g. to configure it or, on the host, to inspect a stand-in
+template <class Transport>
+Transport &BasicGNSSComm<Transport>::getTransport() {
+	return _transport;
+}
+
+#endif
@@ -0,0 +1,294 @@
+/* NMEA and UBX Stream Demultiplexer for Arduino
+ * Developed for the Space Systems Laboratory at the University of Maryland
+ * Part of the BPPCell library
+ * See GitHub.com/UMDBPP/BPPCell or the accompanying readme for further details.
+ *
+ * Copyright (c) 2015 Luke Renegar
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#define BPPCELL_SOURCE
+#include "Arduino.h"
+#include "BPPCell.h"
+
+#define UBX_SYNC_1 0xB5
+#define UBX_SYNC_2 0x62
+
+GNSSDemux::GNSSDemux() {
+	_numHandlers = 0;
+	reset();
+	resetStats();
+}
+
+/* Registers a handler for NMEA sentences of the given type: the address field after the talker ID ("GGA" for
+ * $GPGGA and $GNGGA), or the whole of it for a proprietary sentence ("PUBX"). NULL or "" registers it for every
+ * sentence. Returns false if all GNSSDEMUX_MAX_HANDLERS slots are taken or the type is too long.
+ */
+bool GNSSDemux::onNMEA(const char *type, NMEAHandler handler, void *context) {
+	if(type == NULL)
+		type = "";
+	if((handler == NULL) || (_numHandlers >= GNSSDEMUX_MAX_HANDLERS) || (strlen(type) > MAX_TYPE_LENGTH))
+		return false;
+	Handler &h = _handlers[_numHandlers++];
+	h.nmeaHandler = handler;
+	h.ubxHandler = NULL;
+	h.context = context;
+	strcpy(h.type, type);
+	h.msgClass = ANY;
+	h.msgId = ANY;
+	return true;
+}
+
+/* Registers a handler for UBX messages of the given class and id; either may be ANY, e.g. onUBX(0x05, ANY, ...)
+ * for both ACK-ACK and ACK-NAK. Returns false if all GNSSDEMUX_MAX_HANDLERS slots are taken.
+ */
+bool GNSSDemux::onUBX(byte msgClass, byte msgId, UBXHandler handler, void *context) {
+	if((handler == NULL) || (_numHandlers >= GNSSDEMUX_MAX_HANDLERS))
+		return false;
+	Handler &h = _handlers[_numHandlers++];
+	h.nmeaHandler = NULL;
+	h.ubxHandler = handler;
+	h.context = context;
+	h.type[0] = '\0';
+	h.msgClass = msgClass;
+	h.msgId = msgId;
+	return true;
+}
+
+void GNSSDemux::removeHandlers() {
+	_numHandlers = 0;
+}
+
+/* Takes the next byte of the stream. Complete frames are dispatched from within this call, so a handler must not
+ * feed the demultiplexer itself.
+ */
+void GNSSDemux::feed(byte b) {
+	switch(_state) {
+		case STATE_IDLE:
+			startFrame(b);
+			break;
+		case STATE_NMEA:
+			if(b == '\n') {
+				endNMEA();
+			}
+			else if((b == '\r') || (b == BUFFER_CHAR_VALUE) || (b == NULL_CHAR_VALUE)) {
+				// Dropped; the sentence ends at the LF, and filler can come between any two bytes of it
+			}
+			else if((b == '$') || (b < 0x20) || (b > 0x7E)) { // Cannot be part of a sentence
+				_framingErrors++;
+				restart(b);
+			}
+			else if(_length >= GNSSDEMUX_FRAME_SIZE - 1) { // Room is kept for the null
+				_overflows++;
+				restart(b);
+			}
+			else {
+				_frame[_length++] = b;
+			}
+			break;
+		case STATE_UBX_SYNC:
+			if(b == UBX_SYNC_2) {
+				_state = STATE_UBX_HEADER;
+				_length = 0;
+				_ckA = 0;
+				_ckB = 0;
+			}
+			else {
+				_discardedBytes++; // The 0xB5 was not a sync
+				restart(b);
+			}
+			break;
+		case STATE_UBX_HEADER:
+			_frame[_length++] = b;
+			_ckA += b;
+			_ckB += _ckA;
+			if(_length == 4) {
+				_ubxLength = _frame[2] | ((unsigned int) _frame[3] << 8); // Little endian; unsigned, so a corrupt high byte cannot make it negative
+				if(_ubxLength > (unsigned int) (GNSSDEMUX_FRAME_SIZE - 6)) { // Class, id, length and checksum besides the payload
+					_overflows++;
+					_state = STATE_IDLE;
+				}
+				else {
+					_state = STATE_UBX_PAYLOAD;
+				}
+			}
+			break;
+		case STATE_UBX_PAYLOAD:
+			_frame[_length++] = b;
+			if((unsigned int) _length <= _ubxLength + 4) {
+				_ckA += b;
+				_ckB += _ckA;
+			}
+			else if((unsigned int) _length == _ubxLength + 6) {
+				endUBX();
+			}
+			break;
+	}
+}
+
+void GNSSDemux::feed(const byte *data, int length) {
+	for(int i = 0; i < length; i++)
+		feed(data[i]);
+}
+
+// Drops any partly assembled frame, e.g. after the receiver has been reset
+void GNSSDemux::reset() {
+	_state = STATE_IDLE;
+	_length = 0;
+	_ubxLength = 0;
+	_ckA = 0;
+	_ckB = 0;
+}
+
+// Starts a frame if b can begin one; otherwise passes over it
+void GNSSDemux::startFrame(byte b) {
+	if(b == '$') {
+		_frame[0] = b;
+		_length = 1;
+		_state = STATE_NMEA;
+	}
+	else if(b == UBX_SYNC_1) {
+		_state = STATE_UBX_SYNC;
+	}
+	else if((b != BUFFER_CHAR_VALUE) && (b != NULL_CHAR_VALUE)) {
+		_discardedBytes++;
+	}
+}
+
+// Abandons the frame being assembled and looks at b afresh, since it may begin the next one
+void GNSSDemux::restart(byte b) {
+	_state = STATE_IDLE;
+	startFrame(b);
+}
+
+void GNSSDemux::endNMEA() {
+	_state = STATE_IDLE;
+	_frame[_length] = '\0';
+	const char *sentence = (const char *) _frame;
+	if(!isChecksumValid(sentence, _length)) {
+		_checksumErrors++;
+		return;
+	}
+	_nmeaFrames++;
+	int addressLength = 0; // The talker and type, between the $ and the first comma
+	while((addressLength + 1 < _length) && (sentence[addressLength + 1] != ',') && (sentence[addressLength + 1] != '*'))
+		addressLength++;
+	bool handled = false;
+	for(byte i = 0; i < _numHandlers; i++) {
+		if((_handlers[i].nmeaHandler != NULL) && matchesNMEA(_handlers[i], addressLength)) {
+			_handlers[i].nmeaHandler(_handlers[i].context, sentence, _length);
+			handled = true;
+		}
+	}
+	if(!handled)
+		_unhandledFrames++;
+}
+
+void GNSSDemux::endUBX() {
+	_state = STATE_IDLE;
+	if((_frame[_length - 2] != _ckA) || (_frame[_length - 1] != _ckB)) {
+		_checksumErrors++;
+		return;
+	}
+	_ubxFrames++;
+	byte msgClass = _frame[0];
+	byte msgId = _frame[1];
+	bool handled = false;
+	for(byte i = 0; i < _numHandlers; i++) {
+		const Handler &h = _handlers[i];
+		if((h.ubxHandler != NULL) && ((h.msgClass == ANY) || (h.msgClass == msgClass)) && ((h.msgId == ANY) || (h.msgId == msgId))) {
+			h.ubxHandler(h.context, msgClass, msgId, _frame + 4, _ubxLength);
+			handled = true;
+		}
+	}
+	if(!handled)
+		_unhandledFrames++;
+}
+
+// True if the sentence in the frame, whose address field is addressLength characters, is of the handler's type
+bool GNSSDemux::matchesNMEA(const Handler &handler, int addressLength) {
+	int typeLength = strlen(handler.type);
+	if(typeLength == 0)
+		return true;
+	const char *address = (const char *) _frame + 1;
+	if(addressLength == typeLength)
+		return strncmp(address, handler.type, typeLength) == 0;
+	if((addressLength == typeLength + 2) && (address[0] != 'P')) // Skips the talker ID of a standard sentence
+		return strncmp(address + 2, handler.type, typeLength) == 0;
+	return false;
+}
+
+/* True if the sentence, of the given length, has a * followed by two hex digits equal to the XOR of the characters
+ * between the $ and the *
+ */
+bool GNSSDemux::isChecksumValid(const char *sentence, int length) {
+	byte checksum = 0;
+	for(int i = 1; i < length; i++) {
+		if(sentence[i] == '*') {
+			if((i + 2 >= length) || !isxdigit(sentence[i + 1]) || !isxdigit(sentence[i + 2]))
+				return false;
+			char digits[3] = {sentence[i + 1], sentence[i + 2], '\0'};
+			return strtol(digits, NULL, 16) == checksum;
+		}
+		checksum ^= sentence[i];
+	}
+	return false; // No checksum
+}
+
+unsigned long GNSSDemux::getNMEACount() {
+	return _nmeaFrames;
+}
+
+unsigned long GNSSDemux::getUBXCount() {
+	return _ubxFrames;
+}
+
+// Gets the number of frames dropped, for a bad checksum, a stray byte or want of room
+unsigned long GNSSDemux::getErrorCount() {
+	return _checksumErrors + _framingErrors + _overflows;
+}
+
+void GNSSDemux::printStats(Print &out) {
+	out.print(F("nmea="));
+	out.print(_nmeaFrames);
+	out.print(F(" ubx="));
+	out.print(_ubxFrames);
+	out.print(F(" unhandled="));
+	out.print(_unhandledFrames);
+	out.print(F(" checksum="));
+	out.print(_checksumErrors);
+	out.print(F(" framing="));
+	out.print(_framingErrors);
+	out.print(F(" overflow="));
+	out.print(_overflows);
+	out.print(F(" discarded="));
+	out.print(_discardedBytes);
+	out.println(F("B"));
+}
+
+void GNSSDemux::resetStats() {
+	_nmeaFrames = 0;
+	_ubxFrames = 0;
+	_unhandledFrames = 0;
+	_checksumErrors = 0;
+	_framingErrors = 0;
+	_overflows = 0;
+	_discardedBytes = 0;
+}
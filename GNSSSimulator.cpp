@@ -0,0 +1,533 @@
+/* GNSS Receiver Simulator for Arduino
+ * Developed for the Space Systems Laboratory at the University of Maryland
+ * Part of the BPPCell library
+ * See GitHub.com/UMDBPP/BPPCell or the accompanying readme for further details.
+ *
+ * Copyright (c) 2015 Luke Renegar
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+
+#define BPPCELL_SOURCE
+#include "Arduino.h"
+#include "BPPCell.h"
+#include "GNSSSimulator.h"
+
+const long DEFAULT_LAT = 23393820; // College Park, MD: 38 59.3820' N
+const long DEFAULT_LON = -46162680; // 76 56.2680' W
+const long DEFAULT_ALT = 50; // Meters
+const int DEFAULT_CLIMB_RATE = 500; // Centimeters per second, about a balloon's ascent rate
+const int MAX_DRIFT = 1500; // Centimeters per second; the random trajectory's wind speed is held below this
+const long TEN_THOUSANDTHS_PER_CM_Q16 = 3539; // 65536 * 5.39957 / 100; ten-thousandths of a minute per cm, in Q16
+const int EPOCH_BUFFER_SIZE = 448; // Enough for every output in one epoch
+const byte GSV_SENTENCES = 3; // Twelve satellites in view, four per sentence
+
+GNSSSimulator::GNSSSimulator() {
+	_head = 0;
+	_count = 0;
+	_bytesWritten = 0;
+	_bytesRead = 0;
+	_numPending = 0;
+	_epochInterval = 1000;
+	_outputs = OUTPUT_GGA | OUTPUT_RMC | OUTPUT_GSV;
+	_started = false;
+	_startMillis = 0;
+	_nextEpochMillis = 0;
+	_startMillisOfDay = 43200000; // 12:00:00 UTC
+	_climbCmPerSec = DEFAULT_CLIMB_RATE;
+	setRandomTrajectory(DEFAULT_LAT, DEFAULT_LON, DEFAULT_ALT);
+	_fixQuality = GPSCoords::FIX_GPS;
+	_numSatellites = 8;
+	_hdop = 90;
+	_flightMode = DEFAULT_FLIGHT_MODE;
+	_corruptPerMille = 0;
+	_nullPerMille = 0;
+	_maxBytesPerRead = DEFAULT_BYTES_TO_READ;
+	resetStats();
+}
+
+// Sets the navigation rate, e.g. 1, 5 or 10 epochs per second
+void GNSSSimulator::setRate(int epochsPerSecond) {
+	if(epochsPerSecond < 1)
+		epochsPerSecond = 1;
+	_epochInterval = 1000 / epochsPerSecond;
+}
+
+// Selects what each epoch produces, as a combination of the OUTPUT constants
+void GNSSSimulator::setOutputs(byte outputs) {
+	_outputs = outputs;
+}
+
+/* Follows the given waypoints, which must be in time order, moving linearly between them and holding the last.
+ * waypoints is not copied, so it must outlive the simulator.
+ */
+void GNSSSimulator::setScript(const SimWaypoint *waypoints, int numWaypoints) {
+	_waypoints = (numWaypoints > 0) ? waypoints : NULL;
+	_numWaypoints = numWaypoints;
+	if(_waypoints != NULL) {
+		_lat = _waypoints[0].lat;
+		_lon = _waypoints[0].lon;
+		_altMm = _waypoints[0].alt * 1000;
+	}
+}
+
+/* Flies a balloon from the given position: it climbs at the climb rate while the wind drifts it at a speed that
+ * wanders at random from epoch to epoch. The same seed gives the same flight.
+ */
+void GNSSSimulator::setRandomTrajectory(long lat, long lon, long alt, unsigned long seed) {
+	_waypoints = NULL;
+	_numWaypoints = 0;
+	_lat = lat;
+	_lon = lon;
+	_altMm = alt * 1000;
+	_latRemainder = 0;
+	_lonRemainder = 0;
+	_northCmPerSec = 0;
+	_eastCmPerSec = 0;
+	_random = seed;
+}
+
+// Sets the random trajectory's climb rate; negative to descend
+void GNSSSimulator::setClimbRate(int centimetersPerSecond) {
+	_climbCmPerSec = centimetersPerSecond;
+}
+
+// Sets the GGA fix quality, satellite count and HDOP (in hundredths)
+void GNSSSimulator::setFixQuality(byte fixQuality, byte numSatellites, int hdop) {
+	_fixQuality = fixQuality;
+	_numSatellites = numSatellites;
+	_hdop = hdop;
+}
+
+// Sets the UTC time of the first epoch, in milliseconds since midnight
+void GNSSSimulator::setStartTime(unsigned long millisOfDay) {
+	_startMillisOfDay = millisOfDay % GPSCoords::MILLIS_PER_DAY;
+}
+
+/* Replaces corruptPerMille of every thousand bytes read with other values, and inserts nullPerMille null bytes
+ * per thousand, from a generator started from seed.
+ */
+void GNSSSimulator::setCorruption(int corruptPerMille, int nullPerMille, unsigned long seed) {
+	_corruptPerMille = corruptPerMille;
+	_nullPerMille = nullPerMille;
+	_random = seed;
+}
+
+// Cuts every read short after maxBytes bytes of data, padding the rest with filler
+void GNSSSimulator::setMaxBytesPerRead(int maxBytes) {
+	_maxBytesPerRead = maxBytes;
+}
+
+// Starts the clock; otherwise the first read does. The first epoch is at now.
+void GNSSSimulator::start(unsigned long now) {
+	_started = true;
+	_startMillis = now;
+	_nextEpochMillis = now;
+	_lastMoveMillis = now;
+}
+
+/* Reads bytes from the DDC output as the host would, always filling buffer (with filler past the data).
+ * Returns the number of bytes read, which is always bytes.
+ */
+int GNSSSimulator::readDdc(byte *buffer, int bytes) {
+	unsigned long now = millis();
+	if(!_started)
+		start(now);
+	generateEpochs(now);
+
+	int dataLimit = min(bytes, _maxBytesPerRead);
+	for(int i = 0; i < bytes; i++) {
+		if((i >= dataLimit) || (_count == 0)) {
+			buffer[i] = BUFFER_CHAR_VALUE;
+			_fillerBytesRead++;
+			continue;
+		}
+		if((_nullPerMille > 0) && ((nextRandom() % 1000) < (unsigned long) _nullPerMille)) {
+			buffer[i] = NULL_CHAR_VALUE;
+			_nullBytes++;
+			continue;
+		}
+		byte b = _buffer[_head];
+		_head = (_head + 1) % BUFFER_SIZE;
+		_count--;
+		_bytesRead++;
+		_dataBytesRead++;
+		if((_corruptPerMille > 0) && ((nextRandom() % 1000) < (unsigned long) _corruptPerMille)) {
+			b ^= 1 + (nextRandom() % 255); // Always changes the byte
+			_corruptBytes++;
+		}
+		buffer[i] = b;
+	}
+
+	// Fixes whose last byte has now been read
+	while((_numPending > 0) && ((long) (_bytesRead - _pending[0].endOffset) >= 0)) {
+		unsigned long latency = now - _pending[0].epochMillis;
+		_fixesDelivered++;
+		_totalLatency += latency;
+		if(latency > _maxLatency)
+			_maxLatency = latency;
+		_numPending--;
+		memmove(_pending, _pending + 1, _numPending * sizeof(PendingFix));
+	}
+	return bytes;
+}
+
+/* Takes UBX messages written by the host. Returns false if any was malformed or had a bad checksum; the receiver
+ * ignores those.
+ */
+bool GNSSSimulator::writeDdc(const byte *msg, int msgLength) {
+	bool valid = true;
+	int i = 0;
+	while(i < msgLength) {
+		if((msg[i] != 0xB5) || (i + 1 >= msgLength) || (msg[i + 1] != 0x62)) {
+			i++; // Not the start of a frame, e.g. the 0xFF used to wake the receiver
+			continue;
+		}
+		if(i + 8 > msgLength) {
+			_ubxRejected++;
+			return false;
+		}
+		int payloadLength = msg[i + 4] | (msg[i + 5] << 8);
+		if(i + 8 + payloadLength > msgLength) {
+			_ubxRejected++;
+			return false;
+		}
+		byte checkA = 0;
+		byte checkB = 0;
+		for(int j = i + 2; j < i + 6 + payloadLength; j++) {
+			checkA += msg[j];
+			checkB += checkA;
+		}
+		if((checkA == msg[i + 6 + payloadLength]) && (checkB == msg[i + 7 + payloadLength])) {
+			_ubxReceived++;
+			respondToUbx(msg[i + 2], msg[i + 3], msg + i + 6, payloadLength);
+		}
+		else {
+			_ubxRejected++;
+			valid = false;
+		}
+		i += 8 + payloadLength;
+	}
+	return valid;
+}
+
+// The dynamic platform model last set with CFG-NAV5
+byte GNSSSimulator::getFlightMode() {
+	return _flightMode;
+}
+
+/* Prints the run as two lines, e.g.
+ * epochs=100 dropped=2 fixes=98 (9.81/s) latency mean=41ms max=180ms
+ * read=41200B filler=3880B corrupt=3 nulls=5 ubx=2 rejected=0
+ */
+void GNSSSimulator::printStats(Print &out) {
+	out.print(F("epochs="));
+	out.print(_epochs);
+	out.print(F(" dropped="));
+	out.print(_droppedEpochs);
+	out.print(F(" fixes="));
+	out.print(_fixesDelivered);
+	if(_epochs > 0) {
+		unsigned long span = millis() - _firstEpochMillis;
+		if(span > 0) {
+			out.print(F(" ("));
+			out.print((_fixesDelivered * 1000.0) / span);
+			out.print(F("/s)"));
+		}
+	}
+	if(_fixesDelivered > 0) {
+		out.print(F(" latency mean="));
+		out.print(_totalLatency / _fixesDelivered);
+		out.print(F("ms max="));
+		out.print(_maxLatency);
+		out.print(F("ms"));
+	}
+	out.println();
+	out.print(F("read="));
+	out.print(_dataBytesRead);
+	out.print(F("B filler="));
+	out.print(_fillerBytesRead);
+	out.print(F("B corrupt="));
+	out.print(_corruptBytes);
+	out.print(F(" nulls="));
+	out.print(_nullBytes);
+	out.print(F(" ubx="));
+	out.print(_ubxReceived);
+	out.print(F(" rejected="));
+	out.println(_ubxRejected);
+}
+
+void GNSSSimulator::resetStats() {
+	_epochs = 0;
+	_droppedEpochs = 0;
+	_fixesDelivered = 0;
+	_totalLatency = 0;
+	_maxLatency = 0;
+	_dataBytesRead = 0;
+	_fillerBytesRead = 0;
+	_corruptBytes = 0;
+	_nullBytes = 0;
+	_ubxReceived = 0;
+	_ubxRejected = 0;
+	_firstEpochMillis = 0;
+	_lastEpochMillis = 0;
+}
+
+// Produces every epoch due by now, catching up after the host has been busy elsewhere
+void GNSSSimulator::generateEpochs(unsigned long now) {
+	while((long) (now - _nextEpochMillis) >= 0) {
+		move(_nextEpochMillis);
+		writeEpoch(_nextEpochMillis);
+		_nextEpochMillis += _epochInterval;
+	}
+}
+
+// Advances the position to time now along the script or the random trajectory
+void GNSSSimulator::move(unsigned long now) {
+	long dt = (long) (now - _lastMoveMillis); // Signed, so that the products below stay signed wherever a long is 64 bits
+	_lastMoveMillis = now;
+
+	if(_waypoints != NULL) {
+		unsigned long elapsed = now - _startMillis;
+		int i = 0;
+		while((i < _numWaypoints - 1) && (_waypoints[i + 1].time <= elapsed))
+			i++;
+		const SimWaypoint &a = _waypoints[i];
+		if((i == _numWaypoints - 1) || (elapsed <= a.time)) { // Before the script starts, or past its end
+			_lat = a.lat;
+			_lon = a.lon;
+			_altMm = a.alt * 1000;
+			_northCmPerSec = 0;
+			_eastCmPerSec = 0;
+			_climbCmPerSec = 0;
+			return;
+		}
+		const SimWaypoint &b = _waypoints[i + 1];
+		long span = b.time - a.time;
+		long into = elapsed - a.time;
+		// Rare 64-bit products: coordinate differences times milliseconds overflow 32 bits
+		_lat = a.lat + (long) ((long long) (b.lat - a.lat) * into / span);
+		_lon = a.lon + (long) ((long long) GeoMath::wrapLon(b.lon - a.lon) * into / span);
+		_lon = GeoMath::wrapLon(_lon);
+		_altMm = a.alt * 1000 + (long) ((long long) (b.alt - a.alt) * 1000 * into / span);
+		long north;
+		long east;
+		GeoMath::displacement(a.lat, a.lon, b.lat, b.lon, north, east);
+		_northCmPerSec = (long long) north * 100000 / span;
+		_eastCmPerSec = (long long) east * 100000 / span;
+		_climbCmPerSec = (long long) (b.alt - a.alt) * 100000 / span;
+		return;
+	}
+
+	// Random walk of the wind, up to 20 cm/s per second in each axis
+	_northCmPerSec = constrain(_northCmPerSec + ((long) (nextRandom() % 41) - 20) * dt / 1000, -MAX_DRIFT, MAX_DRIFT);
+	_eastCmPerSec = constrain(_eastCmPerSec + ((long) (nextRandom() % 41) - 20) * dt / 1000, -MAX_DRIFT, MAX_DRIFT);
+
+	long long latStep = (long long) _northCmPerSec * TEN_THOUSANDTHS_PER_CM_Q16 * dt / 1000 + _latRemainder;
+	int cosLat = GeoMath::cosQ15(_lat);
+	if(cosLat < 64) // Within a fraction of a degree of the pole
+		cosLat = 64;
+	long long lonStep = (long long) _eastCmPerSec * TEN_THOUSANDTHS_PER_CM_Q16 * 32768 / cosLat * dt / 1000 + _lonRemainder;
+	_lat += (long) (latStep >> 16);
+	_latRemainder = (long) (latStep & 0xFFFF);
+	_lon = GeoMath::wrapLon(_lon + (long) (lonStep >> 16));
+	_lonRemainder = (long) (lonStep & 0xFFFF);
+	_altMm += (long) _climbCmPerSec * dt / 100;
+}
+
+// Queues one epoch's output, or drops the whole epoch if it does not fit in the buffer
+void GNSSSimulator::writeEpoch(unsigned long epochMillis) {
+	if(_epochs == 0)
+		_firstEpochMillis = epochMillis;
+	_epochs++;
+	_lastEpochMillis = epochMillis;
+
+	unsigned long millisOfDay = (_startMillisOfDay + (epochMillis - _startMillis)) % GPSCoords::MILLIS_PER_DAY;
+	char epoch[EPOCH_BUFFER_SIZE];
+	int length = 0;
+	int ggaEnd = -1;
+
+	// NMEA sentences in the receiver's order: RMC, GGA, then GSV
+	if(_outputs & OUTPUT_RMC)
+		length += formatNmeaEpoch(epoch + length, EPOCH_BUFFER_SIZE - length, millisOfDay, OUTPUT_RMC, 0);
+	if(_outputs & OUTPUT_GGA) {
+		length += formatNmeaEpoch(epoch + length, EPOCH_BUFFER_SIZE - length, millisOfDay, OUTPUT_GGA, 0);
+		ggaEnd = length;
+	}
+	if(_outputs & OUTPUT_GSV) {
+		for(int part = 1; part <= GSV_SENTENCES; part++)
+			length += formatNmeaEpoch(epoch + length, EPOCH_BUFFER_SIZE - length, millisOfDay, OUTPUT_GSV, part);
+	}
+	if(_outputs & OUTPUT_UBX_POSLLH) {
+		byte payload[28];
+		putLong(payload, millisOfDay); // iTOW; the time of day stands in for the time of week
+		putLong(payload + 4, E7DegreeScale::fromTenThousandths(_lon));
+		putLong(payload + 8, E7DegreeScale::fromTenThousandths(_lat));
+		putLong(payload + 12, _altMm); // Height above the ellipsoid, taken as MSL
+		putLong(payload + 16, _altMm);
+		putLong(payload + 20, (long) _hdop * 25); // Horizontal and vertical accuracy estimates, mm
+		putLong(payload + 24, (long) _hdop * 40);
+		if(length + 36 <= EPOCH_BUFFER_SIZE)
+			length += formatUbx((byte *) epoch + length, 0x01, 0x02, payload, sizeof(payload));
+	}
+
+	if(length > BUFFER_SIZE - _count) {
+		_droppedEpochs++;
+		return;
+	}
+	unsigned long epochStart = _bytesWritten;
+	append((byte *) epoch, length);
+	if((ggaEnd >= 0) && (_numPending < MAX_PENDING_FIXES)) {
+		_pending[_numPending].endOffset = epochStart + ggaEnd;
+		_pending[_numPending].epochMillis = epochMillis;
+		_numPending++;
+	}
+}
+
+// Adds data to the ring buffer; returns false, adding nothing, if it does not fit
+bool GNSSSimulator::append(const byte *data, int length) {
+	if(length > BUFFER_SIZE - _count)
+		return false;
+	for(int i = 0; i < length; i++)
+		_buffer[(_head + _count + i) % BUFFER_SIZE] = data[i];
+	_count += length;
+	_bytesWritten += length;
+	return true;
+}
+
+/* Frames the sentence body at sentence + 1 (bodyLength characters) with the $, checksum and CR LF.
+ * sentence must have room for bodyLength + 6 characters. Returns the length of the whole sentence.
+ */
+int GNSSSimulator::appendNmea(char *sentence, int bodyLength) {
+	byte checksum = 0;
+	for(int i = 1; i <= bodyLength; i++)
+		checksum ^= sentence[i];
+	sentence[0] = '$';
+	const char *hex = "0123456789ABCDEF";
+	char *end = sentence + 1 + bodyLength;
+	end[0] = '*';
+	end[1] = hex[checksum >> 4];
+	end[2] = hex[checksum & 0x0F];
+	end[3] = '\r';
+	end[4] = '\n';
+	return bodyLength + 6;
+}
+
+// Writes one NMEA sentence of the given output for the current position into out; part numbers GSV sentences
+int GNSSSimulator::formatNmeaEpoch(char *out, int size, unsigned long millisOfDay, byte output, int part) {
+	char time[12];
+	unsigned long centiseconds = millisOfDay / 10;
+	snprintf(time, sizeof(time), "%02lu%02lu%02lu.%02lu", centiseconds / 360000, (centiseconds / 6000) % 60,
+		(centiseconds / 100) % 60, centiseconds % 100);
+	char lat[16];
+	char lon[16];
+	formatCoordinate(lat, sizeof(lat), _lat, 2, 'N', 'S');
+	formatCoordinate(lon, sizeof(lon), _lon, 3, 'E', 'W');
+
+	int bodySize = size - 6; // Room for the $ and the *HH CR LF
+	int bodyLength = 0;
+	if(output == OUTPUT_GGA) {
+		long altDm = _altMm / 100; // Decimeters
+		bodyLength = snprintf(out + 1, bodySize, "GPGGA,%s,%s,%s,%d,%02d,%d.%02d,%s%ld.%ld,M,0.0,M,,", time, lat, lon,
+			_fixQuality, _numSatellites, _hdop / 100, _hdop % 100, (altDm < 0) ? "-" : "", labs(altDm) / 10, labs(altDm) % 10);
+	}
+	else if(output == OUTPUT_RMC) {
+		long speed = GeoMath::isqrt((unsigned long) ((long) _northCmPerSec * _northCmPerSec + (long) _eastCmPerSec * _eastCmPerSec));
+		long knotsHundredths = speed * 19438 / 10000; // 1 cm/s is 0.0194384 knots
+		long course = (speed > 0) ? GeoMath::atan2Bearing(_eastCmPerSec, _northCmPerSec) : 0;
+		bodyLength = snprintf(out + 1, bodySize, "GPRMC,%s,A,%s,%s,%ld.%02ld,%ld.%02ld,220515,,,A", time, lat, lon,
+			knotsHundredths / 100, knotsHundredths % 100, course / 100, course % 100);
+	}
+	else { // GSV; made-up satellites, four per sentence
+		bodyLength = snprintf(out + 1, bodySize, "GPGSV,%d,%d,%02d", GSV_SENTENCES, part, GSV_SENTENCES * 4);
+		for(int i = 0; i < 4; i++) {
+			int prn = (part - 1) * 4 + i + 1;
+			bodyLength += snprintf(out + 1 + bodyLength, bodySize - bodyLength, ",%02d,%02d,%03d,%02d", prn,
+				(prn * 37) % 90, (prn * 97) % 360, 20 + (prn * 13) % 30);
+		}
+	}
+	if((bodyLength <= 0) || (bodyLength >= bodySize))
+		return 0; // No room
+	return appendNmea(out, bodyLength);
+}
+
+// Writes a UBX frame with its header and checksum into out; returns its length (payloadLength + 8)
+int GNSSSimulator::formatUbx(byte *out, byte msgClass, byte msgId, const byte *payload, int payloadLength) {
+	out[0] = 0xB5;
+	out[1] = 0x62;
+	out[2] = msgClass;
+	out[3] = msgId;
+	out[4] = payloadLength & 0xFF;
+	out[5] = payloadLength >> 8;
+	memcpy(out + 6, payload, payloadLength);
+	byte checkA = 0;
+	byte checkB = 0;
+	for(int i = 2; i < payloadLength + 6; i++) {
+		checkA += out[i];
+		checkB += checkA;
+	}
+	out[payloadLength + 6] = checkA;
+	out[payloadLength + 7] = checkB;
+	return payloadLength + 8;
+}
+
+// Answers a UBX message: CFG-NAV5 polls with the current settings, and every CFG message with ACK-ACK
+void GNSSSimulator::respondToUbx(byte msgClass, byte msgId, const byte *payload, int payloadLength) {
+	if(msgClass != 0x06) // Only configuration messages are answered
+		return;
+	byte frame[44];
+	if((msgId == 0x24) && (payloadLength == 0)) { // Poll of CFG-NAV5
+		byte nav5[36];
+		memset(nav5, 0, sizeof(nav5));
+		nav5[0] = 0xFF; // Mask
+		nav5[1] = 0xFF;
+		nav5[2] = _flightMode;
+		nav5[3] = 0x03; // Auto 2D/3D
+		append(frame, formatUbx(frame, 0x06, 0x24, nav5, sizeof(nav5)));
+	}
+	else if((msgId == 0x24) && (payloadLength >= 3) && (payload[0] & 0x01)) { // Mask bit 0 applies the dynamic model
+		_flightMode = payload[2];
+	}
+	byte ack[2] = { msgClass, msgId };
+	append(frame, formatUbx(frame, 0x05, 0x01, ack, sizeof(ack)));
+}
+
+// The C standard's example generator, which is repeatable everywhere
+unsigned long GNSSSimulator::nextRandom() {
+	_random = _random * 1103515245UL + 12345;
+	return (_random >> 16) & 0x7FFF;
+}
+
+// Writes value as NMEA ddmm.mmmm,N (or dddmm.mmmm,E with three degree digits)
+int GNSSSimulator::formatCoordinate(char *out, int size, long value, int degreeDigits, char positive, char negative) {
+	long magnitude = labs(value);
+	long degrees = magnitude / GPSCoords::TEN_THOUSANDTHS_PER_DEGREE;
+	long remainder = magnitude % GPSCoords::TEN_THOUSANDTHS_PER_DEGREE;
+	const char *format = (degreeDigits == 3) ? "%03ld%02ld.%04ld,%c" : "%02ld%02ld.%04ld,%c";
+	return snprintf(out, size, format, degrees, remainder / GPSCoords::TEN_THOUSANDTHS_PER_MINUTE,
+		remainder % GPSCoords::TEN_THOUSANDTHS_PER_MINUTE, (value < 0) ? negative : positive);
+}
+
+// Stores value little-endian, as UBX does
+void GNSSSimulator::putLong(byte *out, long value) {
+	for(int i = 0; i < 4; i++)
+		out[i] = (value >> (8 * i)) & 0xFF;
+}
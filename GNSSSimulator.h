@@ -0,0 +1,174 @@
+/* GNSS Receiver Simulator for Arduino
+ * Part of the BPPCell library. Include this after BPPCell.h to run GNSSComm against a simulated receiver, e.g.
+ *   GNSSSimulator receiver;
+ *   BasicGNSSComm<SimulatedDdcTransport> gnssComm((SimulatedDdcTransport(receiver)));
+ * See GitHub.com/UMDBPP/BPPCell or the accompanying readme for further details.
+ *
+ * The simulator plays the part of the MAX-7Q's DDC (I2C) slave, so GNSSComm can be load-tested at any navigation
+ * rate without a receiver, on the Arduino itself or on a host with an Arduino compatibility layer.
+ */
+
+#ifndef GNSSSimulator_h
+#define GNSSSimulator_h
+
+#include "Arduino.h"
+#include "BPPCell.h"
+
+// A point on a scripted trajectory
+struct SimWaypoint {
+	unsigned long time; // Milliseconds after the simulation starts
+	long lat; // Ten-thousandths of a minute
+	long lon; // Ten-thousandths of a minute
+	long alt; // Meters above mean sea level
+};
+
+/* Simulated u-blox receiver
+ * Each epoch, at the configured navigation rate, the receiver moves along a scripted trajectory (linear between
+ * waypoints) or a seeded random balloon flight, and queues GGA, RMC and GSV sentences and a UBX NAV-POSLLH frame, as
+ * selected, in its DDC output buffer. An epoch that does not fit in the buffer is dropped, as the receiver does
+ * when it is not read fast enough. Reads past the end of the buffered data return the 0xFF filler; corrupt bytes
+ * and nulls can be injected at given rates, and reads can be cut short to exercise partial reads. CFG-NAV5 polls
+ * and settings are answered as the receiver would, with ACK-ACK for other CFG messages.
+ *
+ * Time comes from millis(); epochs due since the last read are generated when the bus is next read.
+ * For each GGA sentence the latency from its epoch to the read of its last byte is recorded.
+ */
+class GNSSSimulator {
+	public:
+		GNSSSimulator();
+		void setRate(int epochsPerSecond);
+		void setOutputs(byte outputs);
+		void setScript(const SimWaypoint *waypoints, int numWaypoints);
+		void setRandomTrajectory(long lat, long lon, long alt, unsigned long seed = 1);
+		void setClimbRate(int centimetersPerSecond);
+		void setFixQuality(byte fixQuality, byte numSatellites, int hdop);
+		void setStartTime(unsigned long millisOfDay);
+		void setCorruption(int corruptPerMille, int nullPerMille, unsigned long seed = 1);
+		void setMaxBytesPerRead(int maxBytes);
+		void start(unsigned long now);
+		int readDdc(byte *buffer, int bytes);
+		bool writeDdc(const byte *msg, int msgLength);
+		byte getFlightMode();
+		void printStats(Print &out);
+		void resetStats();
+
+		const static byte OUTPUT_GGA = 0x01;
+		const static byte OUTPUT_RMC = 0x02;
+		const static byte OUTPUT_GSV = 0x04;
+		const static byte OUTPUT_UBX_POSLLH = 0x08;
+		const static int BUFFER_SIZE = 1024; // Bytes the receiver holds for the host
+		const static byte MAX_PENDING_FIXES = 16; // GGA sentences whose latency is being tracked at once
+
+	private:
+		struct PendingFix {
+			unsigned long endOffset; // Value of _bytesWritten just after the sentence
+			unsigned long epochMillis;
+		};
+
+		byte _buffer[BUFFER_SIZE]; // Ring buffer of bytes waiting to be read
+		int _head; // Index of the next byte to read
+		int _count;
+		unsigned long _bytesWritten; // Totals over the whole run, for matching reads to pending fixes
+		unsigned long _bytesRead;
+		PendingFix _pending[MAX_PENDING_FIXES];
+		byte _numPending;
+
+		unsigned long _epochInterval; // Milliseconds
+		byte _outputs;
+		bool _started;
+		unsigned long _startMillis;
+		unsigned long _nextEpochMillis;
+		unsigned long _startMillisOfDay;
+
+		const SimWaypoint *_waypoints; // NULL for the random trajectory
+		int _numWaypoints;
+		long _lat; // Current position, in ten-thousandths of a minute
+		long _lon;
+		long _altMm; // Millimeters
+		long _latRemainder; // Fractions of a ten-thousandth, in 1/65536ths, carried between epochs
+		long _lonRemainder;
+		int _northCmPerSec; // Current velocity
+		int _eastCmPerSec;
+		int _climbCmPerSec;
+		unsigned long _lastMoveMillis;
+
+		byte _fixQuality;
+		byte _numSatellites;
+		int _hdop; // Hundredths
+		byte _flightMode;
+
+		int _corruptPerMille;
+		int _nullPerMille;
+		int _maxBytesPerRead;
+		unsigned long _random;
+
+		unsigned long _epochs;
+		unsigned long _droppedEpochs;
+		unsigned long _fixesDelivered;
+		unsigned long _totalLatency;
+		unsigned long _maxLatency;
+		unsigned long _dataBytesRead;
+		unsigned long _fillerBytesRead;
+		unsigned long _corruptBytes;
+		unsigned long _nullBytes;
+		unsigned long _ubxReceived;
+		unsigned long _ubxRejected;
+		unsigned long _firstEpochMillis;
+		unsigned long _lastEpochMillis;
+
+		void generateEpochs(unsigned long now);
+		void move(unsigned long now);
+		void writeEpoch(unsigned long epochMillis);
+		bool append(const byte *data, int length);
+		int appendNmea(char *sentence, int bodyLength);
+		int formatNmeaEpoch(char *out, int size, unsigned long millisOfDay, byte output, int part);
+		int formatUbx(byte *out, byte msgClass, byte msgId, const byte *payload, int payloadLength);
+		void respondToUbx(byte msgClass, byte msgId, const byte *payload, int payloadLength);
+		unsigned long nextRandom();
+		static int formatCoordinate(char *out, int size, long value, int degreeDigits, char positive, char negative);
+		static void putLong(byte *out, long value);
+};
+
+/* Transport policy (see GNSSTransports.h) that reads the simulator as I2cDdcTransport reads the receiver:
+ * in transactions of up to DEFAULT_BYTES_TO_READ bytes, padded with the 0xFF filler.
+ */
+class SimulatedDdcTransport {
+	public:
+		SimulatedDdcTransport(GNSSSimulator &simulator) : _simulator(&simulator), _length(0), _index(0) {}
+
+		void begin() {}
+
+		void end() {}
+
+		int available() {
+			return _length - _index;
+		}
+
+		byte receive() {
+			if(_index >= _length)
+				return BUFFER_CHAR_VALUE;
+			return _buffer[_index++];
+		}
+
+		void requestBytes(int bytes) {
+			if(bytes > DEFAULT_BYTES_TO_READ)
+				bytes = DEFAULT_BYTES_TO_READ;
+			_length = _simulator->readDdc(_buffer, bytes);
+			_index = 0;
+		}
+
+		void wake() {}
+
+		// Returns 0 on success, as the I2c library does
+		int write(byte *msg, int msgLength) {
+			return _simulator->writeDdc(msg, msgLength) ? 0 : 1;
+		}
+
+	private:
+		GNSSSimulator *_simulator;
+		byte _buffer[DEFAULT_BYTES_TO_READ];
+		byte _length;
+		byte _index;
+};
+
+#endif
@@ -0,0 +1,74 @@
+/* GNSS SPI Transport Policy for Arduino
+ * Part of the BPPCell library. Include this after BPPCell.h (and SPI.h) to use a receiver on the SPI bus, e.g.
+ *   BasicGNSSComm<SpiGnssTransport<53> > gnssComm;
+ * See GNSSTransports.h for the transport policy interface.
+ */
+
+#ifndef GNSSSpiTransport_h
+#define GNSSSpiTransport_h
+
+#include "Arduino.h"
+#include <SPI.h>
+#include "BPPCell.h"
+
+/* SPI transport for u-blox receivers. Reading clocks out 0xFF and keeps what the receiver returns; the receiver
+ * sends 0xFF itself when it has nothing to say. Bytes received while writing a message are kept too.
+ */
+template <uint8_t CS_PIN, uint32_t CLOCK = 1000000, uint8_t BUFFER_SIZE = DEFAULT_BYTES_TO_READ>
+class SpiGnssTransport {
+	public:
+		SpiGnssTransport() : _length(0), _index(0) {}
+		
+		void begin() {
+			pinMode(CS_PIN, OUTPUT);
+			digitalWrite(CS_PIN, HIGH);
+			SPI.begin();
+		}
+		
+		void end() {} // The bus may be shared (e.g. with the SD card), so it is left running
+		
+		int available() {
+			return _length - _index;
+		}
+		
+		byte receive() {
+			if(_index >= _length)
+				return BUFFER_CHAR_VALUE;
+			return _buffer[_index++];
+		}
+		
+		void requestBytes(int bytes) {
+			transfer(NULL, min(bytes, (int) BUFFER_SIZE));
+		}
+		
+		void wake() {} // Selecting the receiver wakes it
+		
+		int write(byte *msg, int msgLength) {
+			transfer(msg, msgLength);
+			return msgLength;
+		}
+	
+	private:
+		byte _buffer[BUFFER_SIZE];
+		int _length;
+		int _index;
+		
+		// Clocks out msg (or 0xFF filler if msg is NULL), keeping as much of the reply as fits after any unread bytes
+		void transfer(byte *msg, int count) {
+			if(_index >= _length) {
+				_length = 0;
+				_index = 0;
+			}
+			SPI.beginTransaction(SPISettings(CLOCK, MSBFIRST, SPI_MODE0));
+			digitalWrite(CS_PIN, LOW);
+			for(int i = 0; i < count; i++) {
+				byte b = SPI.transfer((msg == NULL) ? BUFFER_CHAR_VALUE : msg[i]);
+				if(_length < BUFFER_SIZE)
+					_buffer[_length++] = b;
+			}
+			digitalWrite(CS_PIN, HIGH);
+			SPI.endTransaction();
+		}
+};
+
+#endif
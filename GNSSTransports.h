@@ -0,0 +1,94 @@
+/* GNSS Transport Policies for Arduino
+ * Part of the BPPCell library; include BPPCell.h rather than this file.
+ * See GitHub.com/UMDBPP/BPPCell or the accompanying readme for further details.
+ *
+ * A transport policy moves bytes between BasicGNSSComm and the receiver. Every policy provides:
+ *   void begin();                       Prepares the bus
+ *   void end();                         Releases the bus
+ *   int available();                    Number of received bytes buffered locally
+ *   byte receive();                     Takes one buffered byte; 0xFF (the receiver's filler) if there is none
+ *   void requestBytes(int bytes);       Fetches up to bytes more from the receiver into the local buffer
+ *   void wake();                        Wakes the receiver before a message is sent
+ *   int write(byte *msg, int msgLength); Sends a message to the receiver
+ * All calls are resolved at compile time; there is no virtual dispatch.
+ */
+
+#ifndef GNSSTransports_h
+#define GNSSTransports_h
+
+#include "Arduino.h"
+#include <I2C.h>
+
+/* DDC (I2C) transport through the Ninjablox I2c library.
+ * The address and register are template parameters, so receivers at different addresses get different types.
+ * They share I2c's single receive buffer, so only one should be read at a time.
+ */
+template <uint8_t ADDRESS = GNSS_ADDRESS, uint8_t REGISTER = GNSS_REGISTER>
+class I2cDdcTransport {
+	public:
+		void begin() {
+			I2c.begin();
+		}
+		
+		void end() {
+			I2c.end();
+		}
+		
+		int available() {
+			return I2c.available();
+		}
+		
+		byte receive() {
+			return I2c.receive();
+		}
+		
+		void requestBytes(int bytes) {
+			I2c.read(ADDRESS, REGISTER, bytes);
+		}
+		
+		void wake() {
+			I2c.write(ADDRESS, REGISTER, 0xFF);
+		}
+		
+		// Returns the I2c library's status code (0 on success)
+		int write(byte *msg, int msgLength) {
+			return I2c.write(ADDRESS, REGISTER, msg, msgLength);
+		}
+};
+
+/* UART transport over any Stream-like port (HardwareSerial, SoftwareSerial, ...), which the sketch begins itself.
+ * An empty port reads as the 0xFF filler, as the DDC interface does.
+ */
+template <class Port>
+class UartGnssTransport {
+	public:
+		UartGnssTransport(Port &port) : _port(port) {}
+		
+		void begin() {}
+		
+		void end() {}
+		
+		int available() {
+			return _port.available();
+		}
+		
+		byte receive() {
+			int b = _port.read();
+			return (b < 0) ? BUFFER_CHAR_VALUE : (byte) b;
+		}
+		
+		void requestBytes(int) {} // Bytes arrive on their own
+		
+		void wake() {
+			_port.write((uint8_t) 0xFF);
+		}
+		
+		int write(byte *msg, int msgLength) {
+			return _port.write(msg, msgLength);
+		}
+	
+	private:
+		Port &_port;
+};
+
+#endif
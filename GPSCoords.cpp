@@ -24,18 +24,50 @@
  * THE SOFTWARE.
  */
 
+#define BPPCELL_SOURCE
 #include "Arduino.h"
 #include "BPPCell.h"
 
-GPSCoords::GPSCoords(String time, long lat, long lon, float alt) {
-	_time = time;
+GPSCoords::GPSCoords(const char *time, long lat, long lon, float alt) {
+	setTime(time);
 	_lat = lat; //Stored in ten-thousandths of a minute (minute * 10^-4)
 	_lon = lon; //Stored in ten-thousandths of a minute (minute * 10^-4)
 	_alt = alt; // Stored in meters above mean sea level
+	_fixQuality = FIX_GPS;
+	_numSatellites = 0;
+	_hdop = HDOP_UNKNOWN;
 }
 
-void GPSCoords::setTime(String time) {
-	_time = time;
+// Unpacks a PackedFix. The time is given back in the $GPGGA format with hundredths (hhmmss.ss).
+GPSCoords::GPSCoords(const PackedFix &fix) {
+	_millisOfDay = (fix.millisOfDay == PackedFix::TIME_UNKNOWN) ? TIME_UNKNOWN : fix.millisOfDay;
+	_timeDecimals = 2;
+	_lat = fix.lat;
+	_lon = fix.lon;
+	_alt = fix.alt;
+	_fixQuality = fix.fixQuality;
+	_numSatellites = fix.numSatellites;
+	_hdop = (fix.hdopTenths == PackedFix::HDOP_UNKNOWN) ? HDOP_UNKNOWN : (fix.hdopTenths * 10);
+}
+
+/* Sets the time, in the $GPGGA format (hhmmss.ss), parsing it once into milliseconds of day; fractional digits
+ * past the millisecond are dropped. A time that is empty, short or not a time of day leaves the fix without one.
+ */
+void GPSCoords::setTime(const char *time) {
+	_millisOfDay = TIME_UNKNOWN;
+	_timeDecimals = 0;
+	for(int i = 0; i < 6; i++) {
+		if(!isdigit(time[i]))
+			return;
+	}
+	unsigned long millisOfDay = parseMillisOfDay(time);
+	if(millisOfDay >= MILLIS_PER_DAY)
+		return;
+	_millisOfDay = millisOfDay;
+	if(time[6] == '.') {
+		while((_timeDecimals < 3) && isdigit(time[7 + _timeDecimals]))
+			_timeDecimals++;
+	}
 }
 
 // Sets the latitude; unit is ten-thousandths of a minute (minute * 10^-4)
@@ -53,8 +85,17 @@ void GPSCoords::setAlt(float alt) {
 	_alt = alt;
 }
 
-String GPSCoords::getTime() {
-	return _time;
+// Gives the time into buffer in the $GPGGA format, as setTime() took it; empty if there is none. Returns its length
+int GPSCoords::getTime(char *buffer, int size) {
+	TextWriter out(buffer, size);
+	if(hasTime())
+		printTime(out, _millisOfDay, _timeDecimals, false);
+	return out.length();
+}
+
+// Returns true if the fix has a time; the receiver gives one once it has tracked a satellite, before it has a position
+bool GPSCoords::hasTime() {
+	return _millisOfDay != TIME_UNKNOWN;
 }
 
 // Gets the latitude; unit is ten-thousandths of a minute (minute * 10^-4)
@@ -72,148 +113,241 @@ float GPSCoords::getAlt() {
 	return _alt;
 }
 
-// Formats the coordinates for text according to one of the FORMAT constants
-String GPSCoords::formatCoordsForText(int format) {
-	String returnString = "";
+// Sets the GGA fix quality indicator; see the FIX constants
+void GPSCoords::setFixQuality(byte fixQuality) {
+	_fixQuality = fixQuality;
+}
+
+// Sets the number of satellites used in the fix
+void GPSCoords::setNumSatellites(byte numSatellites) {
+	_numSatellites = numSatellites;
+}
+
+// Sets the horizontal dilution of precision; unit is hundredths (HDOP * 100)
+void GPSCoords::setHDOP(int hdop) {
+	_hdop = hdop;
+}
+
+// Gets the GGA fix quality indicator; see the FIX constants
+byte GPSCoords::getFixQuality() {
+	return _fixQuality;
+}
+
+// Gets the number of satellites used in the fix
+byte GPSCoords::getNumSatellites() {
+	return _numSatellites;
+}
+
+// Gets the horizontal dilution of precision; unit is hundredths (HDOP * 100). HDOP_UNKNOWN if not reported.
+int GPSCoords::getHDOP() {
+	return _hdop;
+}
+
+// Returns true if the receiver reported a position fix (fix quality other than FIX_INVALID)
+bool GPSCoords::isValid() {
+	return _fixQuality != FIX_INVALID;
+}
+
+// Gets the time of the fix in milliseconds since midnight UTC; 0 if it has none
+unsigned long GPSCoords::getMillisOfDay() {
+	return hasTime() ? _millisOfDay : 0;
+}
+
+/* Packs these coordinates into a PackedFix.
+ * Altitude is rounded to the meter; HDOP is truncated to the tenth and saturates, as does the satellite count.
+ * An unknown time or HDOP is packed as PackedFix::TIME_UNKNOWN or HDOP_UNKNOWN, and unpacked as unknown again.
+ */
+PackedFix GPSCoords::toPackedFix() {
+	PackedFix fix;
+	fix.lat = _lat;
+	fix.lon = _lon;
+	fix.millisOfDay = hasTime() ? _millisOfDay : PackedFix::TIME_UNKNOWN;
+	fix.fixQuality = min((int) _fixQuality, 7);
+	fix.reserved = 0;
+	fix.alt = (long) ((_alt >= 0) ? (_alt + 0.5) : (_alt - 0.5));
+	fix.numSatellites = min((int) _numSatellites, 31);
+	fix.hdopTenths = (_hdop == HDOP_UNKNOWN) ? PackedFix::HDOP_UNKNOWN : min(_hdop / 10, (int) PackedFix::HDOP_MAX);
+	return fix;
+}
+
+/* Parses a time in the $GPGGA format (hhmmss.sss, with any number of fractional digits) into milliseconds since
+ * midnight UTC. Returns 0 if the string is too short to hold a time.
+ */
+unsigned long GPSCoords::parseMillisOfDay(const char *time) {
+	unsigned int length = strlen(time);
+	if(length < 6)
+		return 0;
+	unsigned long hours = (time[0] - '0') * 10 + (time[1] - '0');
+	unsigned long minutes = (time[2] - '0') * 10 + (time[3] - '0');
+	unsigned long seconds = (time[4] - '0') * 10 + (time[5] - '0');
+	unsigned long fraction = 0;
+	unsigned int digits = 0; // Fractional digits read, up to the millisecond
+	for(unsigned int i = 7; (i < length) && (digits < 3); i++, digits++)
+		fraction = fraction * 10 + (time[i] - '0');
+	for(; digits < 3; digits++)
+		fraction *= 10;
+	return ((hours * 60 + minutes) * 60 + seconds) * 1000 + fraction;
+}
+
+/* Formats the coordinates for text according to one of the FORMAT constants, into buffer.
+ * Returns the length of the text; at most size - 1 characters are written. TEXT_SIZE is always enough.
+ */
+int GPSCoords::formatCoordsForText(int format, char *buffer, int size) {
+	BPPCELL_STAT_SCOPE(COORDS_FORMAT);
+	TextWriter out(buffer, size);
+	char field[24]; // The formatted time or a decimal degree value
 	switch (format) {
 		case FORMAT_DMS: { // Degrees, minutes, and seconds; multiple lines
 			DMSCoords coords = getLatLonInDMS();
-			returnString += ("Time: " + getFormattedTimeString() + " UTC\n");
-			returnString += "Lat: ";
-			returnString += coords.latDegs;
-			returnString += char(0xB0);
-			returnString += " ";
-			returnString += coords.latMins;
-			returnString += "' ";
-			returnString += coords.latSecs;
-			returnString += "\" ";
+			getFormattedTimeString(field, sizeof(field));
+			out.print(F("Time: "));
+			out.print(field);
+			out.print(F(" UTC\n"));
+			out.print(F("Lat: "));
+			out.print(coords.latDegs);
+			out.print(char(0xB0));
+			out.print(F(" "));
+			out.print(coords.latMins);
+			out.print(F("' "));
+			out.printFixed(coords.latSecs);
+			out.print(F("\" "));
 			if(coords.isNorth) 
-				returnString += "N ";
+				out.print(F("N "));
 			else
-				returnString += "S ";
-			returnString += "\n";
-			returnString += "Lon: ";
-			returnString += coords.lonDegs;
-			returnString += char(0xB0);
-			returnString += " ";
-			returnString += coords.lonMins;
-			returnString += "' ";
-			returnString += coords.lonSecs;
-			returnString += "\" ";
+				out.print(F("S "));
+			out.print(F("\n"));
+			out.print(F("Lon: "));
+			out.print(coords.lonDegs);
+			out.print(char(0xB0));
+			out.print(F(" "));
+			out.print(coords.lonMins);
+			out.print(F("' "));
+			out.printFixed(coords.lonSecs);
+			out.print(F("\" "));
 			if(coords.isEast) 
-				returnString += "E ";
+				out.print(F("E "));
 			else
-				returnString += "W ";
-			returnString += "\n";
-			returnString += (String("Alt: ") + getAlt() + "m MSL");
+				out.print(F("W "));
+			out.print(F("\n"));
+			out.print(F("Alt: "));
+			out.printFixed(getAlt());
+			out.print(F("m MSL"));
 			break;
 		}
 		case FORMAT_DMS_ONELINE: {
 			DMSCoords coords = getLatLonInDMS();
-			returnString += ("Time: " + getFormattedTimeString() + " UTC ");
-			returnString += "Lat: ";
-			returnString += coords.latDegs;
-			returnString += char(0xB0);
-			returnString += " ";
-			returnString += coords.latMins;
-			returnString += "' ";
-			returnString += coords.latSecs;
-			returnString += "\" ";
+			getFormattedTimeString(field, sizeof(field));
+			out.print(F("Time: "));
+			out.print(field);
+			out.print(F(" UTC "));
+			out.print(F("Lat: "));
+			out.print(coords.latDegs);
+			out.print(char(0xB0));
+			out.print(F(" "));
+			out.print(coords.latMins);
+			out.print(F("' "));
+			out.printFixed(coords.latSecs);
+			out.print(F("\" "));
 			if(coords.isNorth) 
-				returnString += "N ";
+				out.print(F("N "));
 			else
-				returnString += "S ";
-			returnString += "Lon: ";
-			returnString += coords.lonDegs;
-			returnString += char(0xB0);
-			returnString += " ";
-			returnString += coords.lonMins; 
-			returnString += "' ";
-			returnString += coords.lonSecs;
-			returnString += "\" ";
+				out.print(F("S "));
+			out.print(F("Lon: "));
+			out.print(coords.lonDegs);
+			out.print(char(0xB0));
+			out.print(F(" "));
+			out.print(coords.lonMins); 
+			out.print(F("' "));
+			out.printFixed(coords.lonSecs);
+			out.print(F("\" "));
 			if(coords.isEast) 
-				returnString += "E ";
+				out.print(F("E "));
 			else
-				returnString += "W ";
-			returnString += (String("Alt: ") + getAlt() + "m MSL");
+				out.print(F("W "));
+			out.print(F("Alt: "));
+			out.printFixed(getAlt());
+			out.print(F("m MSL"));
 			break;
 		}
 		case FORMAT_DMS_CSV: {
 			DMSCoords coords = getLatLonInDMS();
-			returnString += getFormattedTimeString();
-			returnString += ",";
+			getFormattedTimeString(field, sizeof(field));
+			out.print(field);
+			out.print(',');
 			if(!coords.isNorth) 
-				returnString += "-";
-			returnString += coords.latDegs;
-			returnString += ",";
-			returnString += coords.latMins;
-			returnString += ",";
-			returnString += coords.latSecs;
-			returnString += ",";
+				out.print('-');
+			out.print(coords.latDegs);
+			out.print(',');
+			out.print(coords.latMins);
+			out.print(',');
+			out.printFixed(coords.latSecs);
+			out.print(',');
 
 			if(!coords.isEast) 
-				returnString += "-";
-			returnString += coords.lonDegs;
-			returnString += ",";
-			returnString += coords.lonMins;
-			returnString += ",";
-			returnString += coords.lonSecs;
-			returnString += ",";
-
-			returnString += getAlt();
+				out.print('-');
+			out.print(coords.lonDegs);
+			out.print(',');
+			out.print(coords.lonMins);
+			out.print(',');
+			out.printFixed(coords.lonSecs);
+			out.print(',');
+
+			out.printFixed(getAlt());
 			break;
 		}
 		case FORMAT_DEC_DEGS: {
 			DecDegsCoords coords = getLatLonInDecDegs();
-			returnString += ("Time: " + getFormattedTimeString() + " UTC \n");
-			returnString += "Lat: ";
-			returnString += getDecDegsLatString(coords);
-			returnString += char(0xB0);
-			returnString += "\n";
-			returnString += "Lon: ";
-			returnString += getDecDegsLonString(coords);
-			returnString += char(0xB0);
-			returnString += "\n";
-			returnString += "Alt: ";
-			returnString += getAlt();
-			returnString += "m MSL";
+			getFormattedTimeString(field, sizeof(field));
+			out.print(F("Time: "));
+			out.print(field);
+			out.print(F(" UTC \n"));
+			out.print(F("Lat: "));
+			getDecDegsLatString(coords, field, sizeof(field));
+			out.print(field);
+			out.print(char(0xB0));
+			out.print(F("\n"));
+			out.print(F("Lon: "));
+			getDecDegsLonString(coords, field, sizeof(field));
+			out.print(field);
+			out.print(char(0xB0));
+			out.print(F("\n"));
+			out.print(F("Alt: "));
+			out.printFixed(getAlt());
+			out.print(F("m MSL"));
 			break;
 		}
 		case FORMAT_DEC_DEGS_CSV: {
 			DecDegsCoords coords = getLatLonInDecDegs();
-			returnString += (getFormattedTimeString() + ",");
-			returnString += getDecDegsLatString(coords);
-			returnString += ",";
-			returnString += getDecDegsLonString(coords);
-			returnString += ",";
-			returnString += getAlt();
+			getFormattedTimeString(field, sizeof(field));
+			out.print(field);
+			out.print(',');
+			getDecDegsLatString(coords, field, sizeof(field));
+			out.print(field);
+			out.print(',');
+			getDecDegsLonString(coords, field, sizeof(field));
+			out.print(field);
+			out.print(',');
+			out.printFixed(getAlt());
 			break;
 		}
 	}
-	return returnString;
+	BPPCELL_STAT_BYTES(out.length());
+	return out.length();
 }
 
-
 // Gets the coordinates stored by this GPSCoords object in a DMSCoords struct, which gives degree-minute-second formatting
 DMSCoords GPSCoords::getLatLonInDMS(void) {
 	DMSCoords coords;
-	long localLat = abs(_lat);
-	long localLon = abs(_lon);
+	unsigned long localLat = abs(_lat);
+	unsigned long localLon = abs(_lon);
 	
-	int latDegs = (int) (localLat/(MINUTES_PER_DEGREE*TEN_THOUSANDTHS_PER_MINUTE));
-	localLat = localLat % (MINUTES_PER_DEGREE*TEN_THOUSANDTHS_PER_MINUTE);
-	coords.latDegs = latDegs;
-	int lonDegs = (int) (localLon/(MINUTES_PER_DEGREE*TEN_THOUSANDTHS_PER_MINUTE));
-	localLon = localLon % (MINUTES_PER_DEGREE*TEN_THOUSANDTHS_PER_MINUTE);
-	coords.lonDegs = lonDegs;
+	coords.latDegs = (int) DegreeDivisor::divide(localLat, localLat);
+	coords.lonDegs = (int) DegreeDivisor::divide(localLon, localLon);
 	
-	int latMins = (int) (localLat/TEN_THOUSANDTHS_PER_MINUTE);
-	localLat = localLat % (TEN_THOUSANDTHS_PER_MINUTE);
-	coords.latMins = latMins;
-	int lonMins = (int) (localLon/TEN_THOUSANDTHS_PER_MINUTE);
-	localLon = localLon % (TEN_THOUSANDTHS_PER_MINUTE);
-	coords.lonMins = lonMins;
+	coords.latMins = (int) MinuteDivisor::divide(localLat, localLat);
+	coords.lonMins = (int) MinuteDivisor::divide(localLon, localLon);
 	
+	// The one division left is in floating point; a reciprocal multiply would round differently in the last place
 	float latSecs = ((float) (localLat*SECONDS_PER_MINUTE)/TEN_THOUSANDTHS_PER_MINUTE);
 	coords.latSecs = latSecs;
 	float lonSecs = ((float) (localLon*SECONDS_PER_MINUTE)/TEN_THOUSANDTHS_PER_MINUTE);
@@ -236,68 +370,184 @@ DMSCoords GPSCoords::getLatLonInDMS(void) {
  */
 DecDegsCoords GPSCoords::getLatLonInDecDegs(void) {
 	DecDegsCoords coords; 
-	coords.latChar = _lat / (MINUTES_PER_DEGREE*TEN_THOUSANDTHS_PER_MINUTE); // Characteristic is whole number of degrees
-
-	coords.latMant = (abs(_lat) % (MINUTES_PER_DEGREE*TEN_THOUSANDTHS_PER_MINUTE))
-		/ ((float) (MINUTES_PER_DEGREE*TEN_THOUSANDTHS_PER_MINUTE)); // Mantissa is remainder
-	coords.lonChar = _lon / (MINUTES_PER_DEGREE*TEN_THOUSANDTHS_PER_MINUTE); // Characteristic is whole number of degrees
-	coords.lonMant = (abs(_lon) % (MINUTES_PER_DEGREE*TEN_THOUSANDTHS_PER_MINUTE))
-		/ ((float) (MINUTES_PER_DEGREE*TEN_THOUSANDTHS_PER_MINUTE)); // Mantissa is remainder
+	unsigned long latRemainder;
+	long latDegs = (long) DegreeDivisor::divide(abs(_lat), latRemainder);
+	coords.latChar = (_lat >= 0) ? latDegs : -latDegs; // Characteristic is whole number of degrees, truncated toward zero
+	coords.latMant = latRemainder / ((float) (MINUTES_PER_DEGREE*TEN_THOUSANDTHS_PER_MINUTE)); // Mantissa is remainder
+	unsigned long lonRemainder;
+	long lonDegs = (long) DegreeDivisor::divide(abs(_lon), lonRemainder);
+	coords.lonChar = (_lon >= 0) ? lonDegs : -lonDegs; // Characteristic is whole number of degrees, truncated toward zero
+	coords.lonMant = lonRemainder / ((float) (MINUTES_PER_DEGREE*TEN_THOUSANDTHS_PER_MINUTE)); // Mantissa is remainder
 	return coords;
 }
 
-// Gets a time string with punctuation based on this GPSCoords object's time
-// Assumes this GPSCoords object's time is in the format of a $GPGGA string (see UBlox documentation for futher details)
-String GPSCoords::getFormattedTimeString() {
-	String returnString = "";
-	returnString += (_time.substring(0, 2) + ":" + _time.substring(2,4) + ":" + _time.substring(4));
-	return returnString;	
+// Gets a time string with punctuation based on this GPSCoords object's time (hh:mm:ss.ss), into buffer; "::" if it has none
+int GPSCoords::getFormattedTimeString(char *buffer, int size) {
+	TextWriter out(buffer, size);
+	if(hasTime())
+		printTime(out, _millisOfDay, _timeDecimals, true);
+	else
+		out.print(F("::"));
+	return out.length();
 }
 
-// Gets the string representation of the latitude in decimal degrees
-String GPSCoords::getDecDegsLatString() {
+// Formats milliseconds since midnight UTC as getFormattedTimeString() does, to the hundredth (hh:mm:ss.ss), into buffer
+// "::" for TIME_UNKNOWN or any value past the end of the day
+int GPSCoords::formatMillisOfDay(unsigned long millisOfDay, char *buffer, int size) {
+	TextWriter out(buffer, size);
+	if(millisOfDay < MILLIS_PER_DAY)
+		printTime(out, millisOfDay, 2, true);
+	else
+		out.print(F("::"));
+	return out.length();
+}
+
+// Prints a time of day as hhmmss or hh:mm:ss, with the given number of fractional digits
+void GPSCoords::printTime(Print &out, unsigned long millisOfDay, byte decimals, bool colons) {
+	unsigned long fields[3]; // Hours, minutes and seconds
+	unsigned long millis;
+	fields[0] = HourMillisDivisor::divide(millisOfDay, millis);
+	fields[1] = MinuteMillisDivisor::divide(millis, millis);
+	fields[2] = SecondMillisDivisor::divide(millis, millis);
+	for(int i = 0; i < 3; i++) {
+		if(colons && (i > 0))
+			out.print(':');
+		unsigned long ones;
+		out.print((char) ('0' + TenDivisor::divide(fields[i], ones)));
+		out.print((char) ('0' + ones));
+	}
+	if(decimals > 0)
+		out.print('.');
+	unsigned long digits[3]; // Tenths, hundredths and thousandths
+	unsigned long tens = TenDivisor::divide(millis, digits[2]);
+	digits[0] = TenDivisor::divide(tens, digits[1]);
+	for(byte i = 0; i < decimals; i++)
+		out.print((char) ('0' + digits[i]));
+}
+
+// Gets the string representation of the latitude in decimal degrees, into buffer
+int GPSCoords::getDecDegsLatString(char *buffer, int size) {
 	DecDegsCoords coords = getLatLonInDecDegs();
-	return getDecDegsLatString(coords);
+	return getDecDegsLatString(coords, buffer, size);
 }
 
-// Gets the string representation of the longitude in decimal degrees
-String GPSCoords::getDecDegsLonString() {
+// Gets the string representation of the longitude in decimal degrees, into buffer
+int GPSCoords::getDecDegsLonString(char *buffer, int size) {
 	DecDegsCoords coords = getLatLonInDecDegs();
-	return getDecDegsLonString(coords);
+	return getDecDegsLonString(coords, buffer, size);
 }
 
-// Gets the string representation of the latitude in decimal degrees
-// Input is the DecDegs struct representing the coordinates to convert
-String GPSCoords::getDecDegsLatString(DecDegsCoords coords) {
-	String decLatString = "";
-	decLatString += coords.latChar; // Append the characteristic
+// Writes a decimal degree value from its characteristic and mantissa, with seven decimal places
+static int formatDecDegs(int characteristic, float mantissa, char *buffer, int size) {
+	TextWriter out(buffer, size);
+	out.print(characteristic); // Append the characteristic
 	
 	const int mantissaDisplayLength = 7; // Number of digits of the mantissa to display
 	const int mantissaStrArrLength = 9; // Must have a place for the leading zero and decimal point
-	char latMantStrArray[mantissaStrArrLength];
-	dtostrf(coords.latMant, mantissaStrArrLength, mantissaDisplayLength, latMantStrArray); // Convert mantissa to a char array
+	char mantStrArray[mantissaStrArrLength + 1]; // And the null
+	dtostrf(mantissa, mantissaStrArrLength, mantissaDisplayLength, mantStrArray); // Convert mantissa to a char array
 	
-	String latMantString = "";
-	latMantString += latMantStrArray; // Convert the char array to a string
-	
-	decLatString += latMantString.substring(1); // Drop the leading zero of the mantissa and append it to the string
-	return decLatString;
+	out.print(mantStrArray + 1); // Drop the leading zero of the mantissa and append it
+	return out.length();
+}
+
+// Gets the string representation of the latitude in decimal degrees, into buffer
+// Input is the DecDegs struct representing the coordinates to convert
+int GPSCoords::getDecDegsLatString(DecDegsCoords coords, char *buffer, int size) {
+	return formatDecDegs(coords.latChar, coords.latMant, buffer, size);
 }
 
-// Gets the string representation of the longitude in decimal degrees
+// Gets the string representation of the longitude in decimal degrees, into buffer
 // Input is the DecDegs struct representing the coordinates to convert
+int GPSCoords::getDecDegsLonString(DecDegsCoords coords, char *buffer, int size) {
+	return formatDecDegs(coords.lonChar, coords.lonMant, buffer, size);
+}
+
+// Gets the distance to other in meters. See GeoMath::distance() for the approximations used.
+long GPSCoords::distanceTo(GPSCoords &other) {
+	return GeoMath::distance(_lat, _lon, other._lat, other._lon);
+}
+
+/* Gets the bearing to other in hundredths of a degree clockwise from true north, from 0 to 35999.
+ * Taken on the local tangent plane, so it is the initial great-circle bearing only for nearby points (within a degree or so).
+ */
+long GPSCoords::bearingTo(GPSCoords &other) {
+	long north;
+	long east;
+	GeoMath::displacement(_lat, _lon, other._lat, other._lon, north, east);
+	return GeoMath::atan2Bearing(east, north);
+}
+
+/* Gets the coordinates displaced from these by the given number of meters north and east, on the local tangent plane.
+ * The time, altitude and fix quality fields are copied unchanged.
+ */
+GPSCoords GPSCoords::offsetBy(long north, long east) {
+	long lat = _lat + GeoMath::fromMeters(north);
+	long cosLat = GeoMath::cosQ15(_lat + ((lat - _lat) >> 1));
+	if(cosLat < 1) // At the poles every longitude is the same point
+		cosLat = 1;
+	long lon = _lon + (long) (((long long) GeoMath::fromMeters(east) << 15) / cosLat); // The one 64-bit division per call
+	GPSCoords offset(*this);
+	offset._lat = lat;
+	offset._lon = GeoMath::wrapLon(lon);
+	return offset;
+}
+
+#ifndef BPPCELL_NO_HEAP
+
+// String counterparts of the methods above, which they call
+
+GPSCoords::GPSCoords(String time, long lat, long lon, float alt) : GPSCoords(time.c_str(), lat, lon, alt) {
+}
+
+void GPSCoords::setTime(String time) {
+	setTime(time.c_str());
+}
+
+String GPSCoords::getTime() {
+	char text[TIME_SIZE];
+	getTime(text, sizeof(text));
+	return String(text);
+}
+
+unsigned long GPSCoords::parseMillisOfDay(String time) {
+	return parseMillisOfDay(time.c_str());
+}
+
+String GPSCoords::formatCoordsForText(int format) {
+	char text[TEXT_SIZE];
+	formatCoordsForText(format, text, sizeof(text));
+	return String(text);
+}
+
+String GPSCoords::getFormattedTimeString() {
+	char text[TEXT_SIZE];
+	getFormattedTimeString(text, sizeof(text));
+	return String(text);
+}
+
+String GPSCoords::getDecDegsLatString() {
+	char text[TEXT_SIZE];
+	getDecDegsLatString(text, sizeof(text));
+	return String(text);
+}
+
+String GPSCoords::getDecDegsLonString() {
+	char text[TEXT_SIZE];
+	getDecDegsLonString(text, sizeof(text));
+	return String(text);
+}
+
+String GPSCoords::getDecDegsLatString(DecDegsCoords coords) {
+	char text[TEXT_SIZE];
+	getDecDegsLatString(coords, text, sizeof(text));
+	return String(text);
+}
+
 String GPSCoords::getDecDegsLonString(DecDegsCoords coords) {
-	String decLonString = "";
-	decLonString += coords.lonChar; // Append the characteristic
-	
-	const int mantissaDisplayLength = 7; // Number of digits of the mantissa to display
-	const int mantissaStrArrLength = 9; // Must have a place for the leading zero and decimal point
-	char lonMantStrArray[mantissaStrArrLength];
-	dtostrf(coords.lonMant, mantissaStrArrLength, mantissaDisplayLength, lonMantStrArray); // Convert mantissa to a char array
-	
-	String lonMantString = "";
-	lonMantString += lonMantStrArray; // Convert the char array to a string
-	
-	decLonString += lonMantString.substring(1); // Drop the leading zero of the mantissa and append it to the string
-	return decLonString;
+	char text[TEXT_SIZE];
+	getDecDegsLonString(coords, text, sizeof(text));
+	return String(text);
 }
+
+#endif
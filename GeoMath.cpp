@@ -0,0 +1,258 @@
+/* Fixed-Point Geodesic Kernels for Arduino
+ * Developed for the Space Systems Laboratory at the University of Maryland
+ * Part of the BPPCell library
+ * See GitHub.com/UMDBPP/BPPCell or the accompanying readme for further details.
+ *
+ * Copyright (c) 2015 Luke Renegar
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#define BPPCELL_SOURCE
+#include "Arduino.h"
+#include "BPPCell.h"
+#include <avr/pgmspace.h>
+
+/* Cosine in Q15, one entry per 2^19 ten-thousandths of a minute (~0.874 degrees) from 0 to just past 90 degrees.
+ * cos(0) is stored as 32767 so that every entry fits in an int16_t.
+ */
+const int16_t COS_TABLE_Q15[] PROGMEM = {
+	32767, 32764, 32753, 32734, 32707, 32673, 32631, 32581,
+	32524, 32460, 32388, 32308, 32221, 32126, 32024, 31914,
+	31797, 31673, 31541, 31402, 31255, 31102, 30941, 30773,
+	30597, 30415, 30226, 30029, 29825, 29615, 29398, 29174,
+	28943, 28705, 28461, 28210, 27952, 27688, 27418, 27141,
+	26858, 26568, 26273, 25971, 25663, 25349, 25030, 24704,
+	24373, 24036, 23694, 23346, 22993, 22634, 22270, 21901,
+	21526, 21147, 20763, 20374, 19980, 19582, 19179, 18771,
+	18360, 17944, 17523, 17099, 16671, 16239, 15803, 15363,
+	14920, 14473, 14023, 13570, 13113, 12654, 12192, 11726,
+	11258, 10788, 10315, 9839, 9361, 8881, 8399, 7915,
+	7429, 6942, 6453, 5962, 5470, 4977, 4482, 3986,
+	3490, 2993, 2495, 1996, 1497, 998, 498, -2
+};
+
+// Arctangent in hundredths of a degree of k/64, for k from 0 to 64
+const int16_t ATAN_TABLE[] PROGMEM = {
+	0, 90, 179, 268, 358, 447, 536, 624,
+	713, 800, 888, 975, 1062, 1148, 1234, 1319,
+	1404, 1488, 1571, 1653, 1735, 1817, 1897, 1977,
+	2056, 2134, 2211, 2287, 2363, 2438, 2511, 2584,
+	2657, 2728, 2798, 2867, 2936, 3003, 3070, 3136,
+	3201, 3264, 3327, 3390, 3451, 3511, 3571, 3629,
+	3687, 3744, 3800, 3855, 3909, 3963, 4016, 4067,
+	4119, 4169, 4218, 4267, 4315, 4363, 4409, 4455,
+	4500
+};
+
+/* Gets the cosine of an angle in ten-thousandths of a minute, in Q15.
+ * Absolute error is at most 8e-5 (3 LSB), from interpolation and table rounding.
+ */
+int GeoMath::cosQ15(long angle) {
+	long a = abs(angle);
+	if(a >= FULL_TURN) // Coordinates and differences of coordinates never get here, so the division is rarely paid for
+		a %= FULL_TURN;
+	if(a > HALF_TURN)
+		a = FULL_TURN - a;
+	if(a > QUARTER_TURN)
+		return -cosQ15(HALF_TURN - a);
+	
+	int index = (int) (a >> COS_TABLE_SHIFT);
+	long frac = a & ((1L << COS_TABLE_SHIFT) - 1);
+	long c0 = (int16_t) pgm_read_word(&COS_TABLE_Q15[index]);
+	long c1 = (int16_t) pgm_read_word(&COS_TABLE_Q15[index + 1]);
+	return (int) (c0 + (((c1 - c0) * frac) >> COS_TABLE_SHIFT));
+}
+
+/* Gets the sine of an angle in ten-thousandths of a minute, in Q15.
+ * Within SMALL_ANGLE_LIMIT of zero, a fifth-order Taylor series is used instead of the table so that small sines
+ * (as in the haversine formula) keep their relative precision; absolute error there is at most 2 LSB.
+ * Elsewhere the error is that of cosQ15().
+ */
+int GeoMath::sinQ15(long angle) {
+	if(abs(angle) > SMALL_ANGLE_LIMIT)
+		return cosQ15(QUARTER_TURN - angle);
+	
+	// Radians in Q15, from the multiplier 2^15 * pi / (180 * 600000) in Q26, split so that neither product overflows
+	long a = abs(angle); // The shifts below round toward minus infinity, so the series is taken on the magnitude
+	long hi = a >> 16;
+	unsigned long lo = (unsigned long) (a & 0xFFFF);
+	long x = ((hi * RADIANS_Q15_PER_TEN_THOUSANDTH_Q26) + (long) ((lo * (unsigned long) RADIANS_Q15_PER_TEN_THOUSANDTH_Q26) >> 16) + 512) >> 10;
+	
+	long x2 = (x * x) >> 15;
+	long x3 = (x2 * x) >> 15;
+	long x5 = (x3 * x2) >> 15;
+	int sine = (int) (x - ((x3 * 5461) >> 15) + ((x5 * 273) >> 15)); // 1/6 and 1/120 in Q15
+	return (angle < 0) ? -sine : sine;
+}
+
+/* Gets the bearing of the vector (east, north) in hundredths of a degree clockwise from north, from 0 to 35999.
+ * The inputs may be in any common unit. Absolute error is at most 2 hundredths of a degree.
+ * One 32-bit division is needed to form the tangent.
+ */
+long GeoMath::atan2Bearing(long east, long north) {
+	long e = abs(east);
+	long n = abs(north);
+	if((e == 0) && (n == 0))
+		return 0;
+	while((e | n) >= 65536) { // Keeps the shifted numerator below 2^31
+		e >>= 1;
+		n >>= 1;
+	}
+	
+	bool steep = e > n; // Past 45 degrees from north, use the complementary angle so the tangent stays at or below 1
+	long tanQ15 = steep ? ((n << 15) / e) : ((e << 15) / n);
+	int index = (int) (tanQ15 >> ATAN_TABLE_SHIFT);
+	long angle;
+	if(index >= 64) {
+		angle = 4500;
+	}
+	else {
+		long frac = tanQ15 & ((1L << ATAN_TABLE_SHIFT) - 1);
+		long a0 = (int16_t) pgm_read_word(&ATAN_TABLE[index]);
+		long a1 = (int16_t) pgm_read_word(&ATAN_TABLE[index + 1]);
+		angle = a0 + (((a1 - a0) * frac) >> ATAN_TABLE_SHIFT);
+	}
+	if(steep)
+		angle = 9000 - angle;
+	
+	if(north >= 0)
+		return (east >= 0) ? angle : ((36000 - angle) % 36000);
+	else
+		return (east >= 0) ? (18000 - angle) : (18000 + angle);
+}
+
+// Gets the integer square root (floor) of value
+unsigned long GeoMath::isqrt(unsigned long value) {
+	unsigned long result = 0;
+	unsigned long bit = 1UL << 30;
+	while(bit > value)
+		bit >>= 2;
+	while(bit != 0) {
+		if(value >= result + bit) {
+			value -= result + bit;
+			result = (result >> 1) + bit;
+		}
+		else {
+			result >>= 1;
+		}
+		bit >>= 2;
+	}
+	return result;
+}
+
+// Gets the integer square root of value, rounded to nearest, so that the distances below are not biased short
+static unsigned long roundedSqrt(unsigned long value) {
+	unsigned long root = GeoMath::isqrt(value);
+	return (value - root * root > root) ? root + 1 : root;
+}
+
+/* Converts a difference in latitude (ten-thousandths of a minute) to meters along a meridian.
+ * Exact to within a meter over the whole range of a long.
+ */
+long GeoMath::toMeters(long delta) {
+	return ((delta >> 16) * METERS_PER_TEN_THOUSANDTH_Q16) + (((delta & 0xFFFF) * METERS_PER_TEN_THOUSANDTH_Q16 + 0x8000) >> 16);
+}
+
+/* Converts meters along a meridian to ten-thousandths of a minute of latitude.
+ * Valid for any distance on the Earth's surface (up to about 2 * 10^7 m).
+ */
+long GeoMath::fromMeters(long meters) {
+	return ((meters >> 12) * TEN_THOUSANDTHS_PER_METER_Q12) + (((meters & 0xFFF) * TEN_THOUSANDTHS_PER_METER_Q12) >> 12);
+}
+
+// Multiplies value by a Q15 factor without overflowing 32 bits
+long GeoMath::mulQ15(long value, int factorQ15) {
+	return ((value >> 15) * factorQ15) + (((value & 0x7FFF) * factorQ15 + 0x4000) >> 15);
+}
+
+// Wraps a longitude or difference of longitudes into [-180, 180] degrees
+long GeoMath::wrapLon(long lon) {
+	if(lon > HALF_TURN)
+		return lon - FULL_TURN;
+	if(lon < -HALF_TURN)
+		return lon + FULL_TURN;
+	return lon;
+}
+
+/* Gets the displacement in meters from (lat1, lon1) to (lat2, lon2) on the local tangent plane
+ * (equirectangular projection about the mean latitude). Coordinates are in ten-thousandths of a minute.
+ */
+void GeoMath::displacement(long lat1, long lon1, long lat2, long lon2, long &north, long &east) {
+	long dLat = lat2 - lat1;
+	long dLon = wrapLon(lon2 - lon1);
+	north = toMeters(dLat);
+	east = mulQ15(toMeters(dLon), cosQ15(lat1 + (dLat >> 1)));
+}
+
+/* Gets the distance in meters between two points by the equirectangular approximation.
+ * Within one degree of arc (EQUIRECTANGULAR_LIMIT) along each axis and 80 degrees of latitude, the error against a
+ * spherical great circle is below 0.1% or 2 m, whichever is larger.
+ */
+long GeoMath::equirectangularDistance(long lat1, long lon1, long lat2, long lon2) {
+	long north;
+	long east;
+	displacement(lat1, lon1, lat2, lon2, north, east);
+	unsigned long n = abs(north);
+	unsigned long e = abs(east);
+	int shift = 0;
+	while((n | e) >= 32768) { // Keeps the sum of squares below 2^31
+		n >>= 1;
+		e >>= 1;
+		shift++;
+	}
+	return (long) (roundedSqrt(n * n + e * e) << shift);
+}
+
+/* Gets the distance in meters between two points by the haversine formula, using asin(x) ~ x + x^3/6.
+ * The error against a spherical great circle is below 0.3% for any separation from one degree of arc to about
+ * 5000 km; it is limited mostly by the Q15 resolution of the sines. Within a degree of either pole, where the cosines
+ * are small, it is below 0.6%.
+ */
+long GeoMath::haversineDistance(long lat1, long lon1, long lat2, long lon2) {
+	long sinHalfDLat = sinQ15((lat2 - lat1) >> 1);
+	long sinHalfDLon = sinQ15(wrapLon(lon2 - lon1) >> 1);
+	long cos1SinHalfDLon = (long) cosQ15(lat1) * sinHalfDLon; // Q30
+	long cos2SinHalfDLon = (long) cosQ15(lat2) * sinHalfDLon; // Q30
+	// The longitude term is one 64-bit product; at high latitudes it is too small to survive intermediate Q15 truncation
+	unsigned long h = (unsigned long) (sinHalfDLat * sinHalfDLat) + (unsigned long) (((long long) cos1SinHalfDLon * cos2SinHalfDLon) >> 30); // Q30
+	if(h >= (1UL << 30))
+		h = (1UL << 30) - 1;
+	
+	unsigned long x = roundedSqrt(h << 2); // Sine of half the central angle, Q16
+	unsigned long x3 = (((x * x) >> 16) * x) >> 16;
+	unsigned long halfAngle = x + ((x3 * 10923) >> 16); // 10923 is 1/6 in Q16
+	if(halfAngle > 65535) // Beyond the range of the series (and of the split multiply below)
+		halfAngle = 65535;
+	return (long) (((EARTH_DIAMETER >> 16) * halfAngle) + (((EARTH_DIAMETER & 0xFFFF) * halfAngle) >> 16));
+}
+
+/* Gets the distance in meters between two points, using the cheaper equirectangular approximation when the points
+ * are within EQUIRECTANGULAR_LIMIT of arc of each other along both axes, and the haversine formula otherwise.
+ * Near the poles a short arc can span a wide difference of longitude, across which the tangent plane does not hold,
+ * so the approximation is also limited to EQUIRECTANGULAR_LON_LIMIT of longitude.
+ */
+long GeoMath::distance(long lat1, long lon1, long lat2, long lon2) {
+	long dLon = abs(wrapLon(lon2 - lon1));
+	long eastArc = mulQ15(dLon, cosQ15(lat1)); // Longitude difference as arc along the parallel
+	if((abs(lat2 - lat1) <= EQUIRECTANGULAR_LIMIT) && (eastArc <= EQUIRECTANGULAR_LIMIT) && (dLon <= EQUIRECTANGULAR_LON_LIMIT))
+		return equirectangularDistance(lat1, lon1, lat2, lon2);
+	return haversineDistance(lat1, lon1, lat2, lon2);
+}
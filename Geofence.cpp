@@ -0,0 +1,236 @@
+/* Geofence Engine for Arduino
+ * Developed for the Space Systems Laboratory at the University of Maryland
+ * Part of the BPPCell library
+ * See GitHub.com/UMDBPP/BPPCell or the accompanying readme for further details.
+ *
+ * Copyright (c) 2015 Luke Renegar
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#define BPPCELL_SOURCE
+#include "Arduino.h"
+#include "BPPCell.h"
+#include <avr/pgmspace.h>
+
+Geofence::Geofence() {
+	clear();
+}
+
+// Removes all fences
+void Geofence::clear() {
+	_numFences = 0;
+}
+
+int Geofence::getNumFences() {
+	return _numFences;
+}
+
+/* Adds a polygon fence from edges made by precomputeEdges() (or a table printed by printEdgeTable()).
+ * The edges are not copied, so they must outlive this object. Set inProgmem if they are stored in PROGMEM.
+ * Returns false if the fence table is full or there are no edges.
+ */
+bool Geofence::addPolygon(const GeofenceEdge *edges, int numEdges, int id, bool inProgmem) {
+	if((_numFences >= GEOFENCE_MAX_FENCES) || (numEdges <= 0))
+		return false;
+	
+	Fence &fence = _fences[_numFences];
+	fence.type = TYPE_POLYGON;
+	fence.inProgmem = inProgmem;
+	fence.id = id;
+	fence.edges = edges;
+	fence.numEdges = numEdges;
+	
+	// The bounding box is taken once here so that containment checks can reject without touching the edges
+	for(int i = 0; i < numEdges; i++) {
+		GeofenceEdge edge;
+		if(inProgmem)
+			memcpy_P(&edge, &edges[i], sizeof(GeofenceEdge));
+		else
+			edge = edges[i];
+		long lonMin = min(edge.lonLow, edge.lonHigh);
+		long lonMax = max(edge.lonLow, edge.lonHigh);
+		if((i == 0) || (edge.latLow < fence.latMin))
+			fence.latMin = edge.latLow;
+		if((i == 0) || (edge.latHigh > fence.latMax))
+			fence.latMax = edge.latHigh;
+		if((i == 0) || (lonMin < fence.lonMin))
+			fence.lonMin = lonMin;
+		if((i == 0) || (lonMax > fence.lonMax))
+			fence.lonMax = lonMax;
+	}
+	_numFences++;
+	return true;
+}
+
+/* Adds a circular fence around (lat, lon), in ten-thousandths of a minute, with the given radius in meters.
+ * Returns false if the fence table is full.
+ */
+bool Geofence::addCircle(long lat, long lon, long radius, int id) {
+	if(_numFences >= GEOFENCE_MAX_FENCES)
+		return false;
+	
+	Fence &fence = _fences[_numFences];
+	fence.type = TYPE_CIRCLE;
+	fence.inProgmem = false;
+	fence.id = id;
+	fence.edges = NULL;
+	fence.numEdges = 0;
+	fence.centerLat = lat;
+	fence.centerLon = lon;
+	fence.radius = radius;
+	
+	// Bounding box; the longitude half-width is widened by the cosine of the latitude nearest the pole
+	long latHalfWidth = GeoMath::fromMeters(radius);
+	fence.latMin = lat - latHalfWidth;
+	fence.latMax = lat + latHalfWidth;
+	long cosLat = min(GeoMath::cosQ15(fence.latMin), GeoMath::cosQ15(fence.latMax));
+	if(cosLat < 1)
+		cosLat = 1;
+	long lonHalfWidth = (long) (((long long) latHalfWidth << 15) / cosLat);
+	if(lonHalfWidth > GeoMath::HALF_TURN)
+		lonHalfWidth = GeoMath::HALF_TURN;
+	fence.lonMin = lon - lonHalfWidth;
+	fence.lonMax = lon + lonHalfWidth;
+	_numFences++;
+	return true;
+}
+
+/* Checks whether the fence at index (not id) contains (lat, lon), in ten-thousandths of a minute.
+ * Points on the southern or western boundary of a polygon are inside; points on the northern or eastern boundary are not.
+ */
+bool Geofence::fenceContains(int index, long lat, long lon) {
+	if((index < 0) || (index >= _numFences))
+		return false;
+	Fence &fence = _fences[index];
+	if((lat < fence.latMin) || (lat > fence.latMax) || (lon < fence.lonMin) || (lon > fence.lonMax))
+		return false;
+	if(fence.type == TYPE_CIRCLE)
+		return GeoMath::distance(fence.centerLat, fence.centerLon, lat, lon) <= fence.radius;
+	return polygonContains(fence, lat, lon);
+}
+
+// Gets the id of the first fence (in the order added) that contains coords, or NO_FENCE if none does
+int Geofence::firstContaining(GPSCoords &coords) {
+	long lat = coords.getLat();
+	long lon = coords.getLon();
+	for(int i = 0; i < _numFences; i++) {
+		if(fenceContains(i, lat, lon))
+			return _fences[i].id;
+	}
+	return NO_FENCE;
+}
+
+/* Writes the ids of up to maxIds fences that contain coords to ids, in the order the fences were added.
+ * Returns the number of ids written.
+ */
+int Geofence::findContaining(GPSCoords &coords, int *ids, int maxIds) {
+	long lat = coords.getLat();
+	long lon = coords.getLon();
+	int found = 0;
+	for(int i = 0; (i < _numFences) && (found < maxIds); i++) {
+		if(fenceContains(i, lat, lon)) {
+			ids[found] = _fences[i].id;
+			found++;
+		}
+	}
+	return found;
+}
+
+/* Crossing-number test: counts the edges crossed by a ray from the point towards the east.
+ * Edges wholly east or west of the point are settled by comparison alone; only edges whose longitude span straddles
+ * the point need the exact test, which compares two 64-bit products instead of dividing.
+ */
+bool Geofence::polygonContains(Fence &fence, long lat, long lon) {
+	bool inside = false;
+	for(int i = 0; i < fence.numEdges; i++) {
+		GeofenceEdge edge;
+		if(fence.inProgmem)
+			memcpy_P(&edge, &fence.edges[i], sizeof(GeofenceEdge));
+		else
+			edge = fence.edges[i];
+		
+		if((lat < edge.latLow) || (lat >= edge.latHigh)) // Half-open so that a shared vertex is counted once
+			continue;
+		if((lon < edge.lonLow) && (lon < edge.lonHigh)) {
+			inside = !inside;
+		}
+		else if((lon < edge.lonLow) || (lon < edge.lonHigh)) {
+			// Crossed if the point is west of the edge: (lon - lonLow) / (lat - latLow) < dLon / dLat, with dLat > 0
+			long long west = (long long) (lon - edge.lonLow) * edge.dLat;
+			long long crossing = (long long) (lat - edge.latLow) * edge.dLon;
+			if(west < crossing)
+				inside = !inside;
+		}
+	}
+	return inside;
+}
+
+/* Precomputes the edges of the closed polygon with the given vertices (in order, either direction, without repeating
+ * the first vertex at the end). edges must have room for numVertices entries.
+ * Returns the number of edges written, which is less than numVertices if the polygon has horizontal edges.
+ */
+int Geofence::precomputeEdges(const GeofencePoint *vertices, int numVertices, GeofenceEdge *edges) {
+	int numEdges = 0;
+	for(int i = 0; i < numVertices; i++) {
+		const GeofencePoint &a = vertices[i];
+		const GeofencePoint &b = vertices[(i + 1) % numVertices];
+		if(a.lat == b.lat)
+			continue;
+		const GeofencePoint &low = (a.lat < b.lat) ? a : b;
+		const GeofencePoint &high = (a.lat < b.lat) ? b : a;
+		GeofenceEdge &edge = edges[numEdges];
+		edge.latLow = low.lat;
+		edge.latHigh = high.lat;
+		edge.lonLow = low.lon;
+		edge.lonHigh = high.lon;
+		edge.dLat = high.lat - low.lat;
+		edge.dLon = high.lon - low.lon;
+		numEdges++;
+	}
+	return numEdges;
+}
+
+/* Prints edges as a C array definition that can be pasted into a sketch to keep the fence in PROGMEM, e.g.
+ *   const GeofenceEdge name[] PROGMEM = { ... };
+ * and then passed to addPolygon(name, count, id, true).
+ */
+void Geofence::printEdgeTable(Print &out, const GeofenceEdge *edges, int numEdges, const char *name) {
+	out.print(F("const GeofenceEdge "));
+	out.print(name);
+	out.println(F("[] PROGMEM = {"));
+	for(int i = 0; i < numEdges; i++) {
+		const GeofenceEdge &edge = edges[i];
+		out.print(F("\t{"));
+		out.print(edge.latLow);
+		out.print(F(", "));
+		out.print(edge.latHigh);
+		out.print(F(", "));
+		out.print(edge.lonLow);
+		out.print(F(", "));
+		out.print(edge.lonHigh);
+		out.print(F(", "));
+		out.print(edge.dLat);
+		out.print(F(", "));
+		out.print(edge.dLon);
+		out.println((i < numEdges - 1) ? F("},") : F("}"));
+	}
+	out.println(F("};"));
+}
@@ -0,0 +1,28 @@
+/* Log Text Formats
+ * Part of the BPPCell library; include BPPCell.h rather than this file, except from host code.
+ * See GitHub.com/UMDBPP/BPPCell or the accompanying readme for further details.
+ *
+ * The layouts of the text GPSCoords::formatCoordsForText() gives, and of the CSQ the example sketch appends to it in
+ * datalog.txt. GPSCoords and CellComm take their constants from here, and host tools that read the logs (see
+ * extras/FlightLogAnalyzer) include this file alone, so that both sides change together. It needs nothing from the
+ * Arduino core.
+ */
+
+#ifndef LogFormat_h
+#define LogFormat_h
+
+struct LogFormat {
+	// Text formats of formatCoordsForText(), as GPSCoords::FORMAT_DMS and so on
+	const static int DMS = 1; // Degrees, minutes, and seconds; multiple lines
+	const static int DMS_ONELINE = 2; // Degrees, minutes, and seconds; one line
+	const static int DMS_CSV = 3; // hh:mm:ss.ss,[-]latDegs,latMins,latSecs,[-]lonDegs,lonMins,lonSecs,alt
+	const static int DEC_DEGS = 4; // Decimal degrees; multiple lines
+	const static int DEC_DEGS_CSV = 5; // hh:mm:ss.ss,latDecDegs,lonDecDegs,alt
+
+	const static int DMS_CSV_FIELDS = 8; // Comma-separated fields of a DMS_CSV line, before any CSQ
+	const static int DEC_DEGS_CSV_FIELDS = 4; // As above, for DEC_DEGS_CSV
+
+	const static int CSQ_UNKNOWN = 99; // The signal quality the modem reports when it cannot measure it; CellComm::CSQ_UNKNOWN
+};
+
+#endif
@@ -0,0 +1,66 @@
+/* Static RAM Report for Arduino
+ * Developed for the Space Systems Laboratory at the University of Maryland
+ * Part of the BPPCell library
+ * See GitHub.com/UMDBPP/BPPCell or the accompanying readme for further details.
+ *
+ * Copyright (c) 2015 Luke Renegar
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+
+#define BPPCELL_SOURCE
+#include "Arduino.h"
+#include "BPPCell.h"
+
+static void printEntry(Print &out, const __FlashStringHelper *name, unsigned int bytes) {
+	out.print(name);
+	out.print(F(": "));
+	out.print(bytes);
+	out.println(F(" bytes"));
+}
+
+/* Prints, one per line, the RAM an instance of each class takes (sizeof, for GNSSComm and CellComm as
+ * typedefed) and the library's static data. None of it is allocated until the sketch declares an instance.
+ * Buffers the caller supplies (FixHistory's entries, the text buffers of the buffer-based APIs) are not counted.
+ */
+void MemoryReport::print(Print &out) {
+	printEntry(out, F("GPSCoords"), sizeof(GPSCoords));
+	printEntry(out, F("PackedFix"), sizeof(PackedFix));
+	printEntry(out, F("FixHistory"), sizeof(FixHistory));
+	printEntry(out, F("NMEAParser"), sizeof(NMEAParser));
+	printEntry(out, F("GNSSComm"), sizeof(GNSSComm));
+	printEntry(out, F("GNSSDemux"), sizeof(GNSSDemux));
+	printEntry(out, F("CellComm"), sizeof(CellComm));
+	printEntry(out, F("Scheduler"), sizeof(Scheduler));
+	printEntry(out, F("Geofence"), sizeof(Geofence));
+	printEntry(out, F("TrackFilter"), sizeof(TrackFilter));
+	printEntry(out, F("DeadbandReporter"), sizeof(DeadbandReporter));
+	printEntry(out, F("TimeBase"), sizeof(TimeBase));
+	printEntry(out, F("TextWriter"), sizeof(TextWriter));
+#ifdef BPPCELL_STATS
+	printEntry(out, F("BPPCellStats (static)"), sizeof(BPPCellStats::ops) + 4 * sizeof(unsigned long) + 2 * sizeof(unsigned int));
+#endif
+#ifdef BPPCELL_NO_HEAP
+	out.println(F("Heap: none (BPPCELL_NO_HEAP)"));
+#else
+	out.println(F("Heap: used by the String APIs"));
+#endif
+}
@@ -24,6 +24,7 @@
  * THE SOFTWARE.
  */
 
+#define BPPCELL_SOURCE
 #include <Arduino.h>
 //#include <Wire.h>
 #include <BPPCell.h>
@@ -33,77 +34,99 @@ NMEAParser::NMEAParser()
 {
 }
 
+// Parses a null-terminated $GPGGA sentence into a GPSCoords; fields the sentence lacks are read as empty
+GPSCoords NMEAParser::parseCoords(const char *GGAString)
+{
+    BPPCELL_STAT_SCOPE(NMEA_PARSE);
+    BPPCELL_STAT_BYTES(strlen(GGAString));
+    //Each field runs from the character after the comma that precedes it to the next comma (or the end)
+    const int NUMBER_OF_FIELDS = 12; // Fields up to the geoid separation
+    const char *fields[NUMBER_OF_FIELDS];
+    fields[0] = GGAString;
+    for (int i = 1; i < NUMBER_OF_FIELDS; i++)
+    {
+        const char *comma = strchr(fields[i - 1], ',');
+        fields[i] = (comma != NULL) ? (comma + 1) : (fields[i - 1] + strlen(fields[i - 1])); // Empty once the commas run out
+    }
+
+    char time[GPSCoords::TIME_SIZE];
+    int timeLength = 0;
+    for (const char *c = fields[1]; (*c != ',') && (*c != '\0') && (timeLength < GPSCoords::TIME_SIZE - 1); c++)
+        time[timeLength++] = *c;
+    time[timeLength] = '\0';
+
+    bool isNorth = (fields[3][0] == 'N') && ((fields[3][1] == ',') || (fields[3][1] == '\0'));
+    bool isEast = (fields[5][0] == 'E') && ((fields[5][1] == ',') || (fields[5][1] == '\0'));
+
+    long lat = parseLatFromGGA(fields[2], isNorth);
+    long lon = parseLonFromGGA(fields[4], isEast);
+    float alt = atof(fields[9]) + atof(fields[11]); // Altitude above mean sea level plus geoid separation
+    GPSCoords coords(time, lat, lon, alt);
+    coords.setFixQuality((byte) atol(fields[6]));
+    coords.setNumSatellites((byte) atol(fields[7]));
+    if ((fields[8][0] != ',') && (fields[8][0] != '\0'))
+        coords.setHDOP(parseHundredths(fields[8]));
+    return coords;
+}
+
+/* Parses a $GPGGA string directly into a PackedFix.
+ * Convenient for storing fixes in a FixHistory; see parseCoords for the fields read.
+ */
+PackedFix NMEAParser::parseFix(const char *GGAString)
+{
+    return parseCoords(GGAString).toPackedFix();
+}
+
+#ifndef BPPCELL_NO_HEAP
+
 GPSCoords NMEAParser::parseCoords(String GGAString)
 {
-    //Start indices are the first characters indices of the given field
-    //End indices are the indices of the comma after the given field
-    int NUMBER_OF_COMMAS = 14; // Number of commas in a GGA string
-    int indicesOfCommas[NUMBER_OF_COMMAS];
-    int lastCommaIndex = 0;
-    for (int i = 0; i < NUMBER_OF_COMMAS; i++)
+    return parseCoords(GGAString.c_str());
+}
+
+PackedFix NMEAParser::parseFix(String GGAString)
+{
+    return parseFix(GGAString.c_str());
+}
+
+#endif
+
+/* Parses a non-negative decimal field such as the GGA HDOP ("1.27") into hundredths (127) without using floats.
+ * Digits past the hundredths place are truncated. The field ends at a comma or the end of the string.
+ */
+int NMEAParser::parseHundredths(const char *decimalString)
+{
+    int value = 0;
+    int fractionDigits = -1; // Number of digits seen after the decimal point, or -1 before it
+    for (const char *c = decimalString; (*c != ',') && (*c != '\0') && (fractionDigits < 2); c++)
     {
-        indicesOfCommas[i] = GGAString.indexOf(",", lastCommaIndex);
-        lastCommaIndex = indicesOfCommas[i] + 1;
+        if (*c == '.')
+            fractionDigits = 0;
+        else if ((*c >= '0') && (*c <= '9'))
+        {
+            value = value * 10 + (*c - '0');
+            if (fractionDigits >= 0)
+                fractionDigits++;
+        }
     }
-    //The field goes from the index immediately following the first comma to the index immediately preceding the second comma
-    String time = GGAString.substring(indicesOfCommas[0] + 1, indicesOfCommas[1]);
-    String latString = GGAString.substring(indicesOfCommas[1] + 1, indicesOfCommas[2]);
-    String NSString = GGAString.substring(indicesOfCommas[2] + 1, indicesOfCommas[3]);
-    String lonString = GGAString.substring(indicesOfCommas[3] + 1, indicesOfCommas[4]);
-    String EWString = GGAString.substring(indicesOfCommas[4] + 1, indicesOfCommas[5]);
-    String altString = GGAString.substring(indicesOfCommas[8] + 1, indicesOfCommas[9]);
-    String geoString = GGAString.substring(indicesOfCommas[10] + 1, indicesOfCommas[11]); // geoid separation
-
-    bool isNorth;
-    if (NSString.equals("N"))
-        isNorth = true;
-    else
-        isNorth = false;
-
-    bool isEast;
-    if (EWString.equals("E"))
-        isEast = true;
-    else
-        isEast = false;
-
-    float lat = parseLatFromGGA(latString, isNorth);
-    float lon = parseLonFromGGA(lonString, isEast);
-    float alt = altString.toFloat() + geoString.toFloat();
-    return GPSCoords(time, lat, lon, alt);
+    if (fractionDigits < 1)
+        value *= 100;
+    else if (fractionDigits == 1)
+        value *= 10;
+    return value;
 }
 
 /* Parses the latitude from an NMEA GGA string
- *
- *
+ * The digits are read as integers, so no precision is lost and no floating point is used.
  */
-long NMEAParser::parseLatFromGGA(String latString, bool isNorth)
+long NMEAParser::parseLatFromGGA(const char *latString, bool isNorth)
 {
-    int degrees = latString.substring(0, 2).toInt(); //Gets the degree component of the latitude
-    int minutes = latString.substring(2, 4).toInt(); //Gets the integral minutes component of the latitude
-    float decMinutes = latString.substring(4).toFloat(); //Gets the decimal minutes component of the latitude
-    int NSMultiplier; //North-south multiplier indicates if the latitude is north or south, with positive values being north
-    if (isNorth)
-        NSMultiplier = 1;
-    else
-        NSMultiplier = -1;
-    int MINUTES_PER_DEGREE = 60;
-    const long TEN_THOUSANDTHS_PER_MINUTE = 10000;
-    return NSMultiplier * (degrees * MINUTES_PER_DEGREE * TEN_THOUSANDTHS_PER_MINUTE + minutes * TEN_THOUSANDTHS_PER_MINUTE + ((long) (decMinutes * (TEN_THOUSANDTHS_PER_MINUTE))));
+    return TenThousandthMinuteScale::parseNMEA(latString, 2, isNorth);
 }
 
-long NMEAParser::parseLonFromGGA(String lonString, bool isEast)
+long NMEAParser::parseLonFromGGA(const char *lonString, bool isEast)
 {
-    int degrees = lonString.substring(0, 3).toInt(); //Gets the degree component of the longitude
-    int minutes = lonString.substring(3, 5).toInt(); //Gets the integral minutes component of the longitude
-    float decMinutes = lonString.substring(5).toFloat(); //Gets the decimal minutes component of the longitude
-    int EWMultiplier; //East-west multiplier indicates if the longitude is east or west, with positive values being east
-    if (isEast)
-        EWMultiplier = 1;
-    else
-        EWMultiplier = -1;
-    int MINUTES_PER_DEGREE = 60;
-    const long TEN_THOUSANDTHS_PER_MINUTE = 10000;
-    return EWMultiplier * (degrees * MINUTES_PER_DEGREE * TEN_THOUSANDTHS_PER_MINUTE + minutes * TEN_THOUSANDTHS_PER_MINUTE + ((long) (decMinutes * (TEN_THOUSANDTHS_PER_MINUTE))));
+    return TenThousandthMinuteScale::parseNMEA(lonString, 3, isEast);
 }
 
 
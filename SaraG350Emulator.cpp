@@ -0,0 +1,485 @@
+/* SARA-G350 Modem Emulator for Arduino
+ * Developed for the Space Systems Laboratory at the University of Maryland
+ * Part of the BPPCell library
+ * See GitHub.com/UMDBPP/BPPCell or the accompanying readme for further details.
+ *
+ * Copyright (c) 2015 Luke Renegar
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+
+#define BPPCELL_SOURCE
+#include "Arduino.h"
+#include "BPPCell.h"
+#include "SaraG350Emulator.h"
+
+// Names of the kinds of command, in COMMAND constant order, for printStats()
+const char *const COMMAND_NAMES[SaraG350Emulator::NUM_COMMANDS] = { "AT", "CMGF", "CMGS", "CMGL", "CMGR", "CMGD", "CSQ" };
+
+SaraG350Emulator::SaraG350Emulator() {
+	_outputLength = 0;
+	_numSegments = 0;
+	_droppedBytes = 0;
+	_lineLength = 0;
+	_enteringText = false;
+	_textStartedAt = 0;
+	_responseLatency = 20;
+	_sendLatency = 2000;
+	_rssi = 20;
+	_ber = 0;
+	_echo = true;
+	_textMode = false;
+	_errorPercent = 0;
+	_random = 1;
+	for(int i = 0; i < NUM_COMMANDS; i++)
+		_failCounts[i] = 0;
+	for(int i = 0; i < INBOX_SIZE; i++)
+		_inbox[i].used = false;
+	_numSent = 0;
+	_messageReference = 0;
+	_lastNumber[0] = '\0';
+	_lastText[0] = '\0';
+	_lastTextLength = 0;
+	resetStats();
+}
+
+void SaraG350Emulator::begin(long) {} // There is no line rate; latency is set with setLatency()
+
+int SaraG350Emulator::available() {
+	int length = releasedLength();
+	if(length > RX_BUFFER_SIZE)
+		length = RX_BUFFER_SIZE;
+	return length;
+}
+
+/* Takes one byte of the released responses. When the last byte of a final result code is taken, the command it
+ * answers is complete and its time to completion is recorded.
+ */
+int SaraG350Emulator::read() {
+	if(releasedLength() == 0)
+		return -1;
+	int c = (byte) _output[0];
+	_outputLength--;
+	memmove(_output, _output + 1, _outputLength);
+	for(int i = 0; i < _numSegments; i++)
+		_segments[i].end--;
+	if(_segments[0].end == 0) {
+		Segment &done = _segments[0];
+		if(done.final) {
+			unsigned long elapsed = millis() - done.startedAt;
+			CommandStats &stats = _stats[done.command];
+			stats.completed++;
+			stats.totalMillis += elapsed;
+			if(elapsed > stats.maxMillis)
+				stats.maxMillis = elapsed;
+			if(done.command == COMMAND_CMGS)
+				_lastSendMillis = millis();
+		}
+		_numSegments--;
+		memmove(_segments, _segments + 1, _numSegments * sizeof(Segment));
+	}
+	return c;
+}
+
+int SaraG350Emulator::peek() {
+	if(releasedLength() == 0)
+		return -1;
+	return (byte) _output[0];
+}
+
+// Takes one byte from CellComm: a command line character, or message text after the > prompt
+size_t SaraG350Emulator::write(uint8_t c) {
+	unsigned long now = millis();
+	if(_enteringText) {
+		handleText(c, now);
+		return 1;
+	}
+	if((c == '\r') || (c == '\n')) {
+		if(_lineLength > 0) {
+			_line[_lineLength] = '\0';
+			if(_echo) {
+				respond(_line, COMMAND_AT, false, now, 0);
+				respond("\r", COMMAND_AT, false, now, 0);
+			}
+			handleLine(now);
+			_lineLength = 0;
+		}
+	}
+	else if(_lineLength < (LINE_SIZE - 1)) {
+		_line[_lineLength++] = toupper(c);
+	}
+	return 1;
+}
+
+void SaraG350Emulator::flush() {}
+
+/* Sets how long the modem takes to answer a command, and how long sending an SMS takes after Ctrl-Z,
+ * both in milliseconds.
+ */
+void SaraG350Emulator::setLatency(unsigned long responseLatency, unsigned long sendLatency) {
+	_responseLatency = responseLatency;
+	_sendLatency = sendLatency;
+}
+
+// Sets the signal quality reported by +CSQ; see CellComm::getCSQ() for the values
+void SaraG350Emulator::setCSQ(int rssi, int ber) {
+	_rssi = rssi;
+	_ber = ber;
+}
+
+void SaraG350Emulator::setEcho(bool echo) {
+	_echo = echo;
+}
+
+/* Makes the next count commands of the given kind fail. +CMGS fails after the text is sent, as a network
+ * failure would; the others fail at once.
+ */
+void SaraG350Emulator::failNext(byte command, int count) {
+	if(command < NUM_COMMANDS)
+		_failCounts[command] += count;
+}
+
+// Makes each command fail with the given probability, drawn from a generator started from seed
+void SaraG350Emulator::setErrorRate(byte percent, unsigned long seed) {
+	_errorPercent = percent;
+	_random = seed;
+}
+
+/* Puts a message in the inbox, and if notify is true announces it with +CMTI as the modem does.
+ * Returns the message's index (from 1, as used by +CMGR), or -1 if the inbox is full.
+ */
+int SaraG350Emulator::addInboxMessage(const char *sender, const char *text, bool notify) {
+	for(int i = 0; i < INBOX_SIZE; i++) {
+		if(!_inbox[i].used) {
+			_inbox[i].used = true;
+			_inbox[i].read = false;
+			copyString(_inbox[i].sender, sender, NUMBER_SIZE);
+			copyString(_inbox[i].text, text, TEXT_SIZE);
+			if(notify) {
+				char urc[24];
+				snprintf(urc, sizeof(urc), "\r\n+CMTI: \"SM\",%d\r\n", i + 1);
+				respond(urc, COMMAND_AT, false, millis(), 0);
+			}
+			return i + 1;
+		}
+	}
+	return -1;
+}
+
+int SaraG350Emulator::getNumInboxMessages() {
+	int count = 0;
+	for(int i = 0; i < INBOX_SIZE; i++) {
+		if(_inbox[i].used)
+			count++;
+	}
+	return count;
+}
+
+// Sends an unsolicited result code, such as "+CREG: 1", immediately
+void SaraG350Emulator::sendUnsolicited(const char *line) {
+	unsigned long now = millis();
+	respond("\r\n", COMMAND_AT, false, now, 0);
+	respond(line, COMMAND_AT, false, now, 0);
+	respond("\r\n", COMMAND_AT, false, now, 0);
+}
+
+// The number of SMS messages sent successfully
+int SaraG350Emulator::getNumSent() {
+	return _numSent;
+}
+
+const char *SaraG350Emulator::getLastSentNumber() {
+	return _lastNumber;
+}
+
+const char *SaraG350Emulator::getLastSentText() {
+	return _lastText;
+}
+
+/* Prints one line per kind of command that has been used, e.g.
+ * CSQ n=10 err=0 mean=21ms max=24ms
+ * then the number of messages sent and the throughput from the first +CMGS to the last completed one.
+ */
+void SaraG350Emulator::printStats(Print &out) {
+	for(int i = 0; i < NUM_COMMANDS; i++) {
+		CommandStats &stats = _stats[i];
+		if(stats.count == 0)
+			continue;
+		out.print(COMMAND_NAMES[i]);
+		out.print(F(" n="));
+		out.print(stats.count);
+		out.print(F(" err="));
+		out.print(stats.errors);
+		if(stats.completed > 0) {
+			out.print(F(" mean="));
+			out.print(stats.totalMillis / stats.completed);
+			out.print(F("ms max="));
+			out.print(stats.maxMillis);
+			out.print(F("ms"));
+		}
+		out.println();
+	}
+	out.print(F("sent="));
+	out.print(_numSent);
+	if(_numSent > 0) {
+		unsigned long span = _lastSendMillis - _firstSendMillis;
+		out.print(F(" in "));
+		out.print(span);
+		out.print(F("ms"));
+		if(span > 0) {
+			out.print(F(" ("));
+			out.print((_numSent * 60000.0) / span);
+			out.print(F(" msg/min)"));
+		}
+	}
+	if(_droppedBytes > 0) {
+		out.print(F(" dropped="));
+		out.print(_droppedBytes);
+	}
+	out.println();
+}
+
+void SaraG350Emulator::resetStats() {
+	memset(_stats, 0, sizeof(_stats));
+	_numSent = 0;
+	_firstSendMillis = 0;
+	_lastSendMillis = 0;
+	_droppedBytes = 0;
+}
+
+// Bytes of _output whose latency has passed; segments are released in order
+int SaraG350Emulator::releasedLength() {
+	unsigned long now = millis();
+	int length = 0;
+	for(int i = 0; i < _numSegments; i++) {
+		if((long) (now - _segments[i].releaseAt) < 0)
+			break;
+		length = _segments[i].end;
+	}
+	return length;
+}
+
+/* Queues text to be readable latency milliseconds from now, but never before the responses already queued.
+ * If the segment table is full the text joins the last segment; if _output is full the excess is dropped.
+ */
+void SaraG350Emulator::respond(const char *text, byte command, bool final, unsigned long startedAt, unsigned long latency) {
+	int length = strlen(text);
+	if(length > (OUTPUT_SIZE - _outputLength)) {
+		_droppedBytes += length - (OUTPUT_SIZE - _outputLength);
+		length = OUTPUT_SIZE - _outputLength;
+	}
+	memcpy(_output + _outputLength, text, length);
+	_outputLength += length;
+
+	unsigned long releaseAt = millis() + latency;
+	if(_numSegments > 0) {
+		Segment &last = _segments[_numSegments - 1];
+		if((long) (releaseAt - last.releaseAt) < 0)
+			releaseAt = last.releaseAt;
+		if(_numSegments == MAX_SEGMENTS) {
+			last.end = _outputLength;
+			last.final = last.final || final;
+			return;
+		}
+	}
+	Segment &segment = _segments[_numSegments++];
+	segment.end = _outputLength;
+	segment.releaseAt = releaseAt;
+	segment.startedAt = startedAt;
+	segment.command = command;
+	segment.final = final;
+}
+
+// Carries out the command line in _line
+void SaraG350Emulator::handleLine(unsigned long now) {
+	if(strncmp(_line, "AT", 2) != 0)
+		return; // The modem ignores anything that is not a command
+	const char *argument = strchr(_line, '=');
+	int value = (argument != NULL) ? atoi(argument + 1) : 0;
+
+	byte command = COMMAND_AT;
+	if(strncmp(_line, "AT+CMGF", 7) == 0)
+		command = COMMAND_CMGF;
+	else if(strncmp(_line, "AT+CMGS", 7) == 0)
+		command = COMMAND_CMGS;
+	else if(strncmp(_line, "AT+CMGL", 7) == 0)
+		command = COMMAND_CMGL;
+	else if(strncmp(_line, "AT+CMGR", 7) == 0)
+		command = COMMAND_CMGR;
+	else if(strncmp(_line, "AT+CMGD", 7) == 0)
+		command = COMMAND_CMGD;
+	else if(strncmp(_line, "AT+CSQ", 6) == 0)
+		command = COMMAND_CSQ;
+	_stats[command].count++;
+
+	bool sms = (command != COMMAND_AT) && (command != COMMAND_CSQ);
+	if((command != COMMAND_CMGS) && shouldFail(command)) {
+		respondError(command, sms, "unknown error", now);
+		return;
+	}
+
+	switch(command) {
+		case COMMAND_CMGF:
+			_textMode = (value == 1);
+			break;
+		case COMMAND_CMGS: {
+			if(!_textMode) {
+				respondError(command, true, "operation not allowed", now);
+				return;
+			}
+			const char *quote = strchr(_line, '"');
+			copyString(_lastNumber, (quote != NULL) ? (quote + 1) : "", NUMBER_SIZE);
+			char *endQuote = strchr(_lastNumber, '"');
+			if(endQuote != NULL)
+				*endQuote = '\0';
+			_enteringText = true;
+			_textStartedAt = now;
+			_lastTextLength = 0;
+			if(_stats[COMMAND_CMGS].count == 1)
+				_firstSendMillis = now;
+			respond("\r\n> ", command, false, now, _responseLatency);
+			return;
+		}
+		case COMMAND_CMGL:
+			for(int i = 0; i < INBOX_SIZE; i++) {
+				if(_inbox[i].used)
+					listMessage(i, command, now);
+			}
+			break;
+		case COMMAND_CMGR:
+			if((value < 1) || (value > INBOX_SIZE) || !_inbox[value - 1].used) {
+				respondError(command, true, "invalid memory index", now);
+				return;
+			}
+			listMessage(value - 1, command, now);
+			break;
+		case COMMAND_CMGD: {
+			const char *comma = strchr(_line, ',');
+			int flag = (comma != NULL) ? atoi(comma + 1) : 0;
+			if(flag == 0) {
+				if((value < 1) || (value > INBOX_SIZE)) {
+					respondError(command, true, "invalid memory index", now);
+					return;
+				}
+				_inbox[value - 1].used = false;
+			}
+			else {
+				for(int i = 0; i < INBOX_SIZE; i++) {
+					if((flag >= 4) || _inbox[i].read) // 1 to 3 delete read messages (this inbox holds nothing else); 4 deletes all
+						_inbox[i].used = false;
+				}
+			}
+			break;
+		}
+		case COMMAND_CSQ: {
+			char response[24];
+			snprintf(response, sizeof(response), "\r\n+CSQ: %d,%d\r\n", _rssi, _ber);
+			respond(response, command, false, now, _responseLatency);
+			break;
+		}
+		default:
+			if(strncmp(_line, "ATE", 3) == 0) {
+				_echo = (value == 1) || (_line[3] == '1');
+			}
+			else if(strcmp(_line, "AT") != 0) {
+				respondError(command, false, NULL, now);
+				return;
+			}
+			break;
+	}
+	respond("\r\nOK\r\n", command, true, now, _responseLatency);
+}
+
+// Collects message text until Ctrl-Z sends it or Esc abandons it
+void SaraG350Emulator::handleText(char c, unsigned long) {
+	if(c == 0x1B) { // Esc
+		_enteringText = false;
+		respond("\r\nOK\r\n", COMMAND_CMGS, true, _textStartedAt, _responseLatency);
+		return;
+	}
+	if(c != 0x1A) {
+		if((c == '\n') && (_lastTextLength == 0))
+			return; // The rest of the CR LF that ended the AT+CMGS line, which println() sends
+		if(_lastTextLength < (TEXT_SIZE - 1))
+			_lastText[_lastTextLength++] = c;
+		_lastText[_lastTextLength] = '\0';
+		return;
+	}
+	_enteringText = false;
+	if(shouldFail(COMMAND_CMGS)) {
+		_stats[COMMAND_CMGS].errors++;
+		respond("\r\n+CMS ERROR: unknown error\r\n", COMMAND_CMGS, true, _textStartedAt, _sendLatency);
+		return;
+	}
+	_numSent++;
+	_messageReference++;
+	char response[32];
+	snprintf(response, sizeof(response), "\r\n+CMGS: %d\r\n\r\nOK\r\n", _messageReference);
+	respond(response, COMMAND_CMGS, true, _textStartedAt, _sendLatency);
+}
+
+// Uses up one failNext() for the command, or draws against the random error rate
+bool SaraG350Emulator::shouldFail(byte command) {
+	if(_failCounts[command] > 0) {
+		_failCounts[command]--;
+		return true;
+	}
+	if(_errorPercent == 0)
+		return false;
+	_random = _random * 1103515245UL + 12345; // The C standard's example generator, which is repeatable everywhere
+	return ((_random >> 16) % 100) < _errorPercent;
+}
+
+// Sends ERROR, or +CMS ERROR with reason for SMS commands, as the final result
+void SaraG350Emulator::respondError(byte command, bool sms, const char *reason, unsigned long startedAt) {
+	_stats[command].errors++;
+	if(sms && (reason != NULL)) {
+		respond("\r\n+CMS ERROR: ", command, false, startedAt, _responseLatency);
+		respond(reason, command, false, startedAt, _responseLatency);
+		respond("\r\n", command, true, startedAt, _responseLatency);
+	}
+	else {
+		respond("\r\nERROR\r\n", command, true, startedAt, _responseLatency);
+	}
+}
+
+// Sends one message as +CMGL or +CMGR lists it, and marks it read
+void SaraG350Emulator::listMessage(int index, byte command, unsigned long startedAt) {
+	InboxMessage &message = _inbox[index];
+	char header[48];
+	const char *status = message.read ? "REC READ" : "REC UNREAD";
+	if(command == COMMAND_CMGL)
+		snprintf(header, sizeof(header), "\r\n+CMGL: %d,\"%s\",\"", index + 1, status);
+	else
+		snprintf(header, sizeof(header), "\r\n+CMGR: \"%s\",\"", status);
+	respond(header, command, false, startedAt, _responseLatency);
+	respond(message.sender, command, false, startedAt, _responseLatency);
+	respond("\",,\"15/05/22,12:00:00+00\"\r\n", command, false, startedAt, _responseLatency);
+	respond(message.text, command, false, startedAt, _responseLatency);
+	respond("\r\n", command, false, startedAt, _responseLatency);
+	message.read = true;
+}
+
+// Copies at most size - 1 characters and always terminates
+void SaraG350Emulator::copyString(char *destination, const char *source, int size) {
+	strncpy(destination, source, size - 1);
+	destination[size - 1] = '\0';
+}
@@ -0,0 +1,136 @@
+/* SARA-G350 Modem Emulator for Arduino
+ * Part of the BPPCell library. Include this after BPPCell.h to run CellComm against an emulated modem, e.g.
+ *   SaraG350Emulator modem;
+ *   BasicCellComm<SaraG350Emulator> cellComm(modem);
+ * See GitHub.com/UMDBPP/BPPCell or the accompanying readme for further details.
+ *
+ * The emulator is an in-process stand-in for the modem's serial port, so CellComm can be exercised and timed
+ * without the shield or a network, on the Arduino itself or on a host with an Arduino compatibility layer.
+ */
+
+#ifndef SaraG350Emulator_h
+#define SaraG350Emulator_h
+
+#include "Arduino.h"
+#include "BPPCell.h"
+
+/* Emulates the AT command subset the library uses: AT, ATE, +CMGF, +CMGS (with the > prompt), +CMGL, +CMGR,
+ * +CMGD and +CSQ, plus +CMTI and other unsolicited result codes. Errors are reported in verbose form, as with
+ * AT+CMEE=2. Responses become readable only after a configurable latency, measured with millis(), and at most 63
+ * bytes are ever available at once, as with HardwareSerial. Errors can be injected for the next few commands of
+ * a kind or at random from a fixed seed, so runs are repeatable.
+ *
+ * For each kind of command the emulator records the time to completion: from the end of the command line (for
+ * +CMGS, the line with the number) until the last byte of its final result code has been read back.
+ */
+class SaraG350Emulator : public Stream {
+	public:
+		SaraG350Emulator();
+		void begin(long baud);
+		int available();
+		int read();
+		int peek();
+		size_t write(uint8_t c);
+		using Print::write;
+		void flush();
+
+		void setLatency(unsigned long responseLatency, unsigned long sendLatency);
+		void setCSQ(int rssi, int ber = 0);
+		void setEcho(bool echo);
+		void failNext(byte command, int count = 1);
+		void setErrorRate(byte percent, unsigned long seed = 1);
+		int addInboxMessage(const char *sender, const char *text, bool notify = true);
+		int getNumInboxMessages();
+		void sendUnsolicited(const char *line);
+		int getNumSent();
+		const char *getLastSentNumber();
+		const char *getLastSentText();
+		void printStats(Print &out);
+		void resetStats();
+
+		// Kinds of command, for failNext() and the statistics
+		const static byte COMMAND_AT = 0; // AT, ATE and anything else without a more specific kind
+		const static byte COMMAND_CMGF = 1;
+		const static byte COMMAND_CMGS = 2;
+		const static byte COMMAND_CMGL = 3;
+		const static byte COMMAND_CMGR = 4;
+		const static byte COMMAND_CMGD = 5;
+		const static byte COMMAND_CSQ = 6;
+		const static byte NUM_COMMANDS = 7;
+
+		const static int OUTPUT_SIZE = 384; // Bytes of responses that can be waiting to be read; more are dropped
+		const static byte INBOX_SIZE = 4; // Received messages held
+		const static byte NUMBER_SIZE = 20; // Longest phone number kept, plus the null
+		const static byte TEXT_SIZE = 64; // Longest message text kept, plus the null; longer texts are truncated
+		const static byte LINE_SIZE = 64; // Longest command line, plus the null
+		const static int RX_BUFFER_SIZE = 63; // Most bytes available() reports at once, as with HardwareSerial
+
+	private:
+		// A response waiting in _output, readable from releaseAt
+		struct Segment {
+			int end; // Offset in _output just past the segment's last byte
+			unsigned long releaseAt;
+			unsigned long startedAt; // When the command it answers was received
+			byte command;
+			bool final; // Ends with the command's final result code
+		};
+		const static byte MAX_SEGMENTS = 12;
+
+		struct InboxMessage {
+			bool used;
+			bool read;
+			char sender[NUMBER_SIZE];
+			char text[TEXT_SIZE];
+		};
+
+		struct CommandStats {
+			unsigned long count;
+			unsigned long errors;
+			unsigned long completed;
+			unsigned long totalMillis;
+			unsigned long maxMillis;
+		};
+
+		char _output[OUTPUT_SIZE];
+		int _outputLength;
+		Segment _segments[MAX_SEGMENTS];
+		byte _numSegments;
+		unsigned long _droppedBytes;
+
+		char _line[LINE_SIZE];
+		byte _lineLength;
+		bool _enteringText; // Between the > prompt and Ctrl-Z
+		unsigned long _textStartedAt;
+
+		unsigned long _responseLatency; // Milliseconds
+		unsigned long _sendLatency; // Milliseconds from Ctrl-Z to the +CMGS result
+		int _rssi;
+		int _ber;
+		bool _echo;
+		bool _textMode;
+		int _failCounts[NUM_COMMANDS];
+		byte _errorPercent;
+		unsigned long _random;
+
+		InboxMessage _inbox[INBOX_SIZE];
+		int _numSent;
+		byte _messageReference;
+		char _lastNumber[NUMBER_SIZE];
+		char _lastText[TEXT_SIZE];
+		byte _lastTextLength;
+
+		CommandStats _stats[NUM_COMMANDS];
+		unsigned long _firstSendMillis;
+		unsigned long _lastSendMillis;
+
+		int releasedLength();
+		void respond(const char *text, byte command, bool final, unsigned long startedAt, unsigned long latency);
+		void handleLine(unsigned long now);
+		void handleText(char c, unsigned long now);
+		bool shouldFail(byte command);
+		void respondError(byte command, bool sms, const char *reason, unsigned long startedAt);
+		void listMessage(int index, byte command, unsigned long startedAt);
+		static void copyString(char *destination, const char *source, int size);
+};
+
+#endif
@@ -0,0 +1,135 @@
+/* Cooperative Scheduler for Arduino
+ * Developed for the Space Systems Laboratory at the University of Maryland
+ * Part of the BPPCell library
+ * See GitHub.com/UMDBPP/BPPCell or the accompanying readme for further details.
+ *
+ * Copyright (c) 2015 Luke Renegar
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+
+#define BPPCELL_SOURCE
+#include "Arduino.h"
+#include "BPPCell.h"
+
+Scheduler::Scheduler() {
+	for(int i = 0; i < SCHEDULER_MAX_TASKS; i++) {
+		_tasks[i] = NULL;
+		_contexts[i] = NULL;
+		_deadlines[i] = 0;
+		_maxLateness[i] = 0;
+	}
+	_numTasks = 0;
+}
+
+/* Adds a task that first runs delay milliseconds after now; context is passed to it on every call.
+ * Returns the task's id, or NO_TASK if all SCHEDULER_MAX_TASKS slots are taken.
+ */
+int Scheduler::addTask(SchedulerTask task, void *context, unsigned long now, unsigned long delay) {
+	if(task == NULL)
+		return NO_TASK;
+	for(int i = 0; i < SCHEDULER_MAX_TASKS; i++) {
+		if(_tasks[i] == NULL) {
+			_tasks[i] = task;
+			_contexts[i] = context;
+			_deadlines[i] = now + delay;
+			_maxLateness[i] = 0;
+			_numTasks++;
+			return i;
+		}
+	}
+	return NO_TASK;
+}
+
+void Scheduler::removeTask(int id) {
+	if((id < 0) || (id >= SCHEDULER_MAX_TASKS) || (_tasks[id] == NULL))
+		return;
+	_tasks[id] = NULL;
+	_contexts[id] = NULL;
+	_numTasks--;
+}
+
+// Makes a task due immediately, e.g. when the event it was waiting for has happened
+void Scheduler::wake(int id, unsigned long now) {
+	if((id < 0) || (id >= SCHEDULER_MAX_TASKS) || (_tasks[id] == NULL))
+		return;
+	_deadlines[id] = now;
+}
+
+/* Calls the most overdue task once and reschedules it from now by the delay it returns.
+ * Returns false if no task was due, in which case getTimeUntilNext() says how long the caller may sleep.
+ * Call from loop() as often as possible, with millis() as now.
+ */
+bool Scheduler::run(unsigned long now) {
+	int next = NO_TASK;
+	unsigned long nextLateness = 0;
+	for(int i = 0; i < SCHEDULER_MAX_TASKS; i++) {
+		if(_tasks[i] == NULL)
+			continue;
+		unsigned long lateness = now - _deadlines[i];
+		if((long) lateness < 0) // Not yet due
+			continue;
+		if((next == NO_TASK) || (lateness > nextLateness)) {
+			next = i;
+			nextLateness = lateness;
+		}
+	}
+	if(next == NO_TASK)
+		return false;
+	
+	if(nextLateness > _maxLateness[next])
+		_maxLateness[next] = nextLateness;
+	SchedulerTask task = _tasks[next];
+	long delay = task(_contexts[next], now);
+	if(_tasks[next] != task) // The task removed itself
+		return true;
+	if(delay < 0)
+		removeTask(next);
+	else
+		_deadlines[next] = now + delay;
+	return true;
+}
+
+// Milliseconds until the next task is due: 0 if one is due now, 0xFFFFFFFF if there are no tasks
+unsigned long Scheduler::getTimeUntilNext(unsigned long now) {
+	unsigned long soonest = 0xFFFFFFFF;
+	for(int i = 0; i < SCHEDULER_MAX_TASKS; i++) {
+		if(_tasks[i] == NULL)
+			continue;
+		long remaining = _deadlines[i] - now;
+		if(remaining <= 0)
+			return 0;
+		if((unsigned long) remaining < soonest)
+			soonest = remaining;
+	}
+	return soonest;
+}
+
+// The furthest past its deadline the task has been called, in milliseconds
+unsigned long Scheduler::getMaxLateness(int id) {
+	if((id < 0) || (id >= SCHEDULER_MAX_TASKS))
+		return 0;
+	return _maxLateness[id];
+}
+
+int Scheduler::getNumTasks() {
+	return _numTasks;
+}
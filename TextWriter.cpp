@@ -0,0 +1,67 @@
+/* Bounded Text Output for Arduino
+ * Developed for the Space Systems Laboratory at the University of Maryland
+ * Part of the BPPCell library
+ * See GitHub.com/UMDBPP/BPPCell or the accompanying readme for further details.
+ *
+ * Copyright (c) 2015 Luke Renegar
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#define BPPCELL_SOURCE
+#include "Arduino.h"
+#include "BPPCell.h"
+
+TextWriter::TextWriter(char *buffer, int size) {
+	_buffer = buffer;
+	_size = size;
+	_length = 0;
+	_truncated = false;
+	if(_size > 0)
+		_buffer[0] = '\0';
+}
+
+// Appends one character, if there is room for it and the null
+size_t TextWriter::write(uint8_t c) {
+	if(_length >= _size - 1) {
+		_truncated = true;
+		return 0;
+	}
+	_buffer[_length++] = (char) c;
+	_buffer[_length] = '\0';
+	return 1;
+}
+
+// Prints value with the given number of decimal places, formatted as String(value, decimals) formats it
+void TextWriter::printFixed(float value, byte decimals) {
+	char digits[33];
+	dtostrf(value, decimals + 2, decimals, digits);
+	print(digits);
+}
+
+// Gets the number of characters written, not counting the null
+int TextWriter::length() {
+	return _length;
+}
+
+// True if any text has been dropped for want of room
+bool TextWriter::isTruncated() {
+	return _truncated;
+}
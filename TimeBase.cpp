@@ -0,0 +1,160 @@
+/* GPS Time Base for Arduino
+ * Developed for the Space Systems Laboratory at the University of Maryland
+ * Part of the BPPCell library
+ * See GitHub.com/UMDBPP/BPPCell or the accompanying readme for further details.
+ *
+ * Copyright (c) 2015 Luke Renegar
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#define BPPCELL_SOURCE
+#include "Arduino.h"
+#include "BPPCell.h"
+
+// Creates a time base with no fixes; toMillisOfDay() returns TIME_UNKNOWN until the first
+TimeBase::TimeBase() {
+	reset();
+}
+
+// Forgets all fixes and the measured drift
+void TimeBase::reset() {
+	_skew = 0;
+	_numResets = 0;
+	_synchronized = false;
+}
+
+/* Adds a fix's UTC time, in milliseconds of day, and the millis() at which it was read. Call it as soon after
+ * reading the fix as possible; any delay before the call is indistinguishable from the receiver's own latency.
+ * Fixes with no time (TIME_UNKNOWN) are ignored.
+ */
+void TimeBase::addFix(unsigned long millisOfDay, unsigned long now) {
+	if(millisOfDay >= GPSCoords::MILLIS_PER_DAY)
+		return;
+	if(!_synchronized) {
+		start(millisOfDay, now);
+		return;
+	}
+	if(now - _windowStart >= WINDOW_MILLIS)
+		closeWindow(now);
+	long error = dayDifference(millisOfDay, toMillisOfDay(now));
+	if((error > MAX_STEP) || (error < -MAX_STEP)) { // The receiver's time jumped, or millis() stalled
+		_numResets++;
+		start(millisOfDay, now);
+		return;
+	}
+	if(error > 0) { // Read sooner after its epoch than the anchor was; the mapping moves up to it at once
+		_anchor.utc = millisOfDay;
+		_anchor.local = now;
+		error = 0;
+	}
+	if(error >= _bestError) { // Ties go to the later fix, which gives the rate fit a longer baseline
+		_best.utc = millisOfDay;
+		_best.local = now;
+		_bestError = error;
+	}
+}
+
+void TimeBase::addFix(GPSCoords &coords, unsigned long now) {
+	if(coords.hasTime())
+		addFix(coords.getMillisOfDay(), now);
+}
+
+// Returns true once a fix has been added
+bool TimeBase::isSynchronized() {
+	return _synchronized;
+}
+
+/* Returns the UTC time, in milliseconds of day, at which millis() read now, or TIME_UNKNOWN before the first fix.
+ * now may be earlier than the last fix added, and may be long after it; the drift correction is applied throughout.
+ */
+unsigned long TimeBase::toMillisOfDay(unsigned long now) {
+	if(!_synchronized)
+		return GPSCoords::TIME_UNKNOWN;
+	long delta = (long) (now - _anchor.local);
+	long correction = (long) (((long long) delta * _skew) >> SKEW_SHIFT);
+	long millisOfDay = (long) _anchor.utc + correction;
+	// delta may span days (or be negative); reducing it by whole days keeps the sum within a long
+	while(delta >= (long) GPSCoords::MILLIS_PER_DAY)
+		delta -= GPSCoords::MILLIS_PER_DAY;
+	while(delta < 0)
+		delta += GPSCoords::MILLIS_PER_DAY;
+	millisOfDay += delta;
+	while(millisOfDay >= (long) GPSCoords::MILLIS_PER_DAY)
+		millisOfDay -= GPSCoords::MILLIS_PER_DAY;
+	while(millisOfDay < 0)
+		millisOfDay += GPSCoords::MILLIS_PER_DAY;
+	return (unsigned long) millisOfDay;
+}
+
+// Returns the measured drift of millis() in parts per million, positive if it runs fast; 0 until it is measured
+long TimeBase::getDriftPpm() {
+	return -(long) (((long long) _skew * 1000000 + (1L << (SKEW_SHIFT - 1))) >> SKEW_SHIFT);
+}
+
+// Returns the number of times a fix disagreed with the mapping by more than MAX_STEP and restarted it
+unsigned long TimeBase::getNumResets() {
+	return _numResets;
+}
+
+// Anchors the mapping at a fix, keeping the measured drift, and starts the first window
+void TimeBase::start(unsigned long millisOfDay, unsigned long now) {
+	_anchor.utc = millisOfDay;
+	_anchor.local = now;
+	_best = _anchor;
+	_bestError = 0;
+	_windowStart = now;
+	_numWindows = 0;
+	_nextWindow = 0;
+	_synchronized = true;
+}
+
+/* Ends the current window: its earliest-read fix becomes the anchor and joins the ring, and the rate is refitted
+ * from the oldest fix in the ring to it. The next window starts now, so a gap in the fixes leaves no empty windows.
+ */
+void TimeBase::closeWindow(unsigned long now) {
+	_windowStart = now;
+	_anchor = _best;
+	_windows[_nextWindow] = _best;
+	_nextWindow = (_nextWindow + 1 < NUM_WINDOWS) ? _nextWindow + 1 : 0;
+	if(_numWindows < NUM_WINDOWS)
+		_numWindows++;
+	_bestError = -MAX_STEP - 1;
+	if(_numWindows < 2)
+		return;
+	const Sample &oldest = _windows[(_numWindows < NUM_WINDOWS) ? 0 : _nextWindow];
+	long localSpan = (long) (_best.local - oldest.local);
+	if(localSpan <= 0)
+		return;
+	long utcSpan = dayDifference(_best.utc, oldest.utc);
+	long skew = (long) (((long long) (utcSpan - localSpan) << SKEW_SHIFT) / localSpan);
+	if((skew <= MAX_SKEW) && (skew >= -MAX_SKEW))
+		_skew = skew;
+}
+
+// Returns a - b, both in milliseconds of day, as the nearest difference across midnight
+long TimeBase::dayDifference(unsigned long a, unsigned long b) {
+	long difference = (long) (a - b);
+	if(difference > (long) (GPSCoords::MILLIS_PER_DAY / 2))
+		difference -= GPSCoords::MILLIS_PER_DAY;
+	else if(difference < -(long) (GPSCoords::MILLIS_PER_DAY / 2))
+		difference += GPSCoords::MILLIS_PER_DAY;
+	return difference;
+}
@@ -0,0 +1,503 @@
+/* Time-Indexed SD Log for Arduino
+ * Part of the BPPCell library. Include this after BPPCell.h to keep a sparse index beside an SD log, e.g.
+ *   File dataFile, indexFile;
+ *   TimeIndexedLog fixLog(dataFile, indexFile);
+ * See GitHub.com/UMDBPP/BPPCell or the accompanying readme for further details.
+ *
+ * The data file stays a plain text log, one record (fix) per line. The index file holds one LogIndexEntry for
+ * every RECORDS_PER_ENTRY records: the offset of the first record of the block and its time. Entry k is at
+ * k * sizeof(LogIndexEntry), so a record found by number costs one index sector and the one or two data sectors
+ * of its block; a record found by time costs an interpolation search of the index (usually one or two sectors,
+ * as fixes come at a steady rate) and the same data sectors. Nothing is scanned from the start of either file.
+ */
+
+#ifndef TimeIndexedLog_h
+#define TimeIndexedLog_h
+
+#include "Arduino.h"
+#include <SD.h>
+#include "BPPCell.h"
+
+// An entry of the index file. 16 bytes, so that entries never straddle a 512-byte sector
+struct LogIndexEntry {
+	uint32_t record; // Number of the block's first record (the entry's own number times RECORDS_PER_ENTRY)
+	uint32_t offset; // Of the block's first record in the data file
+	uint32_t millisOfDay; // Time of the block's first record; TIME_UNKNOWN records take the time before them
+	uint16_t day; // Times the log's time has gone backwards before this record: at midnight, or on a new session
+	uint16_t check; // Tells a whole entry from one torn by a power loss
+};
+
+static_assert(sizeof(LogIndexEntry) == 16, "LogIndexEntry must stay 16 bytes");
+
+/* Text log with a sparse time index
+ * A record is begun with beginRecord(), giving its time, and then printed to the log (a Print) as one line.
+ * Records are read back by number (getRecordCount() - 1 is the latest) or found by time.
+ *
+ * Index entries are kept in RAM until flush() and written after the data, so the index never points past data
+ * that has reached the card, and the SD library's single block cache is not passed back and forth between the
+ * files on every record. begin() catches up the index with any records written after its last entry (after a
+ * power loss, or for a log written without an index).
+ *
+ * LogFile is the SD library's File, or anything with its read(), write(), seek(), size() and flush().
+ * Both files must be open for reading and writing (FILE_WRITE).
+ */
+template <class LogFile>
+class BasicTimeIndexedLog : public Print {
+	public:
+		BasicTimeIndexedLog(LogFile &data, LogFile &index);
+		bool begin();
+		void beginRecord(unsigned long millisOfDay);
+		void beginRecord(GPSCoords &coords);
+		virtual size_t write(uint8_t c);
+		virtual size_t write(const uint8_t *buffer, size_t size);
+		using Print::write;
+		void flush();
+		unsigned long getRecordCount();
+		long findRecord(unsigned long millisOfDay);
+		int readRecord(unsigned long record, char *buffer, int size);
+		static unsigned long parseRecordTime(const char *line);
+
+		const static unsigned long TIME_UNKNOWN = 0xFFFFFFFFUL; // A record with no time; it is indexed at the time of the one before
+		const static byte RECORDS_PER_ENTRY = 8; // About one 512-byte sector of FORMAT_DMS_CSV lines
+		const static byte ENTRY_BUFFER_SIZE = 4; // Index entries held in RAM until flush(); more are written at once
+		const static int TIME_TEXT_SIZE = 12; // Longest record time parsed (hh:mm:ss.ss), plus the null
+
+	private:
+		LogFile *_data;
+		LogFile *_index;
+		unsigned long _dataSize; // Bytes; where the next record goes
+		unsigned long _records;
+		unsigned long _entriesWritten; // Entries in the index file; later ones are in _entries
+		LogIndexEntry _entries[ENTRY_BUFFER_SIZE];
+		byte _numEntries;
+		LogIndexEntry _firstEntry; // Kept to bound searches without reading the index
+		LogIndexEntry _dayEntry; // The first entry of the latest day, and its number
+		unsigned long _dayEntryNumber;
+		LogIndexEntry _lastEntry; // The latest entry, written or not
+		unsigned long _lastTime; // Time of the latest record, or TIME_UNKNOWN before the first known time
+		uint16_t _day;
+		bool _dataSeeked; // The data file has been read or seeked since it was last written, so must be seeked to its end
+		bool _indexSeeked; // As _dataSeeked, for the index file
+		bool _cursorValid; // The data file is positioned at the start of _cursorRecord, so the next can be read in sequence
+		unsigned long _cursorRecord;
+
+		void addRecord(unsigned long millisOfDay, unsigned long offset);
+		void writeEntries();
+		bool readEntry(unsigned long entry, LogIndexEntry &out);
+		unsigned long findEntry(uint16_t day, unsigned long millisOfDay, bool &found);
+		long findInBlock(unsigned long entry, uint16_t day, unsigned long millisOfDay, uint16_t &foundDay);
+		bool seekRecord(unsigned long record);
+		int readLine(char *buffer, int size);
+		unsigned long getEntryCount();
+		static bool isAtOrBefore(uint16_t day, unsigned long millisOfDay, uint16_t targetDay, unsigned long target);
+		static uint16_t entryCheck(const LogIndexEntry &entry);
+};
+
+typedef BasicTimeIndexedLog<File> TimeIndexedLog;
+
+template <class LogFile>
+BasicTimeIndexedLog<LogFile>::BasicTimeIndexedLog(LogFile &data, LogFile &index) {
+	_data = &data;
+	_index = &index;
+	_dataSize = 0;
+	_records = 0;
+	_entriesWritten = 0;
+	_numEntries = 0;
+	_dayEntryNumber = 0;
+	_lastTime = TIME_UNKNOWN;
+	_day = 0;
+	_dataSeeked = false;
+	_indexSeeked = false;
+	_cursorValid = false;
+	_cursorRecord = 0;
+}
+
+/* Reads the state of the log from the end of its files, once they are open, and indexes any records the index
+ * lacks. Returns false if the index is damaged (a torn last entry, or an entry past the end of the data); remove
+ * the index file, open it again, and call begin() to rebuild it from the data.
+ */
+template <class LogFile>
+bool BasicTimeIndexedLog<LogFile>::begin() {
+	_dataSize = _data->size();
+	unsigned long indexSize = _index->size();
+	_entriesWritten = indexSize / sizeof(LogIndexEntry);
+	_numEntries = 0;
+	_records = 0;
+	_lastTime = TIME_UNKNOWN;
+	_day = 0;
+	_dataSeeked = true;
+	_indexSeeked = true;
+	_cursorValid = false;
+	if((indexSize % sizeof(LogIndexEntry)) != 0)
+		return false;
+
+	unsigned long offset = 0; // Where the records the index lacks begin
+	if(_entriesWritten > 0) {
+		_records = (_entriesWritten - 1) * RECORDS_PER_ENTRY;
+		if(!readEntry(_entriesWritten - 1, _lastEntry) || (entryCheck(_lastEntry) != _lastEntry.check)
+				|| (_lastEntry.record != _records) || (_lastEntry.offset > _dataSize))
+			return false;
+		_day = _lastEntry.day;
+		_lastTime = _lastEntry.millisOfDay;
+		offset = _lastEntry.offset;
+		if(!readEntry(0, _firstEntry))
+			return false;
+		// Bisects for the first entry of the latest day
+		unsigned long low = 0;
+		_dayEntryNumber = _entriesWritten - 1;
+		_dayEntry = _lastEntry;
+		while(low < _dayEntryNumber) {
+			unsigned long middle = low + (_dayEntryNumber - low) / 2;
+			LogIndexEntry entry;
+			if(!readEntry(middle, entry))
+				return false;
+			if(entry.day < _day) {
+				low = middle + 1;
+			}
+			else {
+				_dayEntryNumber = middle;
+				_dayEntry = entry;
+			}
+		}
+	}
+
+	// Reads the records from the last entry on, adding the entries for any whole blocks among them
+	_data->seek(offset);
+	bool first = (_entriesWritten > 0); // The last entry's own record is already indexed
+	char time[TIME_TEXT_SIZE];
+	for(int length = readLine(time, sizeof(time)); length >= 0; length = readLine(time, sizeof(time))) {
+		if(first)
+			_records++;
+		else
+			addRecord(parseRecordTime(time), offset);
+		first = false;
+		offset += length;
+		if(_numEntries == ENTRY_BUFFER_SIZE)
+			writeEntries();
+	}
+	writeEntries();
+	_index->flush();
+	return true;
+}
+
+// Begins a record, at the given time (TIME_UNKNOWN if it has none); print the record as one line after this
+template <class LogFile>
+void BasicTimeIndexedLog<LogFile>::beginRecord(unsigned long millisOfDay) {
+	addRecord(millisOfDay, _dataSize);
+	if(_numEntries == ENTRY_BUFFER_SIZE)
+		writeEntries();
+}
+
+// Begins a record at the time of a fix; a fix whose GGA sentence had no time gets TIME_UNKNOWN
+template <class LogFile>
+void BasicTimeIndexedLog<LogFile>::beginRecord(GPSCoords &coords) {
+	beginRecord(coords.hasTime() ? coords.getMillisOfDay() : TIME_UNKNOWN);
+}
+
+template <class LogFile>
+size_t BasicTimeIndexedLog<LogFile>::write(uint8_t c) {
+	return write(&c, 1);
+}
+
+template <class LogFile>
+size_t BasicTimeIndexedLog<LogFile>::write(const uint8_t *buffer, size_t size) {
+	if(_dataSeeked) {
+		_data->seek(_dataSize);
+		_dataSeeked = false;
+		_cursorValid = false;
+	}
+	size_t written = _data->write(buffer, size);
+	_dataSize += written;
+	return written;
+}
+
+// Writes buffered records to the card, then the index entries for them
+template <class LogFile>
+void BasicTimeIndexedLog<LogFile>::flush() {
+	_data->flush();
+	writeEntries();
+	_index->flush();
+}
+
+template <class LogFile>
+unsigned long BasicTimeIndexedLog<LogFile>::getRecordCount() {
+	return _records;
+}
+
+/* Finds the latest record at or before the last time the log passed a time of day (so just after midnight, 23:50
+ * is found on the day before). Returns the record's number, or -1 if there is none.
+ */
+template <class LogFile>
+long BasicTimeIndexedLog<LogFile>::findRecord(unsigned long millisOfDay) {
+	if((_records == 0) || (millisOfDay >= GPSCoords::MILLIS_PER_DAY))
+		return -1;
+	uint16_t day = _day;
+	if((day > 0) && (_lastTime != TIME_UNKNOWN) && (millisOfDay > _lastTime)) // Not yet reached today
+		day--;
+	bool found;
+	uint16_t foundDay;
+	unsigned long entry = findEntry(day, millisOfDay, found);
+	long record = found ? findInBlock(entry, day, millisOfDay, foundDay) : -1;
+	if((record >= 0) && (foundDay < day)) { // The time is before the first record of that day (a session begun later in it)
+		entry = findEntry(day - 1, millisOfDay, found);
+		record = found ? findInBlock(entry, day - 1, millisOfDay, foundDay) : -1;
+	}
+	return record;
+}
+
+/* Reads a record (0 is the first) into buffer, without its line ending. Returns its length, or -1 if there is no
+ * such record; at most size - 1 characters are kept. Reading records in order reads each sector once.
+ */
+template <class LogFile>
+int BasicTimeIndexedLog<LogFile>::readRecord(unsigned long record, char *buffer, int size) {
+	if(!seekRecord(record))
+		return -1;
+	if(readLine(buffer, size) < 0) {
+		_cursorValid = false;
+		return -1;
+	}
+	_cursorRecord++;
+	return strlen(buffer);
+}
+
+/* Parses the time a record begins with, as getFormattedTimeString() writes it (hh:mm:ss, with any fraction), into
+ * milliseconds since midnight UTC. Returns TIME_UNKNOWN if the line does not begin with a time.
+ */
+template <class LogFile>
+unsigned long BasicTimeIndexedLog<LogFile>::parseRecordTime(const char *line) {
+	unsigned long fields[3];
+	const char *c = line;
+	for(byte i = 0; i < 3; i++) {
+		if(!isdigit(c[0]) || !isdigit(c[1]))
+			return TIME_UNKNOWN;
+		fields[i] = (c[0] - '0') * 10 + (c[1] - '0');
+		c += 2;
+		if((i < 2) && (*c++ != ':'))
+			return TIME_UNKNOWN;
+	}
+	unsigned long fraction = 0;
+	if(*c == '.') {
+		c++;
+		for(unsigned long place = 100; (place > 0) && isdigit(*c); place /= 10, c++)
+			fraction += (*c - '0') * place;
+	}
+	unsigned long millisOfDay = ((fields[0] * 60 + fields[1]) * 60 + fields[2]) * 1000 + fraction;
+	return (millisOfDay < GPSCoords::MILLIS_PER_DAY) ? millisOfDay : TIME_UNKNOWN;
+}
+
+/* Counts a record at offset, taking it into the time of the log. A record whose time is earlier than the last
+ * starts a new day; one with no time takes the time of the last.
+ */
+template <class LogFile>
+void BasicTimeIndexedLog<LogFile>::addRecord(unsigned long millisOfDay, unsigned long offset) {
+	if(millisOfDay >= GPSCoords::MILLIS_PER_DAY)
+		millisOfDay = _lastTime;
+	bool newDay = (millisOfDay != TIME_UNKNOWN) && (_lastTime != TIME_UNKNOWN) && (millisOfDay < _lastTime);
+	if(newDay)
+		_day++;
+	if(millisOfDay != TIME_UNKNOWN)
+		_lastTime = millisOfDay;
+	if((_records % RECORDS_PER_ENTRY) == 0) {
+		LogIndexEntry &entry = _entries[_numEntries++];
+		entry.record = _records;
+		entry.offset = offset;
+		entry.millisOfDay = (_lastTime == TIME_UNKNOWN) ? 0 : _lastTime;
+		entry.day = _day;
+		entry.check = entryCheck(entry);
+		if(_records == 0)
+			_firstEntry = entry;
+		if((_records == 0) || (entry.day != _lastEntry.day)) {
+			_dayEntry = entry;
+			_dayEntryNumber = _records / RECORDS_PER_ENTRY;
+		}
+		_lastEntry = entry;
+	}
+	_records++;
+}
+
+template <class LogFile>
+void BasicTimeIndexedLog<LogFile>::writeEntries() {
+	if(_numEntries == 0)
+		return;
+	if(_indexSeeked) {
+		_index->seek(_entriesWritten * sizeof(LogIndexEntry));
+		_indexSeeked = false;
+	}
+	_index->write((const uint8_t *) _entries, _numEntries * sizeof(LogIndexEntry));
+	_entriesWritten += _numEntries;
+	_numEntries = 0;
+}
+
+template <class LogFile>
+bool BasicTimeIndexedLog<LogFile>::readEntry(unsigned long entry, LogIndexEntry &out) {
+	if(entry >= _entriesWritten) {
+		if(entry >= _entriesWritten + _numEntries)
+			return false;
+		out = _entries[entry - _entriesWritten];
+		return true;
+	}
+	_indexSeeked = true;
+	return _index->seek(entry * sizeof(LogIndexEntry)) && (_index->read((uint8_t *) &out, sizeof(out)) == (int) sizeof(out));
+}
+
+/* Finds the last index entry at or before the given day and time; found is false if the first entry is after it.
+ * Each round interpolates on time, which lands on or next to the entry when fixes come at a steady rate, then
+ * gallops from there toward the time in doubling steps until a probe crosses it, which brackets the entry however
+ * unsteady the fixes were. Probes near one another share the SD library's cached sector.
+ */
+template <class LogFile>
+unsigned long BasicTimeIndexedLog<LogFile>::findEntry(uint16_t day, unsigned long millisOfDay, bool &found) {
+	found = isAtOrBefore(_firstEntry.day, _firstEntry.millisOfDay, day, millisOfDay);
+	if(!found)
+		return 0;
+	unsigned long highEntry = getEntryCount() - 1;
+	if(isAtOrBefore(_lastEntry.day, _lastEntry.millisOfDay, day, millisOfDay))
+		return highEntry;
+	// The low entry is at or before the time, and the high one after it; a search within a day stays within it
+	unsigned long lowEntry = 0;
+	LogIndexEntry low = _firstEntry;
+	LogIndexEntry high = _lastEntry;
+	if(isAtOrBefore(_dayEntry.day, _dayEntry.millisOfDay, day, millisOfDay)) {
+		lowEntry = _dayEntryNumber;
+		low = _dayEntry;
+	}
+	else if(_dayEntryNumber > 0) {
+		highEntry = _dayEntryNumber;
+		high = _dayEntry;
+	}
+	unsigned long reach = 0; // Entries from the last probe to the next while galloping; 0 to interpolate
+	bool movedLow = true; // The last probe was at or before the time
+	while(highEntry - lowEntry > 1) {
+		unsigned long probe;
+		if(reach == 0) {
+			probe = lowEntry + (highEntry - lowEntry) / 2;
+			// Seconds after the low entry's day began; a float is precise enough to aim a probe
+			float lowSeconds = low.millisOfDay / 1000.0;
+			float targetSeconds = (day - low.day) * 86400.0 + millisOfDay / 1000.0;
+			float highSeconds = (high.day - low.day) * 86400.0 + high.millisOfDay / 1000.0;
+			if(highSeconds > lowSeconds)
+				probe = lowEntry + (unsigned long) ((targetSeconds - lowSeconds) / (highSeconds - lowSeconds) * (highEntry - lowEntry));
+			probe = constrain(probe, lowEntry + 1, highEntry - 1);
+		}
+		else {
+			probe = movedLow ? min(lowEntry + reach, highEntry - 1) : max(highEntry - reach, lowEntry + 1);
+		}
+		LogIndexEntry entry;
+		if(!readEntry(probe, entry))
+			break;
+		bool atOrBefore = isAtOrBefore(entry.day, entry.millisOfDay, day, millisOfDay);
+		if(reach == 0)
+			reach = 1; // Gallop from the interpolated probe toward the time
+		else
+			reach = (atOrBefore == movedLow) ? reach * 2 : 0; // Until a probe crosses it; then interpolate again
+		movedLow = atOrBefore;
+		if(movedLow) {
+			lowEntry = probe;
+			low = entry;
+		}
+		else {
+			highEntry = probe;
+			high = entry;
+		}
+	}
+	return lowEntry;
+}
+
+/* Finds the latest record of an entry's block at or before the given day and time, reading the times of its
+ * records as addRecord() counted them, and sets foundDay to its day. Returns -1 if the block's first record is
+ * after the time.
+ */
+template <class LogFile>
+long BasicTimeIndexedLog<LogFile>::findInBlock(unsigned long entry, uint16_t day, unsigned long millisOfDay, uint16_t &foundDay) {
+	LogIndexEntry first;
+	if(!readEntry(entry, first) || !isAtOrBefore(first.day, first.millisOfDay, day, millisOfDay))
+		return -1;
+	unsigned long record = entry * RECORDS_PER_ENTRY;
+	if(!seekRecord(record) || (readLine(NULL, 0) < 0))
+		return -1;
+	long found = record;
+	foundDay = first.day;
+	uint16_t recordDay = first.day;
+	unsigned long lastTime = first.millisOfDay;
+	char time[TIME_TEXT_SIZE];
+	_cursorValid = false; // Records are read past the one found
+	for(record++; (record < _records) && (record < (entry + 1) * RECORDS_PER_ENTRY); record++) {
+		if(readLine(time, sizeof(time)) < 0)
+			break;
+		unsigned long recordTime = parseRecordTime(time);
+		if(recordTime != TIME_UNKNOWN) {
+			if(recordTime < lastTime)
+				recordDay++;
+			lastTime = recordTime;
+		}
+		if(!isAtOrBefore(recordDay, lastTime, day, millisOfDay))
+			break;
+		found = record;
+		foundDay = recordDay;
+	}
+	return found;
+}
+
+// Positions the data file at the start of a record: from the read cursor if that is earlier in the same block, or else from the block's entry
+template <class LogFile>
+bool BasicTimeIndexedLog<LogFile>::seekRecord(unsigned long record) {
+	if(record >= _records)
+		return false;
+	unsigned long entry = record / RECORDS_PER_ENTRY;
+	if(!_cursorValid || (_cursorRecord > record) || (_cursorRecord / RECORDS_PER_ENTRY != entry)) {
+		LogIndexEntry blockEntry;
+		if(!readEntry(entry, blockEntry) || !_data->seek(blockEntry.offset)) {
+			_cursorValid = false;
+			return false;
+		}
+		_dataSeeked = true;
+		_cursorValid = true;
+		_cursorRecord = entry * RECORDS_PER_ENTRY;
+	}
+	while(_cursorRecord < record) {
+		if(readLine(NULL, 0) < 0) {
+			_cursorValid = false;
+			return false;
+		}
+		_cursorRecord++;
+	}
+	return true;
+}
+
+/* Reads a line from the data file, keeping up to size - 1 characters of it (without the line ending) in buffer
+ * if buffer is not NULL. Returns the bytes read, line ending included, or -1 at the end of the data.
+ */
+template <class LogFile>
+int BasicTimeIndexedLog<LogFile>::readLine(char *buffer, int size) {
+	int length = 0;
+	int kept = 0;
+	int c;
+	while((c = _data->read()) >= 0) {
+		length++;
+		if(c == '\n')
+			break;
+		if((buffer != NULL) && (c != '\r') && (kept < size - 1))
+			buffer[kept++] = c;
+	}
+	if(buffer != NULL)
+		buffer[kept] = '\0';
+	return (length > 0) ? length : -1;
+}
+
+template <class LogFile>
+unsigned long BasicTimeIndexedLog<LogFile>::getEntryCount() {
+	return _entriesWritten + _numEntries;
+}
+
+template <class LogFile>
+bool BasicTimeIndexedLog<LogFile>::isAtOrBefore(uint16_t day, unsigned long millisOfDay, uint16_t targetDay, unsigned long target) {
+	return (day < targetDay) || ((day == targetDay) && (millisOfDay <= target));
+}
+
+template <class LogFile>
+uint16_t BasicTimeIndexedLog<LogFile>::entryCheck(const LogIndexEntry &entry) {
+	uint32_t sum = entry.record ^ entry.offset ^ (entry.millisOfDay << 3) ^ entry.day ^ 0xB0C5UL;
+	return (uint16_t) (sum ^ (sum >> 16));
+}
+
+#endif
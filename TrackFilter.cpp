@@ -0,0 +1,156 @@
+/* Horizontal Track Smoothing Filter for Arduino
+ * Developed for the Space Systems Laboratory at the University of Maryland
+ * Part of the BPPCell library
+ * See GitHub.com/UMDBPP/BPPCell or the accompanying readme for further details.
+ *
+ * Copyright (c) 2015 Luke Renegar
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#define BPPCELL_SOURCE
+#include "Arduino.h"
+#include "BPPCell.h"
+
+/* Creates a filter.
+ * uere is the position error in meters per unit of HDOP; processNoise is how fast, in square meters per second, the
+ * filter loses confidence in its own prediction; gateSigmas sets the outlier gate around the prediction.
+ */
+TrackFilter::TrackFilter(long uere, long processNoise, int gateSigmas) {
+	_uere = uere;
+	_processNoise = processNoise;
+	_gateSigmas = gateSigmas;
+	_numRejected = 0;
+	reset();
+}
+
+// Discards the filter state; the next valid fix is accepted as is
+void TrackFilter::reset() {
+	_initialized = false;
+	_lastMillis = 0;
+	_lat = 0;
+	_lon = 0;
+	_velLat = 0;
+	_velLon = 0;
+	_variance = 0;
+	_consecutiveRejects = 0;
+}
+
+bool TrackFilter::isInitialized() {
+	return _initialized;
+}
+
+// Gets the filtered latitude; unit is ten-thousandths of a minute
+long TrackFilter::getLat() {
+	return _lat;
+}
+
+// Gets the filtered longitude; unit is ten-thousandths of a minute
+long TrackFilter::getLon() {
+	return _lon;
+}
+
+// Gets the variance of the filtered position; unit is square meters
+long TrackFilter::getVariance() {
+	return _variance;
+}
+
+// Gets the number of fixes rejected since the filter was created
+int TrackFilter::getNumRejected() {
+	return _numRejected;
+}
+
+/* Feeds one fix, taken at time now (milliseconds, e.g. from millis()), to the filter.
+ * If the fix is accepted, its latitude and longitude are replaced with the filtered position and true is returned.
+ * If it is invalid or an outlier, coords is left untouched and false is returned; the caller should discard it.
+ */
+bool TrackFilter::update(GPSCoords &coords, unsigned long now) {
+	if(!coords.isValid()) {
+		_numRejected++;
+		return false;
+	}
+	
+	long sigma = ((long) coords.getHDOP() * _uere + 50) / 100; // Meters
+	long measurementVariance = max(sigma * sigma, 1L);
+	unsigned long dt = now - _lastMillis;
+	if(!_initialized || (dt > MAX_INTERVAL)) {
+		initialize(coords, measurementVariance, now);
+		return true;
+	}
+	if(dt == 0)
+		dt = 1;
+	
+	// Predict
+	long predLat = _lat + (long) (((long long) _velLat * (long) dt) >> 20);
+	long predLon = _lon + (long) (((long long) _velLon * (long) dt) >> 20);
+	long predVariance = min(_variance + (long) ((_processNoise * (long) dt) / 1000), MAX_VARIANCE);
+	
+	// Gate the innovation; both components are clamped so that the sum of squares fits in 32 bits
+	long dLat = coords.getLat() - predLat;
+	long dLon = GeoMath::wrapLon(coords.getLon() - predLon);
+	long north = constrain(GeoMath::toMeters(dLat), -30000L, 30000L);
+	long east = constrain(GeoMath::mulQ15(GeoMath::toMeters(dLon), GeoMath::cosQ15(predLat)), -30000L, 30000L);
+	unsigned long innovationSquared = (unsigned long) (north * north) + (unsigned long) (east * east);
+	long innovationVariance = predVariance + measurementVariance; // Per axis
+	unsigned long gate = (unsigned long) _gateSigmas * _gateSigmas * 2 * (unsigned long) innovationVariance; // Two axes
+	if(innovationSquared > gate) {
+		_numRejected++;
+		_consecutiveRejects++;
+		if(_consecutiveRejects >= MAX_CONSECUTIVE_REJECTS) // The filter, not the receiver, is probably wrong
+			_initialized = false;
+		return false;
+	}
+	
+	// Gains: alpha as in a scalar Kalman filter, beta from alpha by the Benedict-Bordner relation, both in Q15
+	long p = predVariance;
+	long s = innovationVariance;
+	while(s >= 65536) { // Keeps the shifted numerator below 2^31
+		p >>= 1;
+		s >>= 1;
+	}
+	int alpha = (int) ((p << 15) / s); // Below 32768 since the measurement variance is at least 1
+	int beta = (int) (((long) alpha * alpha) / (65536L - alpha));
+	
+	// Correct
+	unsigned long inverseDtQ30 = (1UL << 30) / dt;
+	_lat = predLat + GeoMath::mulQ15(dLat, alpha);
+	_lon = GeoMath::wrapLon(predLon + GeoMath::mulQ15(dLon, alpha));
+	_velLat += (long) (((long long) GeoMath::mulQ15(dLat, beta) * (long long) inverseDtQ30) >> 10);
+	_velLon += (long) (((long long) GeoMath::mulQ15(dLon, beta) * (long long) inverseDtQ30) >> 10);
+	_variance = max(predVariance - GeoMath::mulQ15(predVariance, alpha), 1L);
+	_lastMillis = now;
+	_consecutiveRejects = 0;
+	
+	coords.setLat(_lat);
+	coords.setLon(_lon);
+	return true;
+}
+
+// Starts the filter at the given fix with no velocity
+void TrackFilter::initialize(GPSCoords &coords, long measurementVariance, unsigned long now) {
+	_initialized = true;
+	_lastMillis = now;
+	_lat = coords.getLat();
+	_lon = coords.getLon();
+	_velLat = 0;
+	_velLon = 0;
+	_variance = measurementVariance;
+	_consecutiveRejects = 0;
+}
@@ -0,0 +1,297 @@
+/* Raw UBX SD Log for Arduino
+ * Part of the BPPCell library. Include this after BPPCell.h to log the receiver's UBX output to SD as it is, e.g.
+ *   File ubxFile;
+ *   UBXLog ubxLog(ubxFile);
+ *   ubxLog.attach(gnssComm);
+ * See GitHub.com/UMDBPP/BPPCell or the accompanying readme for further details.
+ *
+ * The log file holds the UBX messages back to back, sync characters to checksum, as u-center and RTKLIB read them.
+ * Every byte the GNSSComm reads is framed in place: a message is written straight into a two-sector ring buffer as
+ * it arrives, with no copy through a frame buffer and no text, and is kept only if its checksum matches. The ring
+ * is aligned with the file's sectors, so that while one sector is being filled the other, once full, waits to be
+ * written to the card whole, which the SD library does without reading the sector first.
+ */
+
+#ifndef UBXLog_h
+#define UBXLog_h
+
+#include "Arduino.h"
+#include <SD.h>
+#include "BPPCell.h"
+
+/* Double-buffered raw UBX log
+ * Bytes are fed by the GNSSComm it is attached to (or by feed()), from within the GNSS reads; full sectors are
+ * written by step(), which a Scheduler task calls between reads, so the card's latency never holds up the bus. A
+ * message is logged whole or not at all: if the ring has no room for it when its length arrives (the card fell
+ * more than a sector behind), it is dropped and counted as an overflow, and logging resumes with the next one.
+ * NMEA sentences, the receiver's filler and anything else between messages are not logged.
+ *
+ * LogFile is the SD library's File, or anything with its write(), size() and flush(). The file must be open for
+ * writing (FILE_WRITE); messages are appended to what it holds.
+ */
+template <class LogFile>
+class BasicUBXLog {
+	public:
+		BasicUBXLog(LogFile &file);
+		void begin();
+		template <class Comm>
+		void attach(Comm &comm);
+		void feed(byte b);
+		void feed(const byte *data, int length);
+		bool step();
+		void flush();
+		unsigned long getMessageCount();
+		unsigned long getOverflowCount();
+		unsigned long getErrorCount();
+		void printStats(Print &out);
+		void resetStats();
+		static void handleByte(void *context, byte b);
+
+		const static int SECTOR_SIZE = 512;
+		const static int BUFFER_SIZE = 2 * SECTOR_SIZE; // Longest message that can be logged, framing included
+
+	private:
+		const static byte STATE_IDLE = 0; // Between messages, looking for 0xB5
+		const static byte STATE_SYNC = 1; // Had 0xB5; expecting 0x62
+		const static byte STATE_HEADER = 2; // Class, id and length, held in _header until there is room for the message
+		const static byte STATE_PAYLOAD = 3; // Payload and checksum, in the ring
+		const static byte STATE_SKIP = 4; // The rest of a message dropped for want of room
+
+		LogFile *_file;
+		byte _buffer[BUFFER_SIZE]; // The byte at file offset n is at n % BUFFER_SIZE
+		unsigned long _written; // File offsets: bytes before this are on the card
+		unsigned long _committed; // Bytes before this are whole messages whose checksum matched
+		unsigned long _head; // Where the next byte of the message being framed goes
+		byte _header[6];
+		byte _headerLength;
+		unsigned int _remaining; // Bytes of the message still to come, checksum included
+		byte _state;
+		byte _ckA;
+		byte _ckB;
+
+		unsigned long _messages;
+		unsigned long _bytes; // Logged, i.e. committed
+		unsigned long _overflows; // Messages dropped for want of room
+		unsigned long _overflowBytes;
+		unsigned long _checksumErrors;
+		unsigned long _writeErrors; // Bytes the card did not take
+
+		void put(byte b);
+		void endMessage();
+		void writeTo(unsigned long end);
+};
+
+typedef BasicUBXLog<File> UBXLog;
+
+template <class LogFile>
+BasicUBXLog<LogFile>::BasicUBXLog(LogFile &file) {
+	_file = &file;
+	_written = 0;
+	_committed = 0;
+	_head = 0;
+	_headerLength = 0;
+	_remaining = 0;
+	_state = STATE_IDLE;
+	_ckA = 0;
+	_ckB = 0;
+	resetStats();
+}
+
+// Takes the end of the file, once it is open, as the start of the log, and drops any message partly framed
+template <class LogFile>
+void BasicUBXLog<LogFile>::begin() {
+	_written = _file->size();
+	_committed = _written;
+	_head = _written;
+	_state = STATE_IDLE;
+}
+
+// Has every byte the GNSSComm (any BasicGNSSComm) reads, by step() or any blocking call, fed to the log
+template <class LogFile>
+template <class Comm>
+void BasicUBXLog<LogFile>::attach(Comm &comm) {
+	comm.setRawHandler(handleByte, this);
+}
+
+// A RawByteHandler, whose context is the log
+template <class LogFile>
+void BasicUBXLog<LogFile>::handleByte(void *context, byte b) {
+	((BasicUBXLog<LogFile> *) context)->feed(b);
+}
+
+/* Takes the next byte of the receiver's stream. The checksum is summed as the bytes arrive, so a message costs one
+ * store and two additions a byte, and nothing more when it ends.
+ */
+template <class LogFile>
+void BasicUBXLog<LogFile>::feed(byte b) {
+	switch(_state) {
+		case STATE_IDLE:
+			if(b == 0xB5)
+				_state = STATE_SYNC;
+			break;
+		case STATE_SYNC:
+			if(b == 0x62) {
+				_header[0] = 0xB5;
+				_header[1] = 0x62;
+				_headerLength = 2;
+				_ckA = 0;
+				_ckB = 0;
+				_state = STATE_HEADER;
+			}
+			else {
+				_state = (b == 0xB5) ? STATE_SYNC : STATE_IDLE;
+			}
+			break;
+		case STATE_HEADER:
+			_header[_headerLength++] = b;
+			_ckA += b;
+			_ckB += _ckA;
+			if(_headerLength == sizeof(_header)) {
+				unsigned int length = _header[4] | ((unsigned int) _header[5] << 8); // Little endian
+				if(length > BUFFER_SIZE - sizeof(_header) - 2) { // Too long ever to log, or a corrupt length; not skipped
+					_overflows++;
+					_state = STATE_IDLE;
+					break;
+				}
+				_remaining = length + 2; // The checksum too
+				if((_committed - _written) + sizeof(_header) + _remaining > BUFFER_SIZE) {
+					_overflows++;
+					_overflowBytes += sizeof(_header) + _remaining;
+					_state = STATE_SKIP;
+					break;
+				}
+				for(byte i = 0; i < sizeof(_header); i++)
+					put(_header[i]);
+				_state = STATE_PAYLOAD;
+			}
+			break;
+		case STATE_PAYLOAD:
+			put(b);
+			_remaining--;
+			if(_remaining > 1) {
+				_ckA += b;
+				_ckB += _ckA;
+			}
+			else if(_remaining == 0) {
+				endMessage();
+			}
+			break;
+		case STATE_SKIP:
+			if(--_remaining == 0)
+				_state = STATE_IDLE;
+			break;
+	}
+}
+
+template <class LogFile>
+void BasicUBXLog<LogFile>::feed(const byte *data, int length) {
+	for(int i = 0; i < length; i++)
+		feed(data[i]);
+}
+
+template <class LogFile>
+void BasicUBXLog<LogFile>::put(byte b) {
+	_buffer[_head % BUFFER_SIZE] = b;
+	_head++;
+}
+
+// Keeps the message just framed if its checksum, the last two bytes put, matches; otherwise takes it back
+template <class LogFile>
+void BasicUBXLog<LogFile>::endMessage() {
+	_state = STATE_IDLE;
+	if((_buffer[(_head - 2) % BUFFER_SIZE] != _ckA) || (_buffer[(_head - 1) % BUFFER_SIZE] != _ckB)) {
+		_checksumErrors++;
+		_head = _committed;
+		return;
+	}
+	_messages++;
+	_bytes += _head - _committed;
+	_committed = _head;
+}
+
+/* Writes the oldest sector to the card, if it is full of whole messages. Returns true if it wrote one, so that a
+ * task can return at once and come back for the next. Call it between GNSS reads: often enough that a sector is
+ * written before the other fills, which at the MAX-7Q's full output of a few kilobytes a second means every 100 ms
+ * or so, less the time the card takes.
+ */
+template <class LogFile>
+bool BasicUBXLog<LogFile>::step() {
+	unsigned long sectorEnd = (_written | (SECTOR_SIZE - 1)) + 1;
+	if(_committed < sectorEnd)
+		return false;
+	writeTo(sectorEnd);
+	return true;
+}
+
+/* Writes every whole message logged so far to the card, including the part sector, and has the SD library update
+ * the file's size on the card. A part sector is written again when it fills, so flush every few seconds, not after
+ * every message.
+ */
+template <class LogFile>
+void BasicUBXLog<LogFile>::flush() {
+	while(step())
+		;
+	if(_committed > _written)
+		writeTo(_committed);
+	_file->flush();
+}
+
+// Writes from _written up to end, which is no further than the end of its sector, so is contiguous in the ring
+template <class LogFile>
+void BasicUBXLog<LogFile>::writeTo(unsigned long end) {
+	BPPCELL_STAT_SCOPE(LOG_WRITE);
+	size_t length = end - _written;
+	size_t written = _file->write(_buffer + (_written % BUFFER_SIZE), length);
+	if(written < length) // The bytes are dropped, not retried, so a failed card cannot stop the logging
+		_writeErrors += length - written;
+	BPPCELL_STAT_BYTES(length);
+	_written = end;
+}
+
+template <class LogFile>
+unsigned long BasicUBXLog<LogFile>::getMessageCount() {
+	return _messages;
+}
+
+// Gets the number of messages dropped because the card fell behind
+template <class LogFile>
+unsigned long BasicUBXLog<LogFile>::getOverflowCount() {
+	return _overflows;
+}
+
+// Gets the number of messages dropped for a bad checksum, plus the bytes the card failed to take
+template <class LogFile>
+unsigned long BasicUBXLog<LogFile>::getErrorCount() {
+	return _checksumErrors + _writeErrors;
+}
+
+template <class LogFile>
+void BasicUBXLog<LogFile>::printStats(Print &out) {
+	out.print(F("ubx="));
+	out.print(_messages);
+	out.print(F(" logged="));
+	out.print(_bytes);
+	out.print(F("B overflow="));
+	out.print(_overflows);
+	out.print(F(" ("));
+	out.print(_overflowBytes);
+	out.print(F("B) checksum="));
+	out.print(_checksumErrors);
+	out.print(F(" unwritten="));
+	out.print(_writeErrors);
+	out.print(F("B pending="));
+	out.print(_committed - _written);
+	out.println(F("B"));
+}
+
+template <class LogFile>
+void BasicUBXLog<LogFile>::resetStats() {
+	_messages = 0;
+	_bytes = 0;
+	_overflows = 0;
+	_overflowBytes = 0;
+	_checksumErrors = 0;
+	_writeErrors = 0;
+}
+
+#endif
@@ -0,0 +1,829 @@
+/* Flight Log Analyzer for BPPCell
+ * Developed for the Space Systems Laboratory at the University of Maryland
+ * Part of the BPPCell library: a host tool for the logs the example sketch writes, not compiled for the Arduino
+ * See GitHub.com/UMDBPP/BPPCell or the accompanying readme for further details.
+ *
+ * Copyright (c) 2015 Luke Renegar
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/* Reads any number of datalog.txt files pulled off payload SD cards and reconstructs the flights in them.
+ * Each log is memory-mapped and parsed in parallel, in chunks split at line ends, so large archives take seconds.
+ * Lines in either CSV format of GPSCoords::formatCoordsForText() are read, with the CSQ the example sketch appends;
+ * every other line (headers, BPPCELL_STATS dumps, partial lines from a power cut) is counted and skipped, as are
+ * fixes at 0, 0 (no fix).
+ *
+ * A log is split into segments wherever its time jumps back or stops for longer than the gap (--gap). Segments from
+ * different cards are stitched into one flight when they overlap in time, within the gap, and agree in position to
+ * within --join meters, so several cards from one balloon, or a card that was restarted, make one track. Times are
+ * of day (the logs carry no date) and are unwrapped at midnight.
+ *
+ * For each flight it reports the extent, burst, speeds and ascent rates, and writes, as asked:
+ *   --kml FILE      KML: a 3D track and the burst point per flight
+ *   --geojson FILE  GeoJSON: a LineString per flight, with times, speeds and ascent rates per point
+ *   --csv FILE      The merged track, one point per line, with the derived values
+ * It also bins the CSQ readings by altitude (--bin meters) and correlates them with altitude, for coverage analysis.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../../LogFormat.h" // The layouts GPSCoords writes, shared with the library
+
+// The text formats of GPSCoords::formatCoordsForText() that are read
+const int FORMAT_DMS_CSV = LogFormat::DMS_CSV;
+const int FORMAT_DEC_DEGS_CSV = LogFormat::DEC_DEGS_CSV;
+const int DMS_CSV_FIELDS = LogFormat::DMS_CSV_FIELDS;
+const int DEC_DEGS_CSV_FIELDS = LogFormat::DEC_DEGS_CSV_FIELDS;
+const int CSQ_UNKNOWN = LogFormat::CSQ_UNKNOWN;
+
+const double EARTH_RADIUS = 6371008.8; // Meters, mean
+const double SECONDS_PER_DAY = 86400;
+const size_t CHUNK_SIZE = 8 << 20; // Bytes of log parsed as one task
+
+struct Fix {
+	double time; // Seconds since midnight of the log's first day
+	double lat; // Degrees
+	double lon;
+	double alt; // Meters MSL
+	int csq; // -1 if the line had none
+	int file;
+	double speed; // Derived, meters per second over the ground
+	double ascent; // Derived, meters per second
+};
+
+struct LogFile {
+	std::string name;
+	const char *data;
+	size_t size;
+	unsigned long lines;
+	unsigned long fixes;
+	unsigned long noFix;
+	unsigned long skipped;
+};
+
+struct Chunk {
+	int file;
+	const char *begin;
+	const char *end;
+	std::vector<Fix> fixes;
+	unsigned long lines;
+	unsigned long noFix;
+	unsigned long skipped;
+};
+
+struct Segment {
+	std::vector<Fix> fixes;
+	int flight;
+};
+
+struct Flight {
+	std::vector<int> segments;
+	double start;
+	double end;
+	std::vector<Fix> fixes;
+};
+
+struct Options {
+	double gap; // Seconds
+	double join; // Meters
+	double bin; // Meters
+	double interval; // Seconds over which speeds and ascent rates are taken
+	int threads;
+	const char *kml;
+	const char *geojson;
+	const char *csv;
+	bool stitch;
+};
+
+// Parses a decimal number (optional sign, digits, optional fraction) from [p, end); false if there are no digits
+static bool parseNumber(const char *p, const char *end, double &value, bool &negative) {
+	negative = false;
+	if((p < end) && ((*p == '-') || (*p == '+'))) {
+		negative = (*p == '-');
+		p++;
+	}
+	double whole = 0;
+	int digits = 0;
+	while((p < end) && (*p >= '0') && (*p <= '9')) {
+		whole = whole * 10 + (*p++ - '0');
+		digits++;
+	}
+	if((p < end) && (*p == '.')) {
+		p++;
+		double place = 0.1;
+		while((p < end) && (*p >= '0') && (*p <= '9')) {
+			whole += (*p++ - '0') * place;
+			place /= 10;
+			digits++;
+		}
+	}
+	if((digits == 0) || (p != end))
+		return false;
+	value = negative ? -whole : whole;
+	return true;
+}
+
+static bool parseNumber(const char *p, const char *end, double &value) {
+	bool negative;
+	return parseNumber(p, end, value, negative);
+}
+
+// Parses the time as GPSCoords::getFormattedTimeString() gives it (hh:mm:ss.ss) into seconds since midnight
+static bool parseTime(const char *p, const char *end, double &seconds) {
+	double parts[3];
+	int numParts = 0;
+	const char *start = p;
+	for(const char *c = p; c <= end; c++) {
+		if((c == end) || (*c == ':')) {
+			if((numParts == 3) || !parseNumber(start, c, parts[numParts]))
+				return false;
+			numParts++;
+			start = c + 1;
+		}
+	}
+	if(numParts != 3)
+		return false;
+	seconds = parts[0] * 3600 + parts[1] * 60 + parts[2];
+	return (seconds >= 0) && (seconds < SECONDS_PER_DAY);
+}
+
+// Degrees, minutes and seconds fields to degrees; the sign is on the degrees, and "-0" counts
+static bool parseDMS(const char *const *fields, const char *const *ends, double &degrees) {
+	double d, m, s;
+	bool negative;
+	if(!parseNumber(fields[0], ends[0], d, negative) || !parseNumber(fields[1], ends[1], m) || !parseNumber(fields[2], ends[2], s))
+		return false;
+	degrees = fabs(d) + m / 60 + s / 3600;
+	if(negative)
+		degrees = -degrees;
+	return true;
+}
+
+/* Parses one log line into fix. Returns 1 for a fix, 0 for a line in a known format without one (0, 0), and -1 for
+ * any other line.
+ */
+static int parseLine(const char *line, const char *end, Fix &fix) {
+	const int MAX_FIELDS = DMS_CSV_FIELDS + 1;
+	const char *fields[MAX_FIELDS];
+	const char *ends[MAX_FIELDS];
+	int numFields = 0;
+	const char *start = line;
+	for(const char *c = line; c <= end; c++) {
+		if((c == end) || (*c == ',')) {
+			if(numFields == MAX_FIELDS)
+				return -1;
+			fields[numFields] = start;
+			ends[numFields] = c;
+			numFields++;
+			start = c + 1;
+		}
+	}
+	int format;
+	if((numFields == DMS_CSV_FIELDS) || (numFields == DMS_CSV_FIELDS + 1))
+		format = FORMAT_DMS_CSV;
+	else if((numFields == DEC_DEGS_CSV_FIELDS) || (numFields == DEC_DEGS_CSV_FIELDS + 1))
+		format = FORMAT_DEC_DEGS_CSV;
+	else
+		return -1;
+	int formatFields = (format == FORMAT_DMS_CSV) ? DMS_CSV_FIELDS : DEC_DEGS_CSV_FIELDS;
+
+	if(!parseTime(fields[0], ends[0], fix.time))
+		return -1;
+	if(format == FORMAT_DMS_CSV) {
+		if(!parseDMS(fields + 1, ends + 1, fix.lat) || !parseDMS(fields + 4, ends + 4, fix.lon))
+			return -1;
+	}
+	else if(!parseNumber(fields[1], ends[1], fix.lat) || !parseNumber(fields[2], ends[2], fix.lon)) {
+		return -1;
+	}
+	if(!parseNumber(fields[formatFields - 1], ends[formatFields - 1], fix.alt))
+		return -1;
+	fix.csq = -1;
+	if(numFields > formatFields) {
+		double csq;
+		if(!parseNumber(fields[formatFields], ends[formatFields], csq))
+			return -1;
+		fix.csq = (int) csq;
+	}
+	if((fabs(fix.lat) > 90) || (fabs(fix.lon) > 180))
+		return -1;
+	if((fix.lat == 0) && (fix.lon == 0))
+		return 0;
+	fix.speed = 0;
+	fix.ascent = 0;
+	return 1;
+}
+
+static void parseChunk(Chunk &chunk) {
+	const char *p = chunk.begin;
+	while(p < chunk.end) {
+		const char *eol = (const char *) memchr(p, '\n', chunk.end - p);
+		const char *next = (eol == NULL) ? chunk.end : eol + 1;
+		if(eol == NULL)
+			eol = chunk.end;
+		if((eol > p) && (eol[-1] == '\r'))
+			eol--;
+		if(eol > p) {
+			chunk.lines++;
+			Fix fix;
+			int result = parseLine(p, eol, fix);
+			if(result > 0) {
+				fix.file = chunk.file;
+				chunk.fixes.push_back(fix);
+			}
+			else if(result == 0) {
+				chunk.noFix++;
+			}
+			else {
+				chunk.skipped++;
+			}
+		}
+		p = next;
+	}
+}
+
+static bool mapFile(LogFile &log) {
+	log.data = NULL;
+	log.size = 0;
+	int fd = open(log.name.c_str(), O_RDONLY);
+	if(fd < 0)
+		return false;
+	struct stat info;
+	if(fstat(fd, &info) != 0) {
+		close(fd);
+		return false;
+	}
+	log.size = info.st_size;
+	if(log.size > 0) {
+		void *data = mmap(NULL, log.size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(data == MAP_FAILED) {
+			close(fd);
+			return false;
+		}
+		madvise(data, log.size, MADV_SEQUENTIAL);
+		log.data = (const char *) data;
+	}
+	close(fd);
+	return true;
+}
+
+// Splits every log into chunks of about CHUNK_SIZE bytes, ending at line ends, and parses them on all threads
+static std::vector<Chunk> parseLogs(std::vector<LogFile> &logs, int threads) {
+	std::vector<Chunk> chunks;
+	for(size_t i = 0; i < logs.size(); i++) {
+		const char *p = logs[i].data;
+		const char *end = p + logs[i].size;
+		while(p < end) {
+			const char *split = p + std::min((size_t) (end - p), CHUNK_SIZE);
+			if(split < end) {
+				const char *eol = (const char *) memchr(split, '\n', end - split);
+				split = (eol == NULL) ? end : eol + 1;
+			}
+			Chunk chunk;
+			chunk.file = i;
+			chunk.begin = p;
+			chunk.end = split;
+			chunk.lines = 0;
+			chunk.noFix = 0;
+			chunk.skipped = 0;
+			chunks.push_back(chunk);
+			p = split;
+		}
+	}
+
+	std::atomic<size_t> next(0);
+	std::vector<std::thread> workers;
+	for(int t = 0; t < threads; t++) {
+		workers.push_back(std::thread([&chunks, &next]() {
+			for(size_t i = next++; i < chunks.size(); i = next++)
+				parseChunk(chunks[i]);
+		}));
+	}
+	for(size_t t = 0; t < workers.size(); t++)
+		workers[t].join();
+
+	for(size_t i = 0; i < chunks.size(); i++) {
+		LogFile &log = logs[chunks[i].file];
+		log.lines += chunks[i].lines;
+		log.fixes += chunks[i].fixes.size();
+		log.noFix += chunks[i].noFix;
+		log.skipped += chunks[i].skipped;
+	}
+	return chunks;
+}
+
+// Great-circle distance in meters
+static double distance(const Fix &a, const Fix &b) {
+	const double RADIANS = M_PI / 180;
+	double dLat = (b.lat - a.lat) * RADIANS;
+	double dLon = (b.lon - a.lon) * RADIANS;
+	double h = sin(dLat / 2) * sin(dLat / 2) + cos(a.lat * RADIANS) * cos(b.lat * RADIANS) * sin(dLon / 2) * sin(dLon / 2);
+	return 2 * EARTH_RADIUS * asin(std::min(1.0, sqrt(h)));
+}
+
+/* Splits each log's fixes, in log order, into segments at backward jumps and gaps. A jump back of more than half a
+ * day is taken as midnight, and the day is carried on.
+ */
+static std::vector<Segment> segmentLogs(const std::vector<Chunk> &chunks, const Options &options) {
+	std::vector<Segment> segments;
+	int file = -1;
+	double day = 0;
+	double previous = 0;
+	for(size_t c = 0; c < chunks.size(); c++) {
+		for(size_t i = 0; i < chunks[c].fixes.size(); i++) {
+			Fix fix = chunks[c].fixes[i];
+			bool split = (fix.file != file);
+			if(split) {
+				file = fix.file;
+				day = 0;
+			}
+			else {
+				if(fix.time + day < previous - SECONDS_PER_DAY / 2)
+					day += SECONDS_PER_DAY;
+				double step = fix.time + day - previous;
+				split = (step < 0) || (step > options.gap);
+			}
+			fix.time += day;
+			previous = fix.time;
+			if(split) {
+				segments.push_back(Segment());
+				segments.back().flight = -1;
+			}
+			segments.back().fixes.push_back(fix);
+		}
+	}
+	return segments;
+}
+
+// The fix of the segment nearest in time to time
+static const Fix &nearestFix(const Segment &segment, double time) {
+	const std::vector<Fix> &fixes = segment.fixes;
+	size_t low = 0;
+	size_t high = fixes.size() - 1;
+	while(low < high) {
+		size_t middle = (low + high) / 2;
+		if(fixes[middle].time < time)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	if((low > 0) && (time - fixes[low - 1].time < fixes[low].time - time))
+		low--;
+	return fixes[low];
+}
+
+/* Whether segment, moved by shift seconds, belongs to flight: their spans overlap or come within the gap, and the
+ * fix of the segment nearest the start of the overlap is within the gap and the join distance of one of the flight's.
+ */
+static bool matches(const Segment &segment, double shift, const Flight &flight, const std::vector<Segment> &segments,
+		const Options &options) {
+	double start = segment.fixes.front().time + shift;
+	double end = segment.fixes.back().time + shift;
+	if((start > flight.end + options.gap) || (end < flight.start - options.gap))
+		return false;
+	Fix probe = nearestFix(segment, std::max(start, flight.start) - shift);
+	probe.time += shift;
+	for(size_t s = 0; s < flight.segments.size(); s++) {
+		const Fix &near = nearestFix(segments[flight.segments[s]], probe.time);
+		if((fabs(near.time - probe.time) <= options.gap) && (distance(near, probe) <= options.join))
+			return true;
+	}
+	return false;
+}
+
+/* Groups segments into flights, taking them in order of start time; a segment that matches no flight starts one.
+ * Each log's times count from its own first midnight, so a segment is also tried a day either way, for cards whose
+ * logs start on different sides of midnight; a flight left starting before midnight is moved on a day.
+ */
+static std::vector<Flight> stitch(std::vector<Segment> &segments, const Options &options) {
+	std::vector<int> order(segments.size());
+	for(size_t i = 0; i < order.size(); i++)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&segments](int a, int b) {
+		return segments[a].fixes.front().time < segments[b].fixes.front().time;
+	});
+
+	const double SHIFTS[] = {0, -SECONDS_PER_DAY, SECONDS_PER_DAY};
+	std::vector<Flight> flights;
+	for(size_t i = 0; i < order.size(); i++) {
+		Segment &segment = segments[order[i]];
+		double shift = 0;
+		for(size_t f = 0; options.stitch && (f < flights.size()) && (segment.flight < 0); f++) {
+			for(int s = 0; s < 3; s++) {
+				if(matches(segment, SHIFTS[s], flights[f], segments, options)) {
+					segment.flight = f;
+					shift = SHIFTS[s];
+					break;
+				}
+			}
+		}
+		for(size_t j = 0; (shift != 0) && (j < segment.fixes.size()); j++)
+			segment.fixes[j].time += shift;
+		if(segment.flight < 0) {
+			segment.flight = flights.size();
+			flights.push_back(Flight());
+			flights.back().start = segment.fixes.front().time;
+			flights.back().end = segment.fixes.back().time;
+		}
+		Flight &flight = flights[segment.flight];
+		flight.segments.push_back(order[i]);
+		flight.start = std::min(flight.start, segment.fixes.front().time);
+		flight.end = std::max(flight.end, segment.fixes.back().time);
+	}
+
+	for(size_t f = 0; f < flights.size(); f++) {
+		Flight &flight = flights[f];
+		for(size_t s = 0; s < flight.segments.size(); s++) {
+			std::vector<Fix> &fixes = segments[flight.segments[s]].fixes;
+			flight.fixes.insert(flight.fixes.end(), fixes.begin(), fixes.end());
+			std::vector<Fix>().swap(fixes);
+		}
+		std::stable_sort(flight.fixes.begin(), flight.fixes.end(), [](const Fix &a, const Fix &b) {
+			return a.time < b.time;
+		});
+		if(flight.start < 0) {
+			for(size_t i = 0; i < flight.fixes.size(); i++)
+				flight.fixes[i].time += SECONDS_PER_DAY;
+			flight.start += SECONDS_PER_DAY;
+			flight.end += SECONDS_PER_DAY;
+		}
+	}
+	return flights;
+}
+
+// Sets each fix's speed and ascent rate, from the latest fix at least the interval before it
+static void derive(Flight &flight, const Options &options) {
+	std::vector<Fix> &fixes = flight.fixes;
+	size_t from = 0;
+	for(size_t i = 0; i < fixes.size(); i++) {
+		while((from + 1 < i) && (fixes[from + 1].time <= fixes[i].time - options.interval))
+			from++;
+		double elapsed = fixes[i].time - fixes[from].time;
+		if((from < i) && (elapsed >= options.interval)) {
+			fixes[i].speed = distance(fixes[from], fixes[i]) / elapsed;
+			fixes[i].ascent = (fixes[i].alt - fixes[from].alt) / elapsed;
+		}
+		else if(i > 0) {
+			fixes[i].speed = fixes[i - 1].speed;
+			fixes[i].ascent = fixes[i - 1].ascent;
+		}
+	}
+}
+
+// Formats seconds since midnight as hh:mm:ss, with +Nd for later days
+static std::string formatTime(double seconds) {
+	char text[32];
+	long whole = (long) floor(seconds);
+	long days = whole / (long) SECONDS_PER_DAY;
+	whole %= (long) SECONDS_PER_DAY;
+	if(days > 0)
+		snprintf(text, sizeof(text), "%02ld:%02ld:%02ld+%ldd", whole / 3600, (whole / 60) % 60, whole % 60, days);
+	else
+		snprintf(text, sizeof(text), "%02ld:%02ld:%02ld", whole / 3600, (whole / 60) % 60, whole % 60);
+	return text;
+}
+
+static const Fix &burst(const Flight &flight) {
+	size_t top = 0;
+	for(size_t i = 1; i < flight.fixes.size(); i++) {
+		if(flight.fixes[i].alt > flight.fixes[top].alt)
+			top = i;
+	}
+	return flight.fixes[top];
+}
+
+static void printSummary(const std::vector<Flight> &flights, const std::vector<LogFile> &logs) {
+	for(size_t f = 0; f < flights.size(); f++) {
+		const Flight &flight = flights[f];
+		const std::vector<Fix> &fixes = flight.fixes;
+		double trackLength = 0;
+		double maxSpeed = 0;
+		double maxAscent = 0;
+		double maxDescent = 0;
+		std::vector<bool> used(logs.size(), false);
+		for(size_t i = 0; i < fixes.size(); i++) {
+			if(i > 0)
+				trackLength += distance(fixes[i - 1], fixes[i]);
+			maxSpeed = std::max(maxSpeed, fixes[i].speed);
+			maxAscent = std::max(maxAscent, fixes[i].ascent);
+			maxDescent = std::max(maxDescent, -fixes[i].ascent);
+			used[fixes[i].file] = true;
+		}
+		const Fix &top = burst(flight);
+		printf("Flight %d: %s to %s UTC, %lu fixes from", (int) f + 1, formatTime(fixes.front().time).c_str(),
+			formatTime(fixes.back().time).c_str(), (unsigned long) fixes.size());
+		for(size_t l = 0; l < logs.size(); l++) {
+			if(used[l])
+				printf(" %s", logs[l].name.c_str());
+		}
+		printf("\n");
+		printf("  launch %.6f, %.6f at %.0f m; landing %.6f, %.6f at %.0f m, %.1f km away\n", fixes.front().lat,
+			fixes.front().lon, fixes.front().alt, fixes.back().lat, fixes.back().lon, fixes.back().alt,
+			distance(fixes.front(), fixes.back()) / 1000);
+		printf("  burst %.0f m at %s, %.6f, %.6f\n", top.alt, formatTime(top.time).c_str(), top.lat, top.lon);
+		printf("  track %.1f km; max ground speed %.1f m/s, ascent %.1f m/s, descent %.1f m/s\n", trackLength / 1000,
+			maxSpeed, maxAscent, maxDescent);
+	}
+}
+
+/* Bins the CSQ readings by altitude and prints, per bin, the samples, the share with a usable signal (CSQ 1 to 31)
+ * and the mean CSQ of those; then the correlation of usable CSQ with altitude over all flights.
+ */
+static void printCoverage(const std::vector<Flight> &flights, const Options &options) {
+	std::vector<unsigned long> samples;
+	std::vector<unsigned long> usable;
+	std::vector<double> csqSums;
+	double n = 0, sumAlt = 0, sumCsq = 0, sumAltAlt = 0, sumCsqCsq = 0, sumAltCsq = 0;
+	for(size_t f = 0; f < flights.size(); f++) {
+		for(size_t i = 0; i < flights[f].fixes.size(); i++) {
+			const Fix &fix = flights[f].fixes[i];
+			if(fix.csq < 0)
+				continue;
+			size_t bin = (fix.alt > 0) ? (size_t) (fix.alt / options.bin) : 0;
+			if(bin >= samples.size()) {
+				samples.resize(bin + 1, 0);
+				usable.resize(bin + 1, 0);
+				csqSums.resize(bin + 1, 0);
+			}
+			samples[bin]++;
+			if((fix.csq > 0) && (fix.csq != CSQ_UNKNOWN)) {
+				usable[bin]++;
+				csqSums[bin] += fix.csq;
+				n++;
+				sumAlt += fix.alt;
+				sumCsq += fix.csq;
+				sumAltAlt += fix.alt * fix.alt;
+				sumCsqCsq += (double) fix.csq * fix.csq;
+				sumAltCsq += fix.alt * fix.csq;
+			}
+		}
+	}
+	if(samples.empty())
+		return;
+	printf("Coverage by altitude (CSQ 1-31 usable):\n");
+	printf("  %-13s %8s %8s %7s %8s\n", "altitude (m)", "samples", "usable", "share", "mean CSQ");
+	for(size_t b = 0; b < samples.size(); b++) {
+		if(samples[b] == 0)
+			continue;
+		char range[32];
+		snprintf(range, sizeof(range), "%.0f-%.0f", b * options.bin, (b + 1) * options.bin);
+		printf("  %-13s %8lu %8lu %6.1f%%", range, samples[b], usable[b], 100.0 * usable[b] / samples[b]);
+		if(usable[b] > 0)
+			printf(" %8.1f\n", csqSums[b] / usable[b]);
+		else
+			printf(" %8s\n", "-");
+	}
+	double denominator = sqrt((n * sumAltAlt - sumAlt * sumAlt) * (n * sumCsqCsq - sumCsq * sumCsq));
+	if(denominator > 0)
+		printf("  correlation of usable CSQ with altitude: %.3f over %.0f samples\n", (n * sumAltCsq - sumAlt * sumCsq) / denominator, n);
+}
+
+static FILE *openOutput(const char *name) {
+	FILE *out = fopen(name, "w");
+	if(out == NULL) {
+		fprintf(stderr, "Cannot write %s\n", name);
+		return NULL;
+	}
+	setvbuf(out, NULL, _IOFBF, 1 << 20);
+	return out;
+}
+
+static void writeKml(FILE *out, const std::vector<Flight> &flights) {
+	fprintf(out, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<kml xmlns=\"http://www.opengis.net/kml/2.2\">\n<Document>\n");
+	fprintf(out, "<name>BPPCell flights</name>\n");
+	fprintf(out, "<Style id=\"track\"><LineStyle><color>ff0000ff</color><width>3</width></LineStyle></Style>\n");
+	for(size_t f = 0; f < flights.size(); f++) {
+		const std::vector<Fix> &fixes = flights[f].fixes;
+		fprintf(out, "<Placemark>\n<name>Flight %d (%s to %s UTC)</name>\n<styleUrl>#track</styleUrl>\n", (int) f + 1,
+			formatTime(fixes.front().time).c_str(), formatTime(fixes.back().time).c_str());
+		fprintf(out, "<LineString><altitudeMode>absolute</altitudeMode><coordinates>\n");
+		for(size_t i = 0; i < fixes.size(); i++)
+			fprintf(out, "%.7f,%.7f,%.1f\n", fixes[i].lon, fixes[i].lat, fixes[i].alt);
+		fprintf(out, "</coordinates></LineString>\n</Placemark>\n");
+		const Fix &top = burst(flights[f]);
+		fprintf(out, "<Placemark><name>Flight %d burst, %.0f m</name><Point><altitudeMode>absolute</altitudeMode>", (int) f + 1, top.alt);
+		fprintf(out, "<coordinates>%.7f,%.7f,%.1f</coordinates></Point></Placemark>\n", top.lon, top.lat, top.alt);
+	}
+	fprintf(out, "</Document>\n</kml>\n");
+}
+
+// Writes the values of one per-fix property as a JSON array
+static void writeJsonArray(FILE *out, const char *name, const std::vector<Fix> &fixes, double Fix::*member, const char *format) {
+	fprintf(out, ",\"%s\":[", name);
+	for(size_t i = 0; i < fixes.size(); i++) {
+		if(i > 0)
+			fputc(',', out);
+		fprintf(out, format, fixes[i].*member);
+	}
+	fputc(']', out);
+}
+
+static void writeGeoJson(FILE *out, const std::vector<Flight> &flights, const std::vector<LogFile> &logs) {
+	fprintf(out, "{\"type\":\"FeatureCollection\",\"features\":[\n");
+	for(size_t f = 0; f < flights.size(); f++) {
+		const std::vector<Fix> &fixes = flights[f].fixes;
+		const Fix &top = burst(flights[f]);
+		fprintf(out, "%s{\"type\":\"Feature\",\"properties\":{\"flight\":%d,\"start\":\"%s\",\"end\":\"%s\",\"fixes\":%lu,",
+			(f > 0) ? ",\n" : "", (int) f + 1, formatTime(fixes.front().time).c_str(), formatTime(fixes.back().time).c_str(),
+			(unsigned long) fixes.size());
+		fprintf(out, "\"burst_alt_m\":%.1f,\"burst_time\":\"%s\",\"sources\":[", top.alt, formatTime(top.time).c_str());
+		std::vector<bool> used(logs.size(), false);
+		for(size_t i = 0; i < fixes.size(); i++)
+			used[fixes[i].file] = true;
+		bool first = true;
+		for(size_t l = 0; l < logs.size(); l++) {
+			if(!used[l])
+				continue;
+			if(!first)
+				fputc(',', out);
+			fputc('"', out);
+			for(const char *c = logs[l].name.c_str(); *c != '\0'; c++) {
+				if((*c == '"') || (*c == '\\'))
+					fputc('\\', out);
+				fputc(*c, out);
+			}
+			fputc('"', out);
+			first = false;
+		}
+		fputc(']', out);
+		writeJsonArray(out, "time_s", fixes, &Fix::time, "%.2f");
+		writeJsonArray(out, "speed_mps", fixes, &Fix::speed, "%.2f");
+		writeJsonArray(out, "ascent_mps", fixes, &Fix::ascent, "%.2f");
+		fprintf(out, "},\"geometry\":{\"type\":\"LineString\",\"coordinates\":[");
+		for(size_t i = 0; i < fixes.size(); i++)
+			fprintf(out, "%s[%.7f,%.7f,%.1f]", (i > 0) ? "," : "", fixes[i].lon, fixes[i].lat, fixes[i].alt);
+		fprintf(out, "]}}");
+	}
+	fprintf(out, "\n]}\n");
+}
+
+static void writeCsv(FILE *out, const std::vector<Flight> &flights, const std::vector<LogFile> &logs) {
+	fprintf(out, "flight,time_s,time,lat,lon,alt_m,speed_mps,ascent_mps,csq,source\n");
+	for(size_t f = 0; f < flights.size(); f++) {
+		const std::vector<Fix> &fixes = flights[f].fixes;
+		for(size_t i = 0; i < fixes.size(); i++) {
+			const Fix &fix = fixes[i];
+			fprintf(out, "%d,%.2f,%s,%.7f,%.7f,%.1f,%.2f,%.2f,", (int) f + 1, fix.time, formatTime(fix.time).c_str(), fix.lat,
+				fix.lon, fix.alt, fix.speed, fix.ascent);
+			if(fix.csq >= 0)
+				fprintf(out, "%d", fix.csq);
+			fprintf(out, ",%s\n", logs[fix.file].name.c_str());
+		}
+	}
+}
+
+static void usage(const char *program) {
+	fprintf(stderr, "Usage: %s [options] datalog.txt ...\n", program);
+	fprintf(stderr, "  --kml FILE       Write the tracks as KML\n");
+	fprintf(stderr, "  --geojson FILE   Write the tracks as GeoJSON\n");
+	fprintf(stderr, "  --csv FILE       Write the merged tracks as CSV\n");
+	fprintf(stderr, "  --gap SECONDS    Longest gap within a flight (default 600)\n");
+	fprintf(stderr, "  --join METERS    Farthest apart two cards' fixes may be to stitch them (default 2000)\n");
+	fprintf(stderr, "  --no-stitch      Keep every card's segments as separate flights\n");
+	fprintf(stderr, "  --interval SECONDS  Span over which speeds and ascent rates are taken (default 10)\n");
+	fprintf(stderr, "  --bin METERS     Altitude bin for the coverage table (default 1000)\n");
+	fprintf(stderr, "  --threads N      Parser threads (default: one per core)\n");
+}
+
+int main(int argc, char **argv) {
+	Options options;
+	options.gap = 600;
+	options.join = 2000;
+	options.bin = 1000;
+	options.interval = 10;
+	options.threads = std::max(1u, std::thread::hardware_concurrency());
+	options.kml = NULL;
+	options.geojson = NULL;
+	options.csv = NULL;
+	options.stitch = true;
+
+	std::vector<LogFile> logs;
+	for(int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = (i + 1 < argc);
+		if((arg == "--kml") && hasValue)
+			options.kml = argv[++i];
+		else if((arg == "--geojson") && hasValue)
+			options.geojson = argv[++i];
+		else if((arg == "--csv") && hasValue)
+			options.csv = argv[++i];
+		else if((arg == "--gap") && hasValue)
+			options.gap = atof(argv[++i]);
+		else if((arg == "--join") && hasValue)
+			options.join = atof(argv[++i]);
+		else if((arg == "--interval") && hasValue)
+			options.interval = atof(argv[++i]);
+		else if((arg == "--bin") && hasValue)
+			options.bin = atof(argv[++i]);
+		else if((arg == "--threads") && hasValue)
+			options.threads = std::max(1, atoi(argv[++i]));
+		else if(arg == "--no-stitch")
+			options.stitch = false;
+		else if((arg.size() > 1) && (arg[0] == '-')) {
+			usage(argv[0]);
+			return 2;
+		}
+		else {
+			LogFile log;
+			log.name = arg;
+			log.lines = 0;
+			log.fixes = 0;
+			log.noFix = 0;
+			log.skipped = 0;
+			logs.push_back(log);
+		}
+	}
+	if(logs.empty() || (options.gap <= 0) || (options.bin <= 0) || (options.interval <= 0)) {
+		usage(argv[0]);
+		return 2;
+	}
+
+	for(size_t i = 0; i < logs.size(); i++) {
+		if(!mapFile(logs[i])) {
+			fprintf(stderr, "Cannot read %s\n", logs[i].name.c_str());
+			return 1;
+		}
+	}
+	std::vector<Chunk> chunks = parseLogs(logs, options.threads);
+	for(size_t i = 0; i < logs.size(); i++) {
+		printf("%s: %lu lines, %lu fixes, %lu without a fix, %lu skipped\n", logs[i].name.c_str(), logs[i].lines,
+			logs[i].fixes, logs[i].noFix, logs[i].skipped);
+	}
+
+	std::vector<Segment> segments = segmentLogs(chunks, options);
+	std::vector<Chunk>().swap(chunks);
+	std::vector<Flight> flights = stitch(segments, options);
+	for(size_t f = 0; f < flights.size(); f++)
+		derive(flights[f], options);
+
+	printSummary(flights, logs);
+	printCoverage(flights, options);
+
+	int status = 0;
+	if(options.kml != NULL) {
+		FILE *out = openOutput(options.kml);
+		if(out != NULL) {
+			writeKml(out, flights);
+			fclose(out);
+		}
+		else {
+			status = 1;
+		}
+	}
+	if(options.geojson != NULL) {
+		FILE *out = openOutput(options.geojson);
+		if(out != NULL) {
+			writeGeoJson(out, flights, logs);
+			fclose(out);
+		}
+		else {
+			status = 1;
+		}
+	}
+	if(options.csv != NULL) {
+		FILE *out = openOutput(options.csv);
+		if(out != NULL) {
+			writeCsv(out, flights, logs);
+			fclose(out);
+		}
+		else {
+			status = 1;
+		}
+	}
+
+	for(size_t i = 0; i < logs.size(); i++) {
+		if(logs[i].data != NULL)
+			munmap((void *) logs[i].data, logs[i].size);
+	}
+	return status;
+}
@@ -0,0 +1,139 @@
+/* FixedDivisor Exhaustive Test
+ * Part of the BPPCell host tests; see README.txt. Not part of the Arduino library.
+ *
+ * Checks every divisor GPSCoords uses (the typedefs in BPPCell.h) against / and % for every dividend in its declared
+ * range, in 32-bit arithmetic as on the AVR whatever the size of the host's long, and checks that no product
+ * overflows. Then checks getLatLonInDMS() and getLatLonInDecDegs() against the / and % code they replaced for every
+ * coordinate in +/-(2^31 - 1). Exits with 1 on any mismatch.
+ */
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include "BPPCell.h"
+
+static int failures = 0;
+
+/* Divides as FixedDivisor::divide() does on the AVR, with every intermediate held to 32 bits. Returns false if the
+ * reciprocal multiply would overflow them.
+ */
+template <unsigned long DIVISOR, unsigned long MAX_DIVIDEND>
+static bool divide32(uint32_t dividend, uint32_t &quotient, uint32_t &remainder) {
+	typedef FixedDivisor<DIVISOR, MAX_DIVIDEND> Divisor;
+	uint64_t product = (uint64_t) (dividend >> Divisor::PRE_SHIFT) * (uint32_t) Divisor::MULTIPLIER;
+	if(product > 0xFFFFFFFFULL)
+		return false;
+	quotient = (uint32_t) product >> Divisor::POST_SHIFT;
+	remainder = dividend - quotient * (uint32_t) DIVISOR;
+	if(remainder >= DIVISOR) {
+		quotient++;
+		remainder -= DIVISOR;
+	}
+	return true;
+}
+
+template <unsigned long DIVISOR, unsigned long MAX_DIVIDEND>
+static void checkDivisor(const char *name, FixedDivisor<DIVISOR, MAX_DIVIDEND>) {
+	typedef FixedDivisor<DIVISOR, MAX_DIVIDEND> Divisor;
+	unsigned long overflows = 0;
+	unsigned long mismatches = 0;
+	for(uint64_t x = 0; x <= MAX_DIVIDEND; x++) {
+		uint32_t dividend = (uint32_t) x;
+		uint32_t quotient;
+		uint32_t remainder;
+		if(!divide32<DIVISOR, MAX_DIVIDEND>(dividend, quotient, remainder)) {
+			overflows++;
+			continue;
+		}
+		unsigned long hostRemainder;
+		unsigned long hostQuotient = Divisor::divide(dividend, hostRemainder);
+		if((quotient != dividend / DIVISOR) || (remainder != dividend % DIVISOR) || (hostQuotient != quotient) || (hostRemainder != remainder))
+			mismatches++;
+	}
+	printf("%-20s / %-7lu  0 to %-10lu  pre %2d post %2d multiplier %-10lu  %s\n", name, DIVISOR, MAX_DIVIDEND, (int) Divisor::PRE_SHIFT, (int) Divisor::POST_SHIFT, (unsigned long) Divisor::MULTIPLIER, ((overflows == 0) && (mismatches == 0)) ? "ok" : "FAILED");
+	if((overflows != 0) || (mismatches != 0)) {
+		printf("    %lu overflows, %lu mismatches\n", overflows, mismatches);
+		failures++;
+	}
+}
+
+// getLatLonInDMS() as it was before FixedDivisor, with the AVR's 32-bit long
+static DMSCoords oldDMS(int32_t lat, int32_t lon) {
+	DMSCoords coords;
+	int32_t localLat = (lat < 0) ? -lat : lat;
+	int32_t localLon = (lon < 0) ? -lon : lon;
+	const int32_t perDegree = GPSCoords::MINUTES_PER_DEGREE * GPSCoords::TEN_THOUSANDTHS_PER_MINUTE;
+	const int32_t perMinute = GPSCoords::TEN_THOUSANDTHS_PER_MINUTE;
+
+	coords.latDegs = (int) (localLat / perDegree);
+	localLat = localLat % perDegree;
+	coords.lonDegs = (int) (localLon / perDegree);
+	localLon = localLon % perDegree;
+	coords.latMins = (int) (localLat / perMinute);
+	localLat = localLat % perMinute;
+	coords.lonMins = (int) (localLon / perMinute);
+	localLon = localLon % perMinute;
+	coords.latSecs = ((float) (localLat * GPSCoords::SECONDS_PER_MINUTE) / perMinute);
+	coords.lonSecs = ((float) (localLon * GPSCoords::SECONDS_PER_MINUTE) / perMinute);
+	coords.isNorth = lat >= 0;
+	coords.isEast = lon >= 0;
+	return coords;
+}
+
+// getLatLonInDecDegs() as it was before FixedDivisor, with the AVR's 32-bit long
+static DecDegsCoords oldDecDegs(int32_t lat, int32_t lon) {
+	DecDegsCoords coords;
+	const int32_t perDegree = GPSCoords::MINUTES_PER_DEGREE * GPSCoords::TEN_THOUSANDTHS_PER_MINUTE;
+	coords.latChar = (int) (lat / perDegree);
+	coords.latMant = (((lat < 0) ? -lat : lat) % perDegree) / ((float) perDegree);
+	coords.lonChar = (int) (lon / perDegree);
+	coords.lonMant = (((lon < 0) ? -lon : lon) % perDegree) / ((float) perDegree);
+	return coords;
+}
+
+static bool sameDMS(const DMSCoords &a, const DMSCoords &b) {
+	return (a.latDegs == b.latDegs) && (a.latMins == b.latMins) && (memcmp(&a.latSecs, &b.latSecs, sizeof(float)) == 0)
+		&& (a.lonDegs == b.lonDegs) && (a.lonMins == b.lonMins) && (memcmp(&a.lonSecs, &b.lonSecs, sizeof(float)) == 0)
+		&& (a.isNorth == b.isNorth) && (a.isEast == b.isEast);
+}
+
+static bool sameDecDegs(const DecDegsCoords &a, const DecDegsCoords &b) {
+	return (a.latChar == b.latChar) && (memcmp(&a.latMant, &b.latMant, sizeof(float)) == 0)
+		&& (a.lonChar == b.lonChar) && (memcmp(&a.lonMant, &b.lonMant, sizeof(float)) == 0);
+}
+
+/* Every coordinate from -(2^31 - 1) to 2^31 - 1, as the latitude, with the longitude its negative so that both
+ * signs of each are covered; the two are converted by the same code. Floats are compared bit for bit.
+ */
+static void checkConversions() {
+	unsigned long dmsMismatches = 0;
+	unsigned long decDegsMismatches = 0;
+	GPSCoords coords("000000.00", 0, 0, 0);
+	for(int64_t x = -0x7FFFFFFFLL; x <= 0x7FFFFFFFLL; x++) {
+		int32_t lat = (int32_t) x;
+		coords.setLat(lat);
+		coords.setLon(-lat);
+		if(!sameDMS(coords.getLatLonInDMS(), oldDMS(lat, -lat)))
+			dmsMismatches++;
+		if(!sameDecDegs(coords.getLatLonInDecDegs(), oldDecDegs(lat, -lat)))
+			decDegsMismatches++;
+	}
+	printf("getLatLonInDMS       every coordinate in +/-(2^31 - 1)  %s\n", (dmsMismatches == 0) ? "ok" : "FAILED");
+	printf("getLatLonInDecDegs   every coordinate in +/-(2^31 - 1)  %s\n", (decDegsMismatches == 0) ? "ok" : "FAILED");
+	if((dmsMismatches != 0) || (decDegsMismatches != 0)) {
+		printf("    %lu and %lu mismatches\n", dmsMismatches, decDegsMismatches);
+		failures++;
+	}
+}
+
+int main() {
+	checkDivisor("DegreeDivisor", DegreeDivisor());
+	checkDivisor("MinuteDivisor", MinuteDivisor());
+	checkDivisor("HourMillisDivisor", HourMillisDivisor());
+	checkDivisor("MinuteMillisDivisor", MinuteMillisDivisor());
+	checkDivisor("SecondMillisDivisor", SecondMillisDivisor());
+	checkDivisor("TenDivisor", TenDivisor());
+	checkConversions();
+	printf("%s\n", (failures == 0) ? "All divisions match" : "Some divisions do not match");
+	return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,229 @@
+/* GeoMath Accuracy Test
+ * Part of the BPPCell host tests; see README.txt. Not part of the Arduino library.
+ *
+ * Sweeps the fixed-point kernels against <cmath> in double precision and checks the error bounds their comments
+ * claim. Distances are checked against a great circle on the sphere GeoMath assumes (one nautical mile per minute
+ * of arc), so the test measures the arithmetic, not the spherical model. Exits with 1 if any bound is exceeded.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include "BPPCell.h"
+
+const static double PI = 3.14159265358979323846;
+const static double UNITS_PER_DEGREE = GPSCoords::TEN_THOUSANDTHS_PER_DEGREE;
+const static double EARTH_RADIUS = GeoMath::EARTH_DIAMETER / 2.0;
+
+static int failures = 0;
+
+// The largest error seen by one check, and how close any error came to the bound claimed for it
+struct Bound {
+	const char *name;
+	double limit; // The claimed bound, where it does not depend on the case
+	double worst;
+	double worstShare; // The largest error as a fraction of its case's bound
+	long count;
+	long over;
+};
+
+static void record(Bound &bound, double error, double limit) {
+	double e = std::fabs(error);
+	bound.count++;
+	if(e > bound.worst)
+		bound.worst = e;
+	if(e / limit > bound.worstShare)
+		bound.worstShare = e / limit;
+	if(e > limit)
+		bound.over++;
+}
+
+static void report(Bound &bound, const char *unit) {
+	printf("%-26s %9ld cases  worst %7.4f %-8s  %3.0f%% of its bound  %s\n", bound.name, bound.count, bound.worst, unit, 100.0 * bound.worstShare, (bound.over == 0) ? "ok" : "FAILED");
+	if(bound.over != 0) {
+		printf("    %ld cases over the bound\n", bound.over);
+		failures++;
+	}
+}
+
+// A fixed linear congruential generator, so that every run checks the same points
+static uint32_t seed = 12345;
+
+static double uniform(double low, double high) {
+	seed = seed * 1664525UL + 1013904223UL;
+	return low + (high - low) * (seed / 4294967296.0);
+}
+
+static double toRadians(long units) {
+	return units / UNITS_PER_DEGREE * PI / 180.0;
+}
+
+static double greatCircle(long lat1, long lon1, long lat2, long lon2) {
+	double p1 = toRadians(lat1);
+	double p2 = toRadians(lat2);
+	double sinDLat = std::sin((p2 - p1) / 2);
+	double sinDLon = std::sin(toRadians(lon2 - lon1) / 2);
+	double h = sinDLat * sinDLat + std::cos(p1) * std::cos(p2) * sinDLon * sinDLon;
+	return 2 * EARTH_RADIUS * std::asin(std::sqrt(h));
+}
+
+// Bearing of (east, north) in hundredths of a degree, from 0 up to 36000
+static double bearing(double east, double north) {
+	double b = std::atan2(east, north) * 18000.0 / PI;
+	return (b < 0) ? b + 36000.0 : b;
+}
+
+// Difference of two bearings in hundredths of a degree, wrapped into [-18000, 18000]
+static double bearingError(double actual, double expected) {
+	double d = std::fmod(actual - expected, 36000.0);
+	if(d > 18000.0)
+		d -= 36000.0;
+	if(d < -18000.0)
+		d += 36000.0;
+	return d;
+}
+
+// cosQ15() and sinQ15() over two full turns either way, against round(32768 * cos)
+static void testTrig() {
+	Bound cosBound = {"cosQ15", 3, 0, 0, 0, 0};
+	Bound sinSmallBound = {"sinQ15 (series)", 2, 0, 0, 0, 0};
+	Bound sinBound = {"sinQ15 (table)", 3, 0, 0, 0, 0};
+	for(long angle = -2 * GeoMath::FULL_TURN; angle <= 2 * GeoMath::FULL_TURN; angle += 7) {
+		double radians = toRadians(angle);
+		double c = std::fmin(std::round(32768.0 * std::cos(radians)), 32767.0);
+		double s = std::fmin(std::round(32768.0 * std::sin(radians)), 32767.0);
+		record(cosBound, GeoMath::cosQ15(angle) - c, cosBound.limit);
+		if(std::labs(angle) <= GeoMath::SMALL_ANGLE_LIMIT)
+			record(sinSmallBound, GeoMath::sinQ15(angle) - s, sinSmallBound.limit);
+		else
+			record(sinBound, GeoMath::sinQ15(angle) - s, sinBound.limit);
+	}
+	report(cosBound, "LSB");
+	report(sinSmallBound, "LSB");
+	report(sinBound, "LSB");
+}
+
+// atan2Bearing() around the circle at several lengths of vector, down to 10000 so the inputs' rounding is negligible
+static void testBearing() {
+	Bound bound = {"atan2Bearing", 2, 0, 0, 0, 0};
+	const double lengths[] = {1e4, 1e5, 1e6, 2e7, 2e9};
+	for(double length : lengths) {
+		for(long step = 0; step < 360000; step++) {
+			double radians = step / 1000.0 * PI / 180.0;
+			long east = std::lround(length * std::sin(radians));
+			long north = std::lround(length * std::cos(radians));
+			record(bound, bearingError(GeoMath::atan2Bearing(east, north), bearing(east, north)), bound.limit);
+		}
+	}
+	report(bound, "0.01 deg");
+}
+
+/* equirectangularDistance() within one degree of arc along each axis and 80 degrees of latitude, where it claims
+ * 0.1% or 2 m, whichever is larger. distance() takes it there, or the haversine formula just past a degree of arc.
+ */
+static void testEquirectangular() {
+	Bound bound = {"equirectangularDistance", 0.1, 0, 0, 0, 0};
+	Bound choice = {"distance (short)", 0.1, 0, 0, 0, 0};
+	const long limitLat = 80 * GPSCoords::TEN_THOUSANDTHS_PER_DEGREE;
+	for(long i = 0; i < 2000000; i++) {
+		long lat1 = std::lround(uniform(-80, 80) * UNITS_PER_DEGREE);
+		long lon1 = std::lround(uniform(-180, 180) * UNITS_PER_DEGREE);
+		long lat2 = constrain(lat1 + std::lround(uniform(-1, 1) * UNITS_PER_DEGREE), -limitLat, limitLat);
+		double arc = uniform(-1, 1) * UNITS_PER_DEGREE; // Along the parallel, so the difference in longitude is wider
+		long lon2 = GeoMath::wrapLon(lon1 + std::lround(arc / std::cos(toRadians(lat1))));
+		double expected = greatCircle(lat1, lon1, lat2, lon2);
+		double scale = std::fmax(expected, 2000.0); // Errors are in percent of this, so that 2 m is 0.1% of it
+		long equirectangular = GeoMath::equirectangularDistance(lat1, lon1, lat2, lon2);
+		long chosen = GeoMath::distance(lat1, lon1, lat2, lon2);
+		record(bound, 100.0 * (equirectangular - expected) / scale, bound.limit);
+		record(choice, 100.0 * (chosen - expected) / scale, (chosen == equirectangular) ? choice.limit : 0.3);
+	}
+	report(bound, "%");
+	report(choice, "%");
+}
+
+/* haversineDistance() and distance() from one degree of arc to 5000 km, where they claim 0.3% up to 89 degrees of
+ * latitude and 0.6% nearer the poles
+ */
+static void testHaversine() {
+	Bound bound = {"haversineDistance", 0.3, 0, 0, 0, 0};
+	Bound choice = {"distance (long)", 0.3, 0, 0, 0, 0};
+	Bound polar = {"haversineDistance (polar)", 0.6, 0, 0, 0, 0};
+	const long polarLat = 89 * GPSCoords::TEN_THOUSANDTHS_PER_DEGREE;
+	long checked = 0;
+	while(checked < 2000000) {
+		long lat1 = std::lround(uniform(-90, 90) * UNITS_PER_DEGREE);
+		long lon1 = std::lround(uniform(-180, 180) * UNITS_PER_DEGREE);
+		long lat2 = std::lround(uniform(-90, 90) * UNITS_PER_DEGREE);
+		long lon2 = (checked & 1) ? std::lround(uniform(-180, 180) * UNITS_PER_DEGREE) : GeoMath::wrapLon(lon1 + std::lround(uniform(-50, 50) * UNITS_PER_DEGREE));
+		if(checked & 2) // Half the pairs nearby, so short separations are not too rare
+			lat2 = lat1 + std::lround(uniform(-45, 45) * UNITS_PER_DEGREE) % (long) (90 * UNITS_PER_DEGREE - std::labs(lat1) + 1);
+		double expected = greatCircle(lat1, lon1, lat2, lon2);
+		if((expected < EARTH_RADIUS * PI / 180.0) || (expected > 5000000.0))
+			continue;
+		checked++;
+		double error = 100.0 * (GeoMath::haversineDistance(lat1, lon1, lat2, lon2) - expected) / expected;
+		if((std::labs(lat1) > polarLat) || (std::labs(lat2) > polarLat)) {
+			record(polar, error, polar.limit);
+			record(choice, 100.0 * (GeoMath::distance(lat1, lon1, lat2, lon2) - expected) / expected, polar.limit);
+		}
+		else {
+			record(bound, error, bound.limit);
+			record(choice, 100.0 * (GeoMath::distance(lat1, lon1, lat2, lon2) - expected) / expected, choice.limit);
+		}
+	}
+	report(bound, "%");
+	report(polar, "%");
+	report(choice, "%");
+}
+
+/* GPSCoords::bearingTo(), offsetBy() and distanceTo() between points 1 to 50 km apart, below 80 degrees of latitude,
+ * against the same local tangent plane in double precision. bearingTo() is atan2Bearing() of the meters north and
+ * east that displacement() rounds, so it is allowed 2 hundredths of a degree plus the angle a meter and a half of
+ * rounding subtends. offsetBy() must land, and distanceTo() must measure it, within 2 m or 0.1%.
+ */
+static void testCoords() {
+	Bound bearingBound = {"GPSCoords::bearingTo", 2, 0, 0, 0, 0};
+	Bound offsetBound = {"GPSCoords::offsetBy", 0.1, 0, 0, 0, 0};
+	Bound roundTrip = {"offsetBy, then distanceTo", 0.1, 0, 0, 0, 0};
+	const double metersPerUnit = PI / 180.0 * EARTH_RADIUS / UNITS_PER_DEGREE;
+	for(long i = 0; i < 1000000; i++) {
+		long lat = std::lround(uniform(-80, 80) * UNITS_PER_DEGREE);
+		long lon = std::lround(uniform(-180, 180) * UNITS_PER_DEGREE);
+		double length = uniform(1000, 50000);
+		double direction = uniform(0, 2 * PI);
+		long north = std::lround(length * std::cos(direction));
+		long east = std::lround(length * std::sin(direction));
+		GPSCoords origin("000000.00", lat, lon, 0);
+		GPSCoords offset = origin.offsetBy(north, east);
+		double limit = std::fmax(0.1, 200.0 / length); // Percent
+
+		// Where the offset should be, on the tangent plane about the mean latitude
+		double dLat = north / metersPerUnit;
+		double cosMidLat = std::cos(toRadians(lat + std::lround(dLat / 2)));
+		double dLon = east / (metersPerUnit * cosMidLat);
+		double missNorth = (offset.getLat() - lat - dLat) * metersPerUnit;
+		double missEast = (GeoMath::wrapLon(offset.getLon() - lon) - dLon) * metersPerUnit * cosMidLat;
+		record(offsetBound, 100.0 * std::hypot(missNorth, missEast) / length, limit);
+		record(roundTrip, 100.0 * (origin.distanceTo(offset) - length) / length, limit);
+
+		double reachedNorth = (offset.getLat() - lat) * metersPerUnit;
+		double reachedEast = GeoMath::wrapLon(offset.getLon() - lon) * metersPerUnit * std::cos(toRadians(lat + ((offset.getLat() - lat) >> 1)));
+		double rounding = std::atan(1.5 / length) * 18000.0 / PI;
+		record(bearingBound, bearingError(origin.bearingTo(offset), bearing(reachedEast, reachedNorth)), bearingBound.limit + rounding);
+	}
+	report(bearingBound, "0.01 deg");
+	report(offsetBound, "%");
+	report(roundTrip, "%");
+}
+
+int main() {
+	printf("long is %d bits%s\n", (int) (8 * sizeof(long)), (sizeof(long) == 4) ? "" : "; build with -m32 to check the AVR's 32-bit overflow behaviour too");
+	testTrig();
+	testBearing();
+	testEquirectangular();
+	testHaversine();
+	testCoords();
+	printf("%s\n", (failures == 0) ? "All bounds hold" : "Some bounds do not hold");
+	return (failures == 0) ? 0 : 1;
+}
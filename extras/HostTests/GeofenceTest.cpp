@@ -0,0 +1,255 @@
+/* Geofence Containment Test
+ * Part of the BPPCell host tests; see README.txt. Not part of the Arduino library.
+ *
+ * Checks Geofence polygons against the textbook crossing-number test in double precision, on random convex,
+ * star-shaped and self-intersecting polygons from about 200 m to 5 degrees across. Points are taken in and around
+ * each bounding box, on and beside every vertex, and on the edges, where the half-open rule decides; the two must
+ * agree on every point. Circles are checked against a great circle on GeoMath's sphere, allowing the error
+ * GeoMath::distance() claims for points that close to the boundary. Exits with 1 on any mismatch.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include "BPPCell.h"
+
+const static double PI = 3.14159265358979323846;
+const static double UNITS_PER_DEGREE = GPSCoords::TEN_THOUSANDTHS_PER_DEGREE;
+const static double EARTH_RADIUS = GeoMath::EARTH_DIAMETER / 2.0;
+const static double METERS_PER_UNIT = PI / 180.0 * EARTH_RADIUS / UNITS_PER_DEGREE;
+const static int MAX_VERTICES = 24;
+
+static int failures = 0;
+
+// How many points one check compared, and how many Geofence placed differently from the reference
+struct Tally {
+	const char *name;
+	long count;
+	long mismatches;
+	long excused; // Circles only: disagreements within the error of GeoMath::distance()
+};
+
+static void record(Tally &tally, bool actual, bool expected, bool excusable = false) {
+	tally.count++;
+	if(actual == expected)
+		return;
+	if(excusable)
+		tally.excused++;
+	else
+		tally.mismatches++;
+}
+
+static void report(Tally &tally, const char *unit) {
+	printf("%-30s %9ld %-6s  %s\n", tally.name, tally.count, unit, (tally.mismatches == 0) ? "ok" : "FAILED");
+	if(tally.excused != 0)
+		printf("    %ld disagreements within the distance error\n", tally.excused);
+	if(tally.mismatches != 0) {
+		printf("    %ld mismatches\n", tally.mismatches);
+		failures++;
+	}
+}
+
+// A fixed linear congruential generator, so that every run checks the same points
+static uint32_t seed = 12345;
+
+static double uniform(double low, double high) {
+	seed = seed * 1664525UL + 1013904223UL;
+	return low + (high - low) * (seed / 4294967296.0);
+}
+
+static double toRadians(long units) {
+	return units / UNITS_PER_DEGREE * PI / 180.0;
+}
+
+static double greatCircle(long lat1, long lon1, long lat2, long lon2) {
+	double p1 = toRadians(lat1);
+	double p2 = toRadians(lat2);
+	double sinDLat = std::sin((p2 - p1) / 2);
+	double sinDLon = std::sin(toRadians(lon2 - lon1) / 2);
+	double h = sinDLat * sinDLat + std::cos(p1) * std::cos(p2) * sinDLon * sinDLon;
+	return 2 * EARTH_RADIUS * std::asin(std::sqrt(h));
+}
+
+/* The crossing-number test as usually written, straight from the vertices: an edge counts if one end is at or south
+ * of the point and the other north of it, and is crossed if the point is west of where the edge meets its latitude.
+ * Coordinates and separations here are small enough that the division cannot round a point across an edge.
+ */
+static bool referenceContains(const GeofencePoint *vertices, int numVertices, long lat, long lon) {
+	bool inside = false;
+	for(int i = 0; i < numVertices; i++) {
+		const GeofencePoint &a = vertices[i];
+		const GeofencePoint &b = vertices[(i + 1) % numVertices];
+		if((a.lat <= lat) == (b.lat <= lat))
+			continue;
+		double crossing = a.lon + (double) (lat - a.lat) * (b.lon - a.lon) / (b.lat - a.lat);
+		if(lon < crossing)
+			inside = !inside;
+	}
+	return inside;
+}
+
+/* A random polygon around (lat, lon): convex, star-shaped or, with its vertices in random order, self-intersecting.
+ * Every fourth is snapped to a coarse grid, so that it has horizontal edges and vertices that share a latitude.
+ */
+static int makePolygon(long polygon, long lat, long lon, double size, GeofencePoint *vertices) {
+	int numVertices = 3 + (int) uniform(0, MAX_VERTICES - 2);
+	int kind = polygon % 3;
+	double start = uniform(0, 2 * PI);
+	double lonScale = 1.0 / std::cos(toRadians(lat));
+	long grid = std::lround(size / 4) + 1;
+	for(int i = 0; i < numVertices; i++) {
+		double angle = (kind == 2) ? uniform(0, 2 * PI) : start + 2 * PI * (i + uniform(0, 0.9)) / numVertices;
+		double radius = size * ((kind == 0) ? uniform(0.9, 1) : uniform(0.1, 1));
+		long dLat = std::lround(radius * std::cos(angle));
+		long dLon = std::lround(radius * std::sin(angle) * lonScale);
+		if(polygon % 4 == 3) {
+			dLat = dLat / grid * grid;
+			dLon = dLon / grid * grid;
+		}
+		vertices[i].lat = lat + dLat;
+		vertices[i].lon = lon + dLon;
+	}
+	return numVertices;
+}
+
+// Collects what printEdgeTable() prints
+class TextCapture : public Print {
+	public:
+		char text[4096];
+		size_t length;
+		TextCapture() : length(0) {
+			text[0] = '\0';
+		}
+		size_t write(uint8_t c) {
+			if(length + 1 >= sizeof(text))
+				return 0;
+			text[length++] = (char) c;
+			text[length] = '\0';
+			return 1;
+		}
+};
+
+// Reads back the table printEdgeTable() printed and checks it holds edges, as a PROGMEM array named name
+static bool tableMatches(const char *text, const GeofenceEdge *edges, int numEdges, const char *name) {
+	char header[64];
+	snprintf(header, sizeof(header), "const GeofenceEdge %s[] PROGMEM = {\r\n", name);
+	if(strncmp(text, header, strlen(header)) != 0)
+		return false;
+	const char *line = text + strlen(header);
+	for(int i = 0; i < numEdges; i++) {
+		GeofenceEdge edge;
+		int used = 0;
+		if(sscanf(line, "\t{%ld, %ld, %ld, %ld, %ld, %ld}%n", &edge.latLow, &edge.latHigh, &edge.lonLow, &edge.lonHigh, &edge.dLat, &edge.dLon, &used) != 6)
+			return false;
+		if(memcmp(&edge, &edges[i], sizeof(GeofenceEdge)) != 0)
+			return false;
+		line += used;
+		if(strncmp(line, (i < numEdges - 1) ? ",\r\n" : "\r\n", (i < numEdges - 1) ? 3 : 2) != 0)
+			return false;
+		line += (i < numEdges - 1) ? 3 : 2;
+	}
+	return strcmp(line, "};\r\n") == 0;
+}
+
+/* 20000 polygons below 80 degrees of latitude and clear of the antimeridian, each with 100 points in a bounding box
+ * widened by a tenth, every vertex and its four neighbours a unit away, and a point on each edge. Alternate polygons
+ * are added as if in PROGMEM. The first hundred also have their edge tables printed and read back.
+ */
+static void testPolygons() {
+	Tally random = {"polygon, random points", 0, 0, 0};
+	Tally vertex = {"polygon, vertices and beside", 0, 0, 0};
+	Tally edge = {"polygon, points on edges", 0, 0, 0};
+	Tally table = {"printEdgeTable", 0, 0, 0};
+	Geofence geofence;
+	GeofencePoint vertices[MAX_VERTICES];
+	GeofenceEdge edges[MAX_VERTICES];
+	for(long polygon = 0; polygon < 20000; polygon++) {
+		long lat = std::lround(uniform(-75, 75) * UNITS_PER_DEGREE);
+		long lon = std::lround(uniform(-170, 170) * UNITS_PER_DEGREE);
+		double size = std::exp(uniform(std::log(540.0), std::log(2.5 * UNITS_PER_DEGREE))); // 100 m to 2.5 degrees
+		int numVertices = makePolygon(polygon, lat, lon, size, vertices);
+		int numEdges = Geofence::precomputeEdges(vertices, numVertices, edges);
+		geofence.clear();
+		if(!geofence.addPolygon(edges, numEdges, 1, polygon & 1)) // Every edge horizontal; there is nothing inside
+			continue;
+
+		if(polygon < 100) {
+			TextCapture capture;
+			Geofence::printEdgeTable(capture, edges, numEdges, "fence");
+			record(table, tableMatches(capture.text, edges, numEdges, "fence"), true);
+		}
+
+		long latMin = vertices[0].lat, latMax = vertices[0].lat, lonMin = vertices[0].lon, lonMax = vertices[0].lon;
+		for(int i = 1; i < numVertices; i++) {
+			latMin = min(latMin, vertices[i].lat);
+			latMax = max(latMax, vertices[i].lat);
+			lonMin = min(lonMin, vertices[i].lon);
+			lonMax = max(lonMax, vertices[i].lon);
+		}
+		long latMargin = (latMax - latMin) / 10 + 1;
+		long lonMargin = (lonMax - lonMin) / 10 + 1;
+		for(int i = 0; i < 100; i++) {
+			long pointLat = std::lround(uniform(latMin - latMargin, latMax + latMargin));
+			long pointLon = std::lround(uniform(lonMin - lonMargin, lonMax + lonMargin));
+			record(random, geofence.fenceContains(0, pointLat, pointLon), referenceContains(vertices, numVertices, pointLat, pointLon));
+		}
+
+		const long offsets[5][2] = {{0, 0}, {1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+		for(int i = 0; i < numVertices; i++) {
+			for(int j = 0; j < 5; j++) {
+				long pointLat = vertices[i].lat + offsets[j][0];
+				long pointLon = vertices[i].lon + offsets[j][1];
+				record(vertex, geofence.fenceContains(0, pointLat, pointLon), referenceContains(vertices, numVertices, pointLat, pointLon));
+			}
+		}
+
+		// A point at a random latitude along each edge, at the nearest whole unit of longitude to it
+		for(int i = 0; i < numVertices; i++) {
+			const GeofencePoint &a = vertices[i];
+			const GeofencePoint &b = vertices[(i + 1) % numVertices];
+			if(a.lat == b.lat)
+				continue;
+			long pointLat = min(a.lat, b.lat) + (long) uniform(0, std::labs(b.lat - a.lat));
+			long pointLon = std::lround(a.lon + (double) (pointLat - a.lat) * (b.lon - a.lon) / (b.lat - a.lat));
+			record(edge, geofence.fenceContains(0, pointLat, pointLon), referenceContains(vertices, numVertices, pointLat, pointLon));
+		}
+	}
+	report(random, "points");
+	report(vertex, "points");
+	report(edge, "points");
+	report(table, "tables");
+}
+
+/* 20000 circles of 50 m to 200 km below 80 degrees of latitude, each with 100 points in a square 1.3 radii on a side.
+ * A disagreement is excused only where the point is within GeoMath::distance()'s bound of the circle: 0.1% or 2 m,
+ * whichever is larger, up to a degree of arc, and 0.3% beyond. This also catches a bounding box too tight to hold it.
+ */
+static void testCircles() {
+	Tally tally = {"circle", 0, 0, 0};
+	Geofence geofence;
+	for(long circle = 0; circle < 20000; circle++) {
+		long lat = std::lround(uniform(-80, 80) * UNITS_PER_DEGREE);
+		long lon = std::lround(uniform(-150, 150) * UNITS_PER_DEGREE);
+		long radius = std::lround(std::exp(uniform(std::log(50.0), std::log(200000.0))));
+		geofence.clear();
+		geofence.addCircle(lat, lon, radius, 1);
+		double cosLat = std::cos(toRadians(lat));
+		for(int i = 0; i < 100; i++) {
+			long pointLat = lat + std::lround(uniform(-1.3, 1.3) * radius / METERS_PER_UNIT);
+			long pointLon = lon + std::lround(uniform(-1.3, 1.3) * radius / (METERS_PER_UNIT * cosLat));
+			double expected = greatCircle(lat, lon, pointLat, pointLon);
+			double allowed = (expected <= EARTH_RADIUS * PI / 180.0) ? std::fmax(2.0, 0.001 * expected) : 0.003 * expected;
+			record(tally, geofence.fenceContains(0, pointLat, pointLon), expected <= radius, std::fabs(expected - radius) <= allowed);
+		}
+	}
+	report(tally, "points");
+}
+
+int main() {
+	printf("long is %d bits%s\n", (int) (8 * sizeof(long)), (sizeof(long) == 4) ? "" : "; build with -m32 to check the AVR's 32-bit overflow behaviour too");
+	testPolygons();
+	testCircles();
+	printf("%s\n", (failures == 0) ? "All points agree" : "Some points do not agree");
+	return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,144 @@
+/* Host Shim of the Arduino Core
+ * Part of the BPPCell host tests (extras/HostTests); not part of the Arduino library.
+ *
+ * Just enough of the core for BPPCell.h and the library's arithmetic to compile on a desktop compiler, with
+ * BPPCELL_NO_HEAP defined so that no String is needed. Serial ports read nothing and discard what they are given.
+ * Note that on the host long is usually 64 bits, where on the AVR it is 32 and int is 16.
+ */
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <avr/pgmspace.h>
+
+#define F_CPU 16000000UL
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HEX 16
+#define DEC 10
+
+#ifndef min
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#endif
+#ifndef abs
+#define abs(x) ((x) > 0 ? (x) : -(x))
+#endif
+#define constrain(x, low, high) ((x) < (low) ? (low) : ((x) > (high) ? (high) : (x)))
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+char *dtostrf(double value, signed char width, unsigned char precision, char *buffer);
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(PSTR(s)))
+
+class Print {
+	public:
+		virtual ~Print() {}
+		virtual size_t write(uint8_t c) = 0;
+		virtual size_t write(const uint8_t *buffer, size_t size) {
+			size_t written = 0;
+			while(size-- > 0)
+				written += write(*buffer++);
+			return written;
+		}
+		size_t write(const char *s) {
+			return write((const uint8_t *) s, strlen(s));
+		}
+		size_t print(const char *s) {
+			return write(s);
+		}
+		size_t print(const __FlashStringHelper *s) {
+			return write((const char *) s);
+		}
+		size_t print(char c) {
+			return write((uint8_t) c);
+		}
+		size_t print(unsigned char value, int base = DEC) {
+			return print((unsigned long) value, base);
+		}
+		size_t print(int value, int base = DEC) {
+			return print((long) value, base);
+		}
+		size_t print(unsigned int value, int base = DEC) {
+			return print((unsigned long) value, base);
+		}
+		size_t print(long value, int base = DEC) {
+			if(base != DEC)
+				return print((unsigned long) value, base);
+			char text[24];
+			snprintf(text, sizeof(text), "%ld", value);
+			return write(text);
+		}
+		size_t print(unsigned long value, int base = DEC) {
+			char text[24];
+			snprintf(text, sizeof(text), (base == HEX) ? "%lX" : "%lu", value);
+			return write(text);
+		}
+		size_t print(double value, int digits = 2) {
+			char text[48];
+			snprintf(text, sizeof(text), "%.*f", digits, value);
+			return write(text);
+		}
+		size_t println() {
+			return write("\r\n");
+		}
+		template <class T>
+		size_t println(const T &value) {
+			size_t written = print(value);
+			return written + println();
+		}
+		template <class T>
+		size_t println(const T &value, int format) {
+			size_t written = print(value, format);
+			return written + println();
+		}
+};
+
+class Stream : public Print {
+	public:
+		virtual int available() = 0;
+		virtual int read() = 0;
+		virtual int peek() = 0;
+		size_t readBytes(char *buffer, size_t length) {
+			size_t count = 0;
+			int c;
+			while((count < length) && ((c = read()) >= 0))
+				buffer[count++] = (char) c;
+			return count;
+		}
+		long parseInt() {
+			long value = 0;
+			int c;
+			while(((c = read()) >= 0) && (c >= '0') && (c <= '9'))
+				value = value * 10 + (c - '0');
+			return value;
+		}
+		void setTimeout(unsigned long) {}
+};
+
+class HardwareSerial : public Stream {
+	public:
+		void begin(unsigned long) {}
+		int available() { return 0; }
+		int read() { return -1; }
+		int peek() { return -1; }
+		size_t write(uint8_t) { return 1; }
+		using Print::write;
+		operator bool() { return true; }
+};
+
+extern HardwareSerial Serial, Serial1, Serial2, Serial3;
+
+#endif
@@ -0,0 +1,2 @@
+// Host shim; HardwareSerial is declared in Arduino.h
+#include "Arduino.h"
@@ -0,0 +1,25 @@
+/* Host shim of the I2C master library the library's I2C transport uses. Reads return nothing but filler. */
+
+#ifndef I2C_h
+#define I2C_h
+
+#include "Arduino.h"
+
+class I2C {
+	public:
+		void begin() {}
+		void end() {}
+		void timeOut(unsigned int) {}
+		uint8_t available() { return 0; }
+		uint8_t receive() { return 0xFF; }
+		uint8_t read(uint8_t, uint8_t) { return 0; }
+		uint8_t read(uint8_t, uint8_t, uint8_t) { return 0; }
+		uint8_t read(uint8_t, uint8_t, uint8_t, uint8_t *) { return 0; }
+		uint8_t write(uint8_t, uint8_t) { return 0; }
+		uint8_t write(uint8_t, uint8_t, uint8_t) { return 0; }
+		uint8_t write(uint8_t, uint8_t, uint8_t *, uint8_t) { return 0; }
+};
+
+extern I2C I2c;
+
+#endif
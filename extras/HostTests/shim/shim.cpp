@@ -0,0 +1,32 @@
+// Host shim of the Arduino core's timing and serial ports; see Arduino.h
+
+#include <chrono>
+#include <thread>
+#include "Arduino.h"
+#include "I2C.h"
+
+HardwareSerial Serial, Serial1, Serial2, Serial3;
+I2C I2c;
+
+static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+unsigned long millis() {
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+unsigned long micros() {
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+void delay(unsigned long ms) {
+	std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(unsigned int us) {
+	std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+char *dtostrf(double value, signed char width, unsigned char precision, char *buffer) {
+	sprintf(buffer, "%*.*f", width, precision, value);
+	return buffer;
+}